@@ -4,26 +4,121 @@
 
 NetSerfQtCompressor::NetSerfQtCompressor(double error_bound) 
     : kMaxDiff(error_bound * 0.999), pre_value_(2.0) {
+  // 4位header + 最长5字节序列号扩展 + 5位keyframe标志和序号 + 最长63位值
   output_bit_stream_ = new OutputBitStream(16);
+  coalescer_ = NULL;
+  resync_ = NULL;
 }
 
 NetSerfQtCompressor::~NetSerfQtCompressor() {
   if (output_bit_stream_ != NULL) {
     delete output_bit_stream_;
   }
+  if (coalescer_ != NULL) {
+    delete coalescer_;
+  }
+  if (resync_ != NULL) {
+    delete resync_;
+  }
 }
 
-Array<uint8_t> NetSerfQtCompressor::Compress(double v) {
-  int written_bits_count = output_bit_stream_->WriteInt(0, 4);
-  
+Array<uint8_t> NetSerfQtCompressor::Compress(double v, uint32_t series_id, uint32_t now_ms) {
+  int written_bits_count = NetSeriesId::Write(series_id, output_bit_stream_);
+  if (resync_ != NULL) {
+    bool keyframe;
+    written_bits_count += resync_->WriteHeader(output_bit_stream_, now_ms, &keyframe);
+    if (keyframe) {
+      // 与解压端同时回到初始预测值
+      pre_value_ = 2.0;
+    }
+  }
+  written_bits_count += EncodeValue(v);
+  output_bit_stream_->Flush();
+  Array<uint8_t> result = output_bit_stream_->GetBuffer((uint16_t)ceilf(written_bits_count / 8.0f));
+  output_bit_stream_->Refresh();
+  return result;
+}
+
+net_serf_qt_series_state_t NetSerfQtCompressor::SaveSeriesState() const {
+  net_serf_qt_series_state_t state;
+  state.pre_value = pre_value_;
+  return state;
+}
+
+void NetSerfQtCompressor::LoadSeriesState(const net_serf_qt_series_state_t &state) {
+  pre_value_ = state.pre_value;
+}
+
+bool NetSerfQtCompressor::EnableResync(const net_resync_config_t &config) {
+  if (coalescer_ != NULL) {
+    printf("EnableResync: coalesced frames carry no resync header\n");
+    return false;
+  }
+  if (resync_ != NULL) {
+    delete resync_;
+  }
+  resync_ = new NetResyncEncoder(config);
+  return true;
+}
+
+void NetSerfQtCompressor::ForceKeyframe() {
+  if (resync_ != NULL) {
+    resync_->ForceKeyframe();
+  }
+}
+
+bool NetSerfQtCompressor::EnableCoalescing(const net_coalescing_config_t &config) {
+  if (resync_ != NULL) {
+    printf("EnableCoalescing: coalesced frames carry no resync header\n");
+    return false;
+  }
+  if (!NetFrameCoalescer::Fits(config, kMaxValueBits)) {
+    printf("EnableCoalescing: mtu_bytes %u is too small\n", (unsigned)config.mtu_bytes);
+    return false;
+  }
+  if (coalescer_ != NULL) {
+    delete coalescer_;
+  }
+  coalescer_ = new NetFrameCoalescer(config);
+  // 按MTU重新分配位流，帧在可能溢出前就会关闭
+  delete output_bit_stream_;
+  output_bit_stream_ = new OutputBitStream(config.mtu_bytes);
+  return true;
+}
+
+Array<uint8_t> NetSerfQtCompressor::Append(double v, uint32_t now_ms) {
+  if (coalescer_ == NULL) {
+    printf("Append: coalescing is not enabled\n");
+    return Array<uint8_t>(0);
+  }
+  coalescer_->BeginValue(output_bit_stream_, now_ms);
+  int value_bits = EncodeValue(v);
+  if (coalescer_->EndValue(value_bits, kMaxValueBits, now_ms)) {
+    return coalescer_->TakeFrame(output_bit_stream_);
+  }
+  return Array<uint8_t>(0);
+}
+
+Array<uint8_t> NetSerfQtCompressor::Poll(uint32_t now_ms) {
+  if (coalescer_ == NULL || !coalescer_->Expired(now_ms)) {
+    return Array<uint8_t>(0);
+  }
+  return coalescer_->TakeFrame(output_bit_stream_);
+}
+
+Array<uint8_t> NetSerfQtCompressor::Flush() {
+  if (coalescer_ == NULL) {
+    return Array<uint8_t>(0);
+  }
+  return coalescer_->TakeFrame(output_bit_stream_);
+}
+
+int NetSerfQtCompressor::EncodeValue(double v) {
   // 内部计算使用float以优化性能（对于GPS坐标精度足够）
   int32_t q = (int32_t)roundf((float)((v - pre_value_) / (2.0 * kMaxDiff)));
   double recover_value = pre_value_ + 2.0 * kMaxDiff * (double)q;
   
-  written_bits_count += EliasGammaCodec::Encode(ZigZagCodec::Encode(q) + 1, output_bit_stream_);
+  int written_bits_count = EliasGammaCodec::Encode(ZigZagCodec::Encode(q) + 1, output_bit_stream_);
   pre_value_ = recover_value;
-  output_bit_stream_->Flush();
-  Array<uint8_t> result = output_bit_stream_->GetBuffer((uint16_t)ceilf(written_bits_count / 8.0f));
-  output_bit_stream_->Refresh();
-  return result;
+  return written_bits_count;
 }
@@ -9,19 +9,58 @@
 #include "../utils/double.h"
 #include "../utils/elias_gamma_codec.h"
 #include "../utils/zig_zag_codec.h"
+#include "../utils/net_frame_coalescer.h"
+#include "../utils/net_series_id.h"
+#include "../utils/net_resync.h"
+
+// 单个序列的压缩状态，NetSerfQtMultiplexer为每个序列保存一份
+typedef struct {
+  double pre_value;
+} net_serf_qt_series_state_t;
 
 class NetSerfQtCompressor {
  public:
   explicit NetSerfQtCompressor(double error_bound);
   ~NetSerfQtCompressor();
 
-  // 支持double输入（GPS坐标通常使用double）
-  Array<uint8_t> Compress(double v);
+  // 支持double输入（GPS坐标通常使用double）；series_id写入4位header，见NetSeriesId；now_ms仅用于按时间发送keyframe
+  Array<uint8_t> Compress(double v, uint32_t series_id = 0, uint32_t now_ms = 0);
+
+  net_serf_qt_series_state_t SaveSeriesState() const;
+
+  void LoadSeriesState(const net_serf_qt_series_state_t &state);
+
+  // 切换到可重同步模式，逐值包带keyframe标志和序号，格式见NetResyncEncoder；须在第一个Compress之前调用。
+  // 聚合帧不带keyframe标志和序号，已启用聚合时返回false
+  bool EnableResync(const net_resync_config_t &config);
+
+  // 下一个包强制为keyframe
+  void ForceKeyframe();
+
+  // 切换到聚合模式，之后使用Append/Poll/Flush，帧格式见NetFrameCoalescer；
+  // mtu_bytes放不下帧头和一个kMaxValueBits位的值，或已启用重同步时返回false，保持逐值模式
+  bool EnableCoalescing(const net_coalescing_config_t &config);
+
+  // 返回就绪的帧，没有就绪帧时返回空数组
+  Array<uint8_t> Append(double v, uint32_t now_ms);
+
+  // 无新值时检查时延预算
+  Array<uint8_t> Poll(uint32_t now_ms);
+
+  Array<uint8_t> Flush();
+
+  // Elias Gamma编码2^32以内的zigzag值最多63位
+  static const uint32_t kMaxValueBits = 63;
 
  private:
+
   const double kMaxDiff;
   double pre_value_;
   OutputBitStream* output_bit_stream_;
+  NetFrameCoalescer* coalescer_;
+  NetResyncEncoder* resync_;
+
+  int EncodeValue(double v);
 };
 
 #endif  // NET_SERF_QT_COMPRESSOR_H
@@ -0,0 +1,37 @@
+#include "net_serf_qt_multiplexer.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+NetSerfQtMultiplexer::NetSerfQtMultiplexer(uint32_t number_of_series, double error_bound)
+    : compressor_(error_bound), number_of_series_(number_of_series) {
+  series_states_ = (net_serf_qt_series_state_t*)malloc(number_of_series * sizeof(net_serf_qt_series_state_t));
+  if (series_states_ == NULL) {
+    printf("NetSerfQtMultiplexer: ERROR - failed to allocate %lu series\n", (unsigned long)number_of_series);
+    number_of_series_ = 0;
+    return;
+  }
+  net_serf_qt_series_state_t initial_state = compressor_.SaveSeriesState();
+  for (uint32_t i = 0; i < number_of_series_; i++) {
+    series_states_[i] = initial_state;
+  }
+}
+
+NetSerfQtMultiplexer::~NetSerfQtMultiplexer() {
+  if (series_states_ != NULL) {
+    free(series_states_);
+  }
+}
+
+Array<uint8_t> NetSerfQtMultiplexer::Compress(uint32_t series_id, double v) {
+  if (series_id >= number_of_series_) {
+    return Array<uint8_t>(0);
+  }
+  compressor_.LoadSeriesState(series_states_[series_id]);
+  Array<uint8_t> result = compressor_.Compress(v, series_id);
+  series_states_[series_id] = compressor_.SaveSeriesState();
+  return result;
+}
+
+uint32_t NetSerfQtMultiplexer::number_of_series() const {
+  return number_of_series_;
+}
@@ -0,0 +1,33 @@
+#ifndef NET_SERF_QT_MULTIPLEXER_H
+#define NET_SERF_QT_MULTIPLEXER_H
+
+#include <stdint.h>
+
+#include "../utils/array.h"
+#include "net_serf_qt_compressor.h"
+
+/*
+ * Many Net-SERF-QT series over one packet stream. Every series keeps only its net_serf_qt_series_state_t in a
+ * table indexed by series ID; one NetSerfQtCompressor is loaded with that state per value, and the series ID
+ * goes into the packet header (see NetSeriesId). There is no resync mode (see NetResyncEncoder): a lost packet
+ * leaves its series' predictor out of step with the demultiplexer.
+ */
+
+class NetSerfQtMultiplexer {
+ public:
+  NetSerfQtMultiplexer(uint32_t number_of_series, double error_bound);
+  ~NetSerfQtMultiplexer();
+
+  // series_id超出范围时返回空数组
+  Array<uint8_t> Compress(uint32_t series_id, double v);
+
+  uint32_t number_of_series() const;
+
+ private:
+  NetSerfQtCompressor compressor_;
+  // 序列数可能超过MAX_ARRAY_SIZE，不使用Array
+  net_serf_qt_series_state_t* series_states_;
+  uint32_t number_of_series_;
+};
+
+#endif  // NET_SERF_QT_MULTIPLEXER_H
@@ -5,7 +5,89 @@ NetSerfXORCompressor::NetSerfXORCompressor(int window_size, double max_diff, lon
   output_buffer_ = std::make_unique<OutputBitStream>(5 * 64);
 }
 
-Array<uint8_t> NetSerfXORCompressor::Compress(double v) {
+Array<uint8_t> NetSerfXORCompressor::Compress(double v, uint32_t series_id, uint32_t now_ms) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  // 4-bit transition header carries the series ID
+  int header_size = NetSeriesId::Write(series_id, output_buffer_.get());
+  if (resync_ != nullptr) {
+    bool keyframe;
+    header_size += resync_->WriteHeader(output_buffer_.get(), now_ms, &keyframe);
+    if (keyframe) {
+      // must happen before Approximate(), which searches relative to stored_val_
+      ResetPredictor();
+    }
+  }
+  return AddValue(Approximate(v), header_size);
+}
+
+net_serf_xor_series_state_t NetSerfXORCompressor::SaveSeriesState() const {
+  net_serf_xor_series_state_t state;
+  state.stored_val = stored_val_;
+  state.stored_leading_zeros = stored_leading_zeros_ > 64 ? 0xFF : stored_leading_zeros_;
+  state.stored_trailing_zeros = stored_trailing_zeros_ > 64 ? 0xFF : stored_trailing_zeros_;
+  return state;
+}
+
+void NetSerfXORCompressor::LoadSeriesState(const net_serf_xor_series_state_t &state) {
+  stored_val_ = state.stored_val;
+  stored_leading_zeros_ = state.stored_leading_zeros > 64 ? std::numeric_limits<int>::max()
+                                                          : state.stored_leading_zeros;
+  stored_trailing_zeros_ = state.stored_trailing_zeros > 64 ? std::numeric_limits<int>::max()
+                                                            : state.stored_trailing_zeros;
+}
+
+bool NetSerfXORCompressor::EnableResync(const net_resync_config_t &config) {
+  if (coalescer_ != nullptr) {
+    return false;
+  }
+  resync_ = std::make_unique<NetResyncEncoder>(config);
+  return true;
+}
+
+void NetSerfXORCompressor::ForceKeyframe() {
+  if (resync_ != nullptr) {
+    resync_->ForceKeyframe();
+  }
+}
+
+bool NetSerfXORCompressor::EnableCoalescing(const net_coalescing_config_t &config) {
+  if (resync_ != nullptr || !NetFrameCoalescer::Fits(config, kMaxValueBits)) {
+    return false;
+  }
+  coalescer_ = std::make_unique<NetFrameCoalescer>(config);
+  // frames are closed before the next value could overflow mtu_bytes
+  output_buffer_ = std::make_unique<OutputBitStream>(config.mtu_bytes);
+  return true;
+}
+
+Array<uint8_t> NetSerfXORCompressor::Append(double v, uint32_t now_ms) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  if (coalescer_ == nullptr) {
+    return Array<uint8_t>(0);
+  }
+  coalescer_->BeginValue(output_buffer_.get(), now_ms);
+  int this_size = EncodeValue(Approximate(v));
+  if (coalescer_->EndValue(this_size, MaxNextValueBits(), now_ms)) {
+    return coalescer_->TakeFrame(output_buffer_.get());
+  }
+  return Array<uint8_t>(0);
+}
+
+Array<uint8_t> NetSerfXORCompressor::Poll(uint32_t now_ms) {
+  if (coalescer_ == nullptr || !coalescer_->Expired(now_ms)) {
+    return Array<uint8_t>(0);
+  }
+  return coalescer_->TakeFrame(output_buffer_.get());
+}
+
+Array<uint8_t> NetSerfXORCompressor::Flush() {
+  if (coalescer_ == nullptr) {
+    return Array<uint8_t>(0);
+  }
+  return coalescer_->TakeFrame(output_buffer_.get());
+}
+
+uint64_t NetSerfXORCompressor::Approximate(double v) {
   uint64_t this_val;
   // note we cannot let > maxDiff, because NaN - v > maxDiff is always false
   if (std::abs(Double::LongBitsToDouble(stored_val_) - kAdjustDigit - v) > kMaxDiff) {
@@ -13,58 +95,88 @@ Array<uint8_t> NetSerfXORCompressor::Compress(double v) {
     double adjust_value = v + kAdjustDigit;
     this_val = SerfUtils64::FindAppLong(adjust_value - kMaxDiff, adjust_value + kMaxDiff, v, stored_val_,
                                         kMaxDiff, kAdjustDigit);
+    SERF_STATS(RecordSearch());
   } else {
     // let current value be the last value, making an XORed value of 0.
     this_val = stored_val_;
+    SERF_STATS(++stats_.stored_val_reuses);
   }
-  Array<uint8_t> result = AddValue(this_val);
-  stored_val_ = this_val;
-  return result;
+  SERF_STATS(++stats_.values);
+  return this_val;
 }
 
-Array<uint8_t> NetSerfXORCompressor::AddValue(uint64_t value) {
-  // Reserve 4 bits for transition header
-  int this_size = output_buffer_->WriteInt(0, 4);
+Array<uint8_t> NetSerfXORCompressor::AddValue(uint64_t value, int header_size) {
+  compressed_size_this_window_ += header_size;
+  int this_size = header_size + EncodeValue(value);
+  output_buffer_->Flush();
+  // the buffer holds the longest packet; never send a cut one, the decoder could not tell
+  Array<uint8_t> ret = output_buffer_->overflowed() ? Array<uint8_t>(0)
+                                                    : output_buffer_->GetBuffer(std::ceil(this_size / 8.0));
+  output_buffer_->Refresh();
+  return ret;
+}
+
+int NetSerfXORCompressor::EncodeValue(uint64_t value) {
+  int this_size = 0;
   if (number_of_values_this_window_ >= kWindowSize) {
     this_size += UpdatePositionsIfNeeded();
   }
   this_size += CompressValue(value);
   compressed_size_this_window_ += this_size;
-  output_buffer_->Flush();
-  Array<uint8_t> ret = output_buffer_->GetBuffer(std::ceil(this_size / 8.0));
-  output_buffer_->Refresh();
   ++number_of_values_this_window_;
-  return ret;
+  stored_val_ = value;
+  return this_size;
+}
+
+void NetSerfXORCompressor::ResetPredictor() {
+  stored_val_ = Double::DoubleToLongBits(2);
+  stored_leading_zeros_ = std::numeric_limits<int>::max();
+  stored_trailing_zeros_ = std::numeric_limits<int>::max();
+  // back to the tables of the default positions; the own set is kept for the next divergence
+  tables_ = &kSerfXORDefaultTableSet;
+  __builtin_memset(lead_distribution_.begin(), 0, 64 * sizeof(int));
+  __builtin_memset(trail_distribution_.begin(), 0, 64 * sizeof(int));
+  compressed_size_this_window_ = 0;
+  number_of_values_this_window_ = 0;
+  compression_ratio_last_window_ = 0;
+}
+
+int NetSerfXORCompressor::MaxNextValueBits() const {
+  // case 00 with no zeros to strip, plus both position tables when a window update is due
+  int bits = 2 + tables_->leading_bits_per_value + tables_->trailing_bits_per_value + 64;
+  if (number_of_values_this_window_ >= kWindowSize) {
+    bits += 1 + 2 * (5 + 6 * 32);
+  }
+  return bits;
 }
 
 int NetSerfXORCompressor::CompressValue(uint64_t value) {
+  SERF_PERF_SCOPE(kPerfRegionCompressValue);
   int this_size = 0;
   uint64_t xor_result = stored_val_ ^ value;
+  const serf_xor_table_set_t &tables = *tables_;
 
   if (xor_result == 0) {
     // case 01
-    this_size += output_buffer_->WriteInt(1, 2);
+    SERF_STATS(++stats_.case_01);
+    this_size += output_buffer_->WriteInt(0, 1) + output_buffer_->WriteInt(1, 1);
   } else {
     int leading_count = __builtin_clzll(xor_result);
     int trailing_count = __builtin_ctzll(xor_result);
-    int leading_zeros = leading_round_[leading_count];
-    int trailing_zeros = trailing_round_[trailing_count];
+    int leading_zeros = tables.leading_round[leading_count];
+    int trailing_zeros = tables.trailing_round[trailing_count];
     ++lead_distribution_[leading_count];
     ++trail_distribution_[trailing_count];
 
     if (leading_zeros >= stored_leading_zeros_ && trailing_zeros >= stored_trailing_zeros_ &&
         (leading_zeros - stored_leading_zeros_) + (trailing_zeros - stored_trailing_zeros_)
-            < 1 + leading_bits_per_value_ + trailing_bits_per_value_) {
+            < 1 + tables.leading_bits_per_value + tables.trailing_bits_per_value) {
       // case 1
+      SERF_STATS(++stats_.case_1);
       int center_bits = 64 - stored_leading_zeros_ - stored_trailing_zeros_;
       int len = 1 + center_bits;
-      if (len > 64) {
-        output_buffer_->WriteInt(1, 1);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong((1ULL << center_bits) | (xor_result >> stored_trailing_zeros_), 1 +
-            center_bits);
-      }
+      output_buffer_->WriteInt(1, 1);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     } else {
       stored_leading_zeros_ = leading_zeros;
@@ -72,16 +184,13 @@ int NetSerfXORCompressor::CompressValue(uint64_t value) {
       int center_bits = 64 - stored_leading_zeros_ - stored_trailing_zeros_;
 
       // case 00
-      int len = 2 + leading_bits_per_value_ + trailing_bits_per_value_ + center_bits;
-      if (len > 64) {
-        output_buffer_->WriteInt((leading_representation_[stored_leading_zeros_] << trailing_bits_per_value_) |
-        trailing_representation_[stored_trailing_zeros_], 2 + leading_bits_per_value_ + trailing_bits_per_value_);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong(((((uint64_t) leading_representation_[stored_leading_zeros_] <<
-        trailing_bits_per_value_) | trailing_representation_[stored_trailing_zeros_]) << center_bits) | (xor_result
-        >> stored_trailing_zeros_), len);
-      }
+      SERF_STATS(++stats_.case_00);
+      int len = 2 + tables.leading_bits_per_value + tables.trailing_bits_per_value + center_bits;
+      output_buffer_->WriteInt(0, 2);
+      output_buffer_->WriteInt((tables.leading_representation[stored_leading_zeros_] <<
+          tables.trailing_bits_per_value) | tables.trailing_representation[stored_trailing_zeros_],
+          tables.leading_bits_per_value + tables.trailing_bits_per_value);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     }
   }
@@ -89,18 +198,19 @@ int NetSerfXORCompressor::CompressValue(uint64_t value) {
 }
 
 int NetSerfXORCompressor::UpdatePositionsIfNeeded() {
+  SERF_PERF_SCOPE(kPerfRegionUpdatePositionsIfNeeded);
   int len;
   double compression_ratio_this_window_ = (double) compressed_size_this_window_ / (number_of_values_this_window_ * 64);
   if (compression_ratio_last_window_ < compression_ratio_this_window_) {
     // update positions
-    Array<int> lead_positions = PostOfficeSolver::InitRoundAndRepresentation(lead_distribution_,
-                                                                             leading_representation_,
-                                                                             leading_round_);
-    leading_bits_per_value_ = PostOfficeSolver::kPositionLength2Bits[lead_positions.length()];
-    Array<int> trail_positions = PostOfficeSolver::InitRoundAndRepresentation(trail_distribution_,
-                                                                              trailing_representation_,
-                                                                              trailing_round_);
-    trailing_bits_per_value_ = PostOfficeSolver::kPositionLength2Bits[trail_positions.length()];
+    Array<int> lead_positions = PostOfficeSolver::SolvePositions(lead_distribution_);
+    Array<int> trail_positions = PostOfficeSolver::SolvePositions(trail_distribution_);
+    serf_xor_table_set_t tables;
+    SerfXORTables::Fill(lead_positions, 64, tables.leading_representation, tables.leading_round);
+    SerfXORTables::Fill(trail_positions, 64, tables.trailing_representation, tables.trailing_round);
+    tables.leading_bits_per_value = PostOfficeSolver::kPositionLength2Bits[lead_positions.length()];
+    tables.trailing_bits_per_value = PostOfficeSolver::kPositionLength2Bits[trail_positions.length()];
+    tables_ = SerfXORTables::Assign(tables, kSerfXORDefaultTableSet, own_tables_);
     len = output_buffer_->WriteInt(1, 1)
         + PostOfficeSolver::WritePositions(lead_positions, output_buffer_.get())
         + PostOfficeSolver::WritePositions(trail_positions, output_buffer_.get());
@@ -114,3 +224,21 @@ int NetSerfXORCompressor::UpdatePositionsIfNeeded() {
   number_of_values_this_window_ = 0;
   return len;
 }
+
+#ifdef SERF_ENABLE_STATS
+const serf_xor_stats_t &NetSerfXORCompressor::stats() const {
+  return stats_;
+}
+
+void NetSerfXORCompressor::ResetStats() {
+  stats_ = serf_xor_stats_t();
+}
+
+void NetSerfXORCompressor::RecordSearch() {
+  int depth = SerfUtils64::last_search_depth();
+  ++stats_.find_app_long_calls;
+  stats_.find_app_long_iterations += depth;
+  ++stats_.search_depth_histogram[depth];
+  stats_.find_app_long_fallbacks += SerfUtils64::last_search_fell_back();
+}
+#endif
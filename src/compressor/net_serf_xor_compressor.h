@@ -3,18 +3,71 @@
 
 #include <cmath>
 #include <cstdint>
+#include <memory>
 
 #include "utils/array.h"
 #include "utils/double.h"
 #include "utils/serf_utils_64.h"
 #include "utils/output_bit_stream.h"
 #include "utils/post_office_solver.h"
+#include "utils/serf_xor_tables.h"
+#include "utils/perf_counters.h"
+#include "utils/serf_stats.h"
+#include "utils/net_frame_coalescer.h"
+#include "utils/net_series_id.h"
+#include "utils/net_resync.h"
+
+// Per-series part of the compressor state, kept per series by NetSerfXORMultiplexer. Zeros counts above 64 mean
+// "none stored yet".
+typedef struct {
+  uint64_t stored_val;
+  uint8_t stored_leading_zeros;
+  uint8_t stored_trailing_zeros;
+} net_serf_xor_series_state_t;
 
 class NetSerfXORCompressor {
  public:
+  // Post-office positions both sides start from, and return to on every keyframe
+  constexpr static int kDefaultLeadingPositions[] = {0, 8, 12, 16, 18, 20, 22, 24};
+  constexpr static int kDefaultTrailingPositions[] = {0, 22, 28, 32, 36, 40, 42, 46};
+
   NetSerfXORCompressor(int window_size, double max_diff, long adjust_digit);
 
-  Array<uint8_t> Compress(double v);
+  // series_id goes into the 4-bit transition header, see NetSeriesId; now_ms only drives time-based keyframes
+  Array<uint8_t> Compress(double v, uint32_t series_id = 0, uint32_t now_ms = 0);
+
+  net_serf_xor_series_state_t SaveSeriesState() const;
+
+  void LoadSeriesState(const net_serf_xor_series_state_t &state);
+
+  // Add a keyframe flag and sequence number to every packet (see NetResyncEncoder); call before the first Compress.
+  // Returns false if coalescing is enabled, since coalesced frames carry no resync header
+  bool EnableResync(const net_resync_config_t &config);
+
+  // Make the next packet a keyframe
+  void ForceKeyframe();
+
+  // Switch to coalescing mode (see NetFrameCoalescer), after which Append/Poll/Flush are used instead of Compress.
+  // Returns false, and stays in per-value mode, if mtu_bytes cannot hold the frame header and one kMaxValueBits value
+  // or if resync is enabled
+  bool EnableCoalescing(const net_coalescing_config_t &config);
+
+  // Returns the frame that became ready, or an empty array
+  Array<uint8_t> Append(double v, uint32_t now_ms);
+
+  // Hands out the pending frame once its latency budget is used up
+  Array<uint8_t> Poll(uint32_t now_ms);
+
+  Array<uint8_t> Flush();
+
+#ifdef SERF_ENABLE_STATS
+  const serf_xor_stats_t &stats() const;
+
+  void ResetStats();
+#endif
+
+  // the most a value can take: case 00 with no zeros to strip, 5-bit position codes and both position tables
+  static const int kMaxValueBits = 2 + 5 + 5 + 64 + 1 + 2 * (5 + 6 * 32);
 
  private:
   const double kMaxDiff;
@@ -23,59 +76,35 @@ class NetSerfXORCompressor {
 
   uint64_t stored_val_ = Double::DoubleToLongBits(2);
   std::unique_ptr<OutputBitStream> output_buffer_;
+  std::unique_ptr<NetFrameCoalescer> coalescer_;
+  std::unique_ptr<NetResyncEncoder> resync_;
 
   long compressed_size_this_window_ = 0;
   int number_of_values_this_window_ = 0;
   double compression_ratio_last_window_ = 0;
 
-  Array<int> leading_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 1, 2, 2, 2, 2,
-      3, 3, 4, 4, 5, 5, 6, 6,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7
-  };
-  Array<int> leading_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      8, 8, 8, 8, 12, 12, 12, 12,
-      16, 16, 18, 18, 20, 20, 22, 22,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24
-  };
-  Array<int> trailing_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 1, 1,
-      1, 1, 1, 1, 2, 2, 2, 2,
-      3, 3, 3, 3, 4, 4, 4, 4,
-      5, 5, 6, 6, 6, 6, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-  };
-  Array<int> trailing_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 22, 22,
-      22, 22, 22, 22, 28, 28, 28, 28,
-      32, 32, 32, 32, 36, 36, 36, 36,
-      40, 40, 42, 42, 42, 42, 46, 46,
-      46, 46, 46, 46, 46, 46, 46, 46,
-      46, 46, 46, 46, 46, 46, 46, 46,
-  };
-  int leading_bits_per_value_ = 3;
-  int trailing_bits_per_value_ = 3;
+  // the shared ROM tables until this instance's positions diverge from them, see SerfXORTables::Assign
+  const serf_xor_table_set_t *tables_ = &kSerfXORDefaultTableSet;
+  std::unique_ptr<serf_xor_table_set_t> own_tables_;
   Array<int> lead_distribution_ = Array<int>(64);
   Array<int> trail_distribution_ = Array<int>(64);
   int stored_leading_zeros_ = std::numeric_limits<int>::max();
   int stored_trailing_zeros_ = std::numeric_limits<int>::max();
+#ifdef SERF_ENABLE_STATS
+  serf_xor_stats_t stats_ = {};
+
+  void RecordSearch();
+#endif
+
+  uint64_t Approximate(double v);
+
+  Array<uint8_t> AddValue(uint64_t value, int header_size);
+
+  void ResetPredictor();
+
+  int EncodeValue(uint64_t value);
 
-  Array<uint8_t> AddValue(uint64_t value);
+  int MaxNextValueBits() const;
 
   int CompressValue(uint64_t value);
 
@@ -0,0 +1,21 @@
+#include "compressor/net_serf_xor_multiplexer.h"
+
+NetSerfXORMultiplexer::NetSerfXORMultiplexer(uint32_t number_of_series, int window_size, double max_diff,
+                                             long adjust_digit)
+    : compressor_(window_size, max_diff, adjust_digit),
+      series_states_(number_of_series, compressor_.SaveSeriesState()) {}
+
+Array<uint8_t> NetSerfXORMultiplexer::Compress(uint32_t series_id, double v) {
+  if (series_id >= series_states_.size()) {
+    return Array<uint8_t>(0);
+  }
+  net_serf_xor_series_state_t &state = series_states_[series_id];
+  compressor_.LoadSeriesState(state);
+  Array<uint8_t> result = compressor_.Compress(v, series_id);
+  state = compressor_.SaveSeriesState();
+  return result;
+}
+
+uint32_t NetSerfXORMultiplexer::number_of_series() const {
+  return series_states_.size();
+}
@@ -0,0 +1,34 @@
+#ifndef NET_SERF_XOR_MULTIPLEXER_H
+#define NET_SERF_XOR_MULTIPLEXER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "utils/array.h"
+#include "compressor/net_serf_xor_compressor.h"
+
+/*
+ * Many Net-SERF-XOR series over one packet stream, with the series ID in the packet header (see NetSeriesId).
+ *
+ * Only stored_val_ and the stored leading/trailing zeros are kept per series (10 bytes). The post-office window,
+ * its distributions and the leading/trailing representations are shared and adapt to all series together, so
+ * thousands of series cost no more than their table entries. The demultiplexer mirrors this, which requires
+ * packets to be decompressed in the order they were produced, as for a single Net series. There is no resync mode
+ * (see NetResyncEncoder), so a lost packet desynchronizes every series; use a reliable transport.
+ */
+
+class NetSerfXORMultiplexer {
+ public:
+  NetSerfXORMultiplexer(uint32_t number_of_series, int window_size, double max_diff, long adjust_digit);
+
+  // Returns an empty array for an unknown series_id
+  Array<uint8_t> Compress(uint32_t series_id, double v);
+
+  uint32_t number_of_series() const;
+
+ private:
+  NetSerfXORCompressor compressor_;
+  std::vector<net_serf_xor_series_state_t> series_states_;
+};
+
+#endif  // NET_SERF_XOR_MULTIPLEXER_H
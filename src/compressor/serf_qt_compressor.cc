@@ -1,45 +1,395 @@
 #include "serf_qt_compressor.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-SerfQtCompressor::SerfQtCompressor(uint16_t block_size, float max_diff) 
-    : kBlockSize(block_size), kMaxDiff(max_diff * 0.999f) {
-  // IAR适配：优化buffer_size计算
-  // 对于轨迹数据，平均每个点大约需要8-12位（Elias Gamma编码）
-  // 加上header（48位），总共约为 block_size * 12 + 48 位
-  // 转换为字节：(block_size * 12 + 48) / 8 ≈ block_size * 1.5 + 6
-  // 为了节省内存，最大限制为128字节
-  uint32_t buffer_size = (block_size * 2 < 128) ? (block_size * 2) : 128;
+#ifdef SERF_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+SerfQtCompressor::SerfQtCompressor(uint16_t block_size, float max_diff, SerfQtCoder coder, bool select_predictor,
+                                   bool power_of_two_bound)
+    : kBlockSize(block_size),
+      kMaxDiff(power_of_two_bound ? PowerOfTwoBound::Bound(max_diff, 0.999f) : max_diff * 0.999f),
+      kCoder(coder), kSelectPredictor(select_predictor),
+      kPowerOfTwoBound(power_of_two_bound && PowerOfTwoBound::IsPowerOfTwo(kMaxDiff)),
+      kStepExponent(PowerOfTwoBound::Exponent(kMaxDiff) + 1) {
+  // 缓冲区大小由平台profile决定：8051上按平均码长估计并限制在128字节，宿主机按最坏情况分配
+  uint32_t buffer_size = SERF_QT_BLOCK_BUFFER_BYTES(block_size);
+  if (kCoder != kSerfQtCoderEliasGamma) {
+    // 预留频率表空间：最坏情况下每个符号约19位；packed只在比Elias Gamma小时使用，无需额外空间
+    buffer_size += RansCodec::kAlphabetSize * 19 / 8 + 1;
+  }
+  if (buffer_size > SERF_BIT_STREAM_MAX_BYTES) {
+    buffer_size = SERF_BIT_STREAM_MAX_BYTES;
+  }
+  if (IsBuffered()) {
+    Array<uint32_t> temp_values(block_size);
+    zigzag_values_.swap(temp_values);
+  }
   output_bit_stream_ = new OutputBitStream(buffer_size);
   first_ = true;
   pre_value_ = 2.0f;
+  position_ = 0;
   compressed_size_in_bits_ = 0;
   stored_compressed_size_in_bits_ = 0;
+  number_of_values_ = 0;
+  number_of_values_this_block_ = 0;
+  gamma_bits_ = 0;
+  predictor_ = kSerfQtPredictorPrevious;
+  coefficient_ = 0;
+}
+
+bool SerfQtCompressor::AddValue(float v) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  // IAR适配：使用float替代double，减少计算开销
+  int32_t q = Quantize(v - pre_value_);
+  if (!Fits(q)) {
+    return false;
+  }
+  position_ += q;
+  pre_value_ = RecoverValue(position_);
+  EncodeQuantized(q);
+  return true;
+}
+
+// 按写入q后的最坏情况判断：直接写入时为已写的位数，缓存模式下为最大header加Elias Gamma位数，
+// 因为rANS、packed和预测器只在比Elias Gamma小时使用
+bool SerfQtCompressor::Fits(int32_t q) const {
+  if (number_of_values_this_block_ >= kBlockSize) {
+    return false;
+  }
+  uint32_t bits = EliasGammaCodec::Length((uint32_t)ZigZagCodec::Encode(q) + 1);
+  if (IsBuffered()) {
+    bits += kMaxHeaderBits + gamma_bits_;
+  } else {
+    bits += compressed_size_in_bits_ + (first_ ? HeaderBits(kSerfQtCoderEliasGamma) : 0);
+  }
+  return bits <= output_bit_stream_->capacity() * 8;
+}
+
+float SerfQtCompressor::RecoverValue(int32_t position) const {
+  // 须与SerfQtDecompressor的重建逐位一致；2的幂模式下与乘法的结果相同
+  if (kPowerOfTwoBound) {
+    return 2.0f + PowerOfTwoBound::Scale((float)position, kStepExponent);
+  }
+  return 2.0f + 2.0f * kMaxDiff * (float)position;
 }
 
-void SerfQtCompressor::AddValue(float v) {
+int32_t SerfQtCompressor::Quantize(float delta) const {
+  if (kPowerOfTwoBound) {
+    return (int32_t)roundf(PowerOfTwoBound::Scale(delta, -kStepExponent));
+  }
+  return (int32_t)roundf(delta / (2.0f * kMaxDiff));
+}
+
+#if SERF_DOUBLE_WIDTH == 64
+
+// 每次量化的分段长度，网格位置缓冲区放在栈上
+static const uint16_t kQuantizeChunk = 256;
+
+// 网格位置在double中计算，舍入后转为int32
+static void QuantizeGridScalar(const float *values, uint16_t count, double inverse_step, int32_t *positions) {
+  for (uint16_t i = 0; i < count; i++) {
+    positions[i] = (int32_t)nearbyint(((double)values[i] - 2.0) * inverse_step);
+  }
+}
+
+#ifdef SERF_AVX2_DISPATCH
+// 每次4个值
+__attribute__((target("avx2")))
+static void QuantizeGridAvx2(const float *values, uint16_t count, double inverse_step, int32_t *positions) {
+  const __m256d two = _mm256_set1_pd(2.0);
+  const __m256d inverse = _mm256_set1_pd(inverse_step);
+  uint16_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(values + i));
+    __m256d position = _mm256_round_pd(_mm256_mul_pd(_mm256_sub_pd(v, two), inverse),
+                                       _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_si128((__m128i *)(positions + i), _mm256_cvtpd_epi32(position));
+  }
+  QuantizeGridScalar(values + i, count - i, inverse_step, positions + i);
+}
+#endif
+
+uint16_t SerfQtCompressor::AddValues(const float *values, uint16_t count) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  int32_t positions[kQuantizeChunk];
+  const double inverse_step = 1.0 / (double)(2.0f * kMaxDiff);
+#ifdef SERF_AVX2_DISPATCH
+  static const bool use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+  for (uint16_t offset = 0; offset < count; offset += kQuantizeChunk) {
+    uint16_t chunk = count - offset < kQuantizeChunk ? count - offset : kQuantizeChunk;
+    // 第一遍：每个值最近的网格位置，与前一个值无关，可以并行
+#ifdef SERF_AVX2_DISPATCH
+    if (use_avx2) {
+      QuantizeGridAvx2(values + offset, chunk, inverse_step, positions);
+    } else
+#endif
+    {
+      QuantizeGridScalar(values + offset, chunk, inverse_step, positions);
+    }
+
+    // 第二遍：按解压端的浮点运算重建并校验，然后编码
+    for (uint16_t i = 0; i < chunk; i++) {
+      float v = values[offset + i];
+      float recoverValue = RecoverValue(positions[i]);
+      int32_t q = positions[i] - position_;
+      if (fabsf(recoverValue - v) > kMaxDiff) {
+        q = Quantize(v - pre_value_);
+        recoverValue = RecoverValue(position_ + q);
+      }
+      if (!Fits(q)) {
+        return offset + i;
+      }
+      position_ += q;
+      pre_value_ = recoverValue;
+      EncodeQuantized(q);
+    }
+  }
+  return count;
+}
+
+#else
+
+uint16_t SerfQtCompressor::AddValues(const float *values, uint16_t count) {
+  // 8051没有SIMD，且栈空间放不下分段缓冲区
+  for (uint16_t i = 0; i < count; i++) {
+    if (!AddValue(values[i])) {
+      return i;
+    }
+  }
+  return count;
+}
+
+#endif
+
+void SerfQtCompressor::EncodeQuantized(int32_t q) {
   if (first_) {
     first_ = false;
-    compressed_size_in_bits_ += output_bit_stream_->WriteInt(kBlockSize, 16);
-    uint32_t max_diff_bits = Double::FloatToLongBits(kMaxDiff);
-    compressed_size_in_bits_ += output_bit_stream_->WriteLong(max_diff_bits, 32);
+    // 缓存模式在Close()时才确定实际使用的编码器和预测器，header随之写入
+    if (!IsBuffered()) {
+      WriteHeader(kSerfQtCoderEliasGamma);
+    }
+  }
+  number_of_values_this_block_++;
+  if (IsBuffered()) {
+    if (number_of_values_ < zigzag_values_.length()) {
+      gamma_bits_ += EliasGammaCodec::Length((uint32_t)ZigZagCodec::Encode(q) + 1);
+      zigzag_values_[number_of_values_++] = (uint32_t)ZigZagCodec::Encode(q);
+    }
+    return;
   }
-  
-  // IAR适配：使用float替代double，减少计算开销
-  int32_t q = (int32_t)roundf((v - pre_value_) / (2.0f * kMaxDiff));
-  float recoverValue = pre_value_ + 2.0f * kMaxDiff * (float)q;
   
   int32_t zigzag_value = ZigZagCodec::Encode(q) + 1;
   int bits_written = EliasGammaCodec::Encode(zigzag_value, output_bit_stream_);
   compressed_size_in_bits_ += bits_written;
-  pre_value_ = recoverValue;
+}
+
+bool SerfQtCompressor::IsBuffered() const {
+  return kCoder != kSerfQtCoderEliasGamma || kSelectPredictor;
+}
+
+uint8_t SerfQtCompressor::HeaderBits(SerfQtCoder coder) const {
+  // len和max_diff；其余block还有coder字段，以及非默认预测器的扩展字段
+  uint8_t bits = 16 + 32;
+  if (coder == kSerfQtCoderEliasGamma && predictor_ == kSerfQtPredictorPrevious) {
+    return bits;
+  }
+  bits += 2;
+  if (predictor_ != kSerfQtPredictorPrevious) {
+    bits += 2 + 2;
+  }
+  if (predictor_ == kSerfQtPredictorLinear) {
+    bits += QtPredictor::kCoefficientBits;
+  }
+  return bits;
+}
+
+void SerfQtCompressor::WriteHeader(SerfQtCoder coder) {
+  compressed_size_in_bits_ += output_bit_stream_->WriteInt(kBlockSize, 16);
+  uint32_t max_diff_bits = Double::FloatToLongBits(kMaxDiff);
+  // 默认的Elias Gamma block与没有coder字段的格式逐位相同
+  if (coder == kSerfQtCoderEliasGamma && predictor_ == kSerfQtPredictorPrevious) {
+    compressed_size_in_bits_ += output_bit_stream_->WriteLong(max_diff_bits, 32);
+    return;
+  }
+  compressed_size_in_bits_ += output_bit_stream_->WriteLong(max_diff_bits | kSerfQtExtendedHeaderFlag, 32);
+  if (predictor_ == kSerfQtPredictorPrevious) {
+    compressed_size_in_bits_ += output_bit_stream_->WriteInt(coder, 2);
+    return;
+  }
+  compressed_size_in_bits_ += output_bit_stream_->WriteInt(kSerfQtCoderFieldPredicted, 2);
+  compressed_size_in_bits_ += output_bit_stream_->WriteInt(coder, 2);
+  compressed_size_in_bits_ += output_bit_stream_->WriteInt(predictor_, 2);
+  if (predictor_ == kSerfQtPredictorLinear) {
+    compressed_size_in_bits_ += output_bit_stream_->WriteInt((uint8_t)coefficient_ & 0x0F,
+                                                             QtPredictor::kCoefficientBits);
+  }
+}
+
+void SerfQtCompressor::SelectPredictor() {
+  // 最小二乘拟合线性预测系数：c / 8 ≈ sum(q_i * q_(i-1)) / sum(q_(i-1)^2)
+  float correlation = 0;
+  float energy = 0;
+  for (uint16_t i = 2; i < number_of_values_; i++) {
+    float delta = (float)ZigZagCodec::Decode((int32_t)zigzag_values_[i]);
+    float previous_delta = (float)ZigZagCodec::Decode((int32_t)zigzag_values_[i - 1]);
+    correlation += delta * previous_delta;
+    energy += previous_delta * previous_delta;
+  }
+  int8_t coefficient = 0;
+  if (energy > 0) {
+    float fitted = roundf(8.0f * correlation / energy);
+    if (fitted < QtPredictor::kMinCoefficient) {
+      fitted = QtPredictor::kMinCoefficient;
+    } else if (fitted > QtPredictor::kMaxCoefficient) {
+      fitted = QtPredictor::kMaxCoefficient;
+    }
+    coefficient = (int8_t)fitted;
+  }
+
+  // 以Elias Gamma位数比较各预测器；前两个值没有可用的前一个差分，残差即q本身
+  uint32_t previous_bits = 0;
+  uint32_t delta_of_delta_bits = 0;
+  uint32_t linear_bits = 0;
+  int32_t previous_delta = 0;
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    int32_t delta = ZigZagCodec::Decode((int32_t)zigzag_values_[i]);
+    previous_bits += EliasGammaCodec::Length(zigzag_values_[i] + 1);
+    delta_of_delta_bits += EliasGammaCodec::Length(
+        ZigZagCodec::Encode(QtPredictor::Residual(delta, previous_delta)) + 1);
+    linear_bits += EliasGammaCodec::Length(
+        ZigZagCodec::Encode(QtPredictor::Residual(delta, QtPredictor::Linear(coefficient, previous_delta))) + 1);
+    previous_delta = i == 0 ? 0 : delta;
+  }
+
+  // 扩展字段的开销计入比较（相对不带coder字段的gamma block多6位），代价相同时取更简单的预测器
+  predictor_ = kSerfQtPredictorPrevious;
+  coefficient_ = 0;
+  if (delta_of_delta_bits + 6 < previous_bits) {
+    predictor_ = kSerfQtPredictorDeltaOfDelta;
+  }
+  if (linear_bits + 6 + QtPredictor::kCoefficientBits <
+      (predictor_ == kSerfQtPredictorPrevious ? previous_bits : delta_of_delta_bits + 6)) {
+    predictor_ = kSerfQtPredictorLinear;
+    coefficient_ = coefficient;
+  }
+  if (predictor_ == kSerfQtPredictorPrevious) {
+    return;
+  }
+
+  previous_delta = 0;
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    int32_t delta = ZigZagCodec::Decode((int32_t)zigzag_values_[i]);
+    int32_t prediction = predictor_ == kSerfQtPredictorDeltaOfDelta ?
+        previous_delta : QtPredictor::Linear(coefficient_, previous_delta);
+    zigzag_values_[i] = (uint32_t)ZigZagCodec::Encode(QtPredictor::Residual(delta, prediction));
+    previous_delta = i == 0 ? 0 : delta;
+  }
+}
+
+void SerfQtCompressor::EncodeGammaBlock() {
+  WriteHeader(kSerfQtCoderEliasGamma);
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    compressed_size_in_bits_ += EliasGammaCodec::Encode((int32_t)zigzag_values_[i] + 1, output_bit_stream_);
+  }
+  number_of_values_ = 0;
+}
+
+void SerfQtCompressor::EncodePackedBlock() {
+  uint32_t gamma_bits = 0;
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    gamma_bits += EliasGammaCodec::Length(zigzag_values_[i] + 1);
+  }
+  // packed负载从header之后的字节边界开始
+  uint32_t packed_bits = BitPackingCodec::EncodedBits(zigzag_values_.begin(), number_of_values_,
+                                                         HeaderBits(kSerfQtCoderPacked));
+  // 比较时计入header：gamma block可能不带coder字段
+  if (gamma_bits + HeaderBits(kSerfQtCoderEliasGamma) <= packed_bits + HeaderBits(kSerfQtCoderPacked)) {
+    EncodeGammaBlock();
+    return;
+  }
+  WriteHeader(kSerfQtCoderPacked);
+  compressed_size_in_bits_ += BitPackingCodec::Encode(zigzag_values_.begin(), number_of_values_, output_bit_stream_);
+  number_of_values_ = 0;
+}
+
+void SerfQtCompressor::EncodeRansBlock() {
+  uint16_t histogram[RansCodec::kAlphabetSize];
+  memset(histogram, 0, sizeof(histogram));
+  Array<uint8_t> symbols(number_of_values_);
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    uint32_t zigzag = zigzag_values_[i];
+    uint8_t symbol = zigzag < RansCodec::kEscapeSymbol ? (uint8_t)zigzag : RansCodec::kEscapeSymbol;
+    symbols[i] = symbol;
+    ++histogram[symbol];
+  }
+
+  // 选择静态表或本block的自适应表中较小者（自适应表需额外传输）
+  uint16_t adaptive_freq[RansCodec::kAlphabetSize];
+  RansCodec::NormalizeFrequencies(histogram, adaptive_freq);
+  uint32_t static_bits = RansCodec::EstimateBits(histogram, RansCodec::kStaticFrequencies);
+  uint32_t adaptive_bits = RansCodec::EstimateBits(histogram, adaptive_freq);
+  for (uint8_t s = 0; s < RansCodec::kAlphabetSize; s++) {
+    adaptive_bits += EliasGammaCodec::Length(adaptive_freq[s] + 1);
+  }
+  bool use_adaptive_table = adaptive_bits < static_bits;
+  uint32_t rans_bits = 1 + (use_adaptive_table ? adaptive_bits : static_bits);
+
+  // 短block上rANS的最终状态和码表开销可能超过收益，此时整个block退回Elias Gamma
+  uint32_t gamma_bits = 0;
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    gamma_bits += EliasGammaCodec::Length(zigzag_values_[i] + 1);
+    if (symbols[i] == RansCodec::kEscapeSymbol) {
+      rans_bits += EliasGammaCodec::Length(zigzag_values_[i] - RansCodec::kEscapeSymbol + 1);
+    }
+  }
+  if (gamma_bits + HeaderBits(kSerfQtCoderEliasGamma) <= rans_bits + HeaderBits(kSerfQtCoderRans)) {
+    EncodeGammaBlock();
+    return;
+  }
+
+  WriteHeader(kSerfQtCoderRans);
+  const uint16_t *freq = RansCodec::kStaticFrequencies;
+  if (use_adaptive_table) {
+    freq = adaptive_freq;
+    compressed_size_in_bits_ += output_bit_stream_->WriteBit(true);
+    compressed_size_in_bits_ += RansCodec::WriteFrequencies(adaptive_freq, output_bit_stream_);
+  } else {
+    compressed_size_in_bits_ += output_bit_stream_->WriteBit(false);
+  }
+  compressed_size_in_bits_ += RansCodec::Encode(symbols.begin(), number_of_values_, freq, output_bit_stream_);
+
+  // 超出字母表的值作为escape，按顺序以Elias Gamma编码在rANS数据之后
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    if (symbols[i] == RansCodec::kEscapeSymbol) {
+      compressed_size_in_bits_ += EliasGammaCodec::Encode(
+          (int32_t)(zigzag_values_[i] - RansCodec::kEscapeSymbol + 1), output_bit_stream_);
+    }
+  }
+  number_of_values_ = 0;
 }
 
 const Array<uint8_t>& SerfQtCompressor::compressed_bytes() const {
   return compressed_bytes_;
 }
 
-void SerfQtCompressor::Close() {
+bool SerfQtCompressor::Close() {
+  if (IsBuffered() && !first_) {
+    if (kSelectPredictor) {
+      SelectPredictor();
+    }
+    if (kCoder == kSerfQtCoderRans) {
+      EncodeRansBlock();
+    } else if (kCoder == kSerfQtCoderPacked) {
+      EncodePackedBlock();
+    } else {
+      EncodeGammaBlock();
+    }
+  }
   output_bit_stream_->Flush();
   uint32_t buffer_len = (uint32_t)ceilf(compressed_size_in_bits_ / 8.0f);
   
@@ -48,31 +398,40 @@ void SerfQtCompressor::Close() {
     compressed_bytes_ = Array<uint8_t>(0);
   }
   
-  // 创建新的缓冲区 - 使用swap避免赋值操作符的问题
-  Array<uint8_t> temp_array(buffer_len);
-  if (temp_array.is_valid()) {
+  // AddValue()按最坏情况拒绝放不下的值，溢出只在缓冲区分配失败时发生
+  bool ok = !output_bit_stream_->overflowed();
+  if (!ok) {
+    printf("Close: block of %lu bits exceeds the bit stream buffer\n", (unsigned long)compressed_size_in_bits_);
+  } else if (buffer_len > 0) {
+    // 创建新的缓冲区 - 使用swap避免赋值操作符的问题
+    Array<uint8_t> temp_array(buffer_len);
     compressed_bytes_.swap(temp_array);
+    // 直接复制数据到compressed_bytes_，避免临时对象
+    ok = compressed_bytes_.is_valid() &&
+         output_bit_stream_->CopyBufferTo(compressed_bytes_.begin(), compressed_bytes_.length());
+    if (!ok) {
+      printf("Close: cannot copy a block of %lu bytes\n", (unsigned long)buffer_len);
+      compressed_bytes_ = Array<uint8_t>(0);
+    } else {
+      // header中的len写的是block_size，改为实际的值个数
+      OutputBitStream::PatchBlockCount(compressed_bytes_, number_of_values_this_block_);
+    }
   }
-  
-  if (!compressed_bytes_.is_valid()) {
-    output_bit_stream_->Refresh();
-    first_ = true;
-    pre_value_ = 2.0f;
-    stored_compressed_size_in_bits_ = compressed_size_in_bits_;
-    compressed_size_in_bits_ = 0;
-    return;
-  }
-  
-  // 直接复制数据到compressed_bytes_，避免临时对象
-  uint8_t* dest_ptr = compressed_bytes_.begin();
-  bool copy_success = output_bit_stream_->CopyBufferTo(dest_ptr, buffer_len);
-  if (!copy_success) {
-    printf("Close: CopyBufferTo failed\n");
-  }
-  
+  ResetBlock();
+  return ok;
+}
+
+// 无论block是否成功取出，下一个block都从初始状态开始
+void SerfQtCompressor::ResetBlock() {
   output_bit_stream_->Refresh();
   first_ = true;
   pre_value_ = 2.0f;
+  position_ = 0;
+  predictor_ = kSerfQtPredictorPrevious;
+  coefficient_ = 0;
+  number_of_values_ = 0;
+  number_of_values_this_block_ = 0;
+  gamma_bits_ = 0;
   stored_compressed_size_in_bits_ = compressed_size_in_bits_;
   compressed_size_in_bits_ = 0;
 }
@@ -81,6 +440,77 @@ uint32_t SerfQtCompressor::get_compressed_size_in_bits() const {
   return stored_compressed_size_in_bits_;
 }
 
+Array<uint8_t> SerfQtCompressor::SaveState() const {
+  StateWriter writer(64);
+  writer.PutVarint(kStateTag);
+  writer.PutVarint(kBlockSize);
+  writer.PutFloat(kMaxDiff);
+  writer.PutVarint(kCoder);
+  writer.PutVarint(kSelectPredictor ? 1 : 0);
+  writer.PutVarint(kPowerOfTwoBound ? 1 : 0);
+
+  writer.PutVarint(first_ ? 1 : 0);
+  writer.PutVarint((uint32_t)position_);
+  writer.PutVarint(compressed_size_in_bits_);
+  writer.PutVarint(stored_compressed_size_in_bits_);
+  writer.PutVarint(number_of_values_this_block_);
+  writer.PutVarint(number_of_values_);
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    writer.PutVarint(zigzag_values_[i]);
+  }
+  output_bit_stream_->SaveState(&writer);
+  return writer.Finish();
+}
+
+bool SerfQtCompressor::LoadState(const Array<uint8_t> &snapshot) {
+  StateReader reader(snapshot);
+  if (reader.GetVarint() != kStateTag || reader.GetVarint() != kBlockSize ||
+      reader.GetFloat() != kMaxDiff || reader.GetVarint() != (uint32_t)kCoder ||
+      reader.GetVarint() != (kSelectPredictor ? 1u : 0u) ||
+      reader.GetVarint() != (kPowerOfTwoBound ? 1u : 0u)) {
+    return false;
+  }
+
+  // 先解析到临时变量，整个快照读取成功后再替换，截断或损坏的快照不改变压缩器
+  bool first = reader.GetVarint() != 0;
+  int32_t position = (int32_t)reader.GetVarint();
+  uint32_t compressed_size_in_bits = reader.GetVarint();
+  uint32_t stored_compressed_size_in_bits = reader.GetVarint();
+  uint32_t number_of_values_this_block = reader.GetVarint();
+  uint32_t number_of_values = reader.GetVarint();
+  if (!reader.ok() || number_of_values_this_block > kBlockSize || number_of_values > zigzag_values_.length()) {
+    return false;
+  }
+  Array<uint32_t> zigzag_values(number_of_values);
+  for (uint16_t i = 0; i < (uint16_t)number_of_values; i++) {
+    zigzag_values[i] = reader.GetVarint();
+  }
+  if (!reader.ok()) {
+    return false;
+  }
+  OutputBitStream *output_bit_stream = new OutputBitStream(output_bit_stream_->capacity());
+  if (!output_bit_stream->LoadState(&reader) || !reader.finished()) {
+    delete output_bit_stream;
+    return false;
+  }
+
+  first_ = first;
+  position_ = position;
+  pre_value_ = RecoverValue(position_);
+  compressed_size_in_bits_ = compressed_size_in_bits;
+  stored_compressed_size_in_bits_ = stored_compressed_size_in_bits;
+  number_of_values_this_block_ = (uint16_t)number_of_values_this_block;
+  number_of_values_ = (uint16_t)number_of_values;
+  gamma_bits_ = 0;
+  for (uint16_t i = 0; i < number_of_values_; i++) {
+    zigzag_values_[i] = zigzag_values[i];
+    gamma_bits_ += EliasGammaCodec::Length(zigzag_values_[i] + 1);
+  }
+  delete output_bit_stream_;
+  output_bit_stream_ = output_bit_stream;
+  return true;
+}
+
 // 析构函数
 SerfQtCompressor::~SerfQtCompressor() {
   if (output_bit_stream_ != NULL) {
@@ -11,37 +11,160 @@
 #include "../utils/double.h"
 #include "../utils/elias_gamma_codec.h"
 #include "../utils/zig_zag_codec.h"
+#include "../utils/perf_counters.h"
+#include "../utils/rans_codec.h"
+#include "../utils/bit_packing_codec.h"
+#include "../utils/qt_predictor.h"
+#include "../utils/power_of_two_bound.h"
+#include "../utils/state_snapshot.h"
 
 /*
  * +------------+-----------------+---------------+
- * |16bits - len|64bits - max_diff|Encoded Content|
+ * |16bits - len|32bits - max_diff|Encoded Content|
  * +------------+-----------------+---------------+
+ *
+ * max_diff is always positive, so its sign bit is free and serves as the extension flag. A block that is Elias gamma
+ * with the previous-value predictor leaves it clear and has exactly the layout above. Any other block sets it and
+ * continues with a 2-bit coder field (SerfQtCoder) before the content:
+ * +------------+--------------------------------+--------------+---------------+
+ * |16bits - len|1bit - 1 |31bits - max_diff      |2bits - coder |Encoded Content|
+ * +------------+--------------------------------+--------------+---------------+
+ *
+ * kSerfQtCoderEliasGamma: one Elias gamma code per value, written as values arrive.
+ * kSerfQtCoderRans: the block is buffered and written on Close(), as a plain Elias gamma block when that is
+ * smaller for this block, otherwise as
+ * +---------------+-----------------------+------------+----------------------------+
+ * |1bit - table   |gamma freq (if table=1)|rANS payload|gamma of escaped values     |
+ * +---------------+-----------------------+------------+----------------------------+
+ * where table=0 selects RansCodec::kStaticFrequencies and table=1 a per-block table, whichever is smaller.
+ * kSerfQtCoderPacked: the block is buffered as well and written either as Elias gamma or, when smaller, as
+ * zigzag values in BitPackingCodec mini-blocks, which decode without a data-dependent branch.
+ *
+ * The i-th value is reconstructed as 2 + 2 * max_diff * (q_0 + ... + q_i): the q are summed as integers, so the
+ * float rounding of the reconstruction does not accumulate over the block, and a decoder can recover a whole block
+ * with a prefix sum instead of a serial chain of float additions.
+ *
+ * With select_predictor the block is buffered and, on Close(), q_i is replaced by its residual against a prediction
+ * from q_(i-1) (SerfQtPredictor, for i >= 2), whichever predictor gives the fewest Elias gamma bits. A block whose
+ * predictor is not kSerfQtPredictorPrevious has the coder field set to kSerfQtCoderFieldPredicted and continues
+ * +--------------+------------------+---------------------------------+
+ * |2bits - coder |2bits - predictor |4bits - coefficient (linear only)|
+ * +--------------+------------------+---------------------------------+
+ * so blocks with the previous-value predictor are unchanged. Predictors work on integer grid positions only, and
+ * the max_diff guarantee is the same for all of them.
+ *
+ * len is the number of values in the block, at most block_size. A value that would not fit the bit stream buffer
+ * is rejected by AddValue() and the block can be closed without it, so a block is never truncated.
  */
 
+enum SerfQtCoder {
+  kSerfQtCoderEliasGamma = 0,
+  kSerfQtCoderRans = 1,
+  kSerfQtCoderPacked = 2
+};
+
+/*
+ * SERF-QT位流的格式版本。位流中不携带版本号，收发两端按固件版本约定：
+ * 1：Elias Gamma码字在n个0之后从number的LSB开始写，偶数无法正确解码；
+ * 2：码字为n个0、最高位的1和低n位（见EliasGammaCodec）。header与版本1相同，仅在max_diff符号位置位时多出coder字段。
+ * 版本2的解码端不能解码版本1的位流，反之亦然。SERF-QT-32、Net SERF-QT和轨迹压缩的码字随之变化。
+ */
+const uint8_t kSerfQtFormatVersion = 2;
+
+// max_diff的符号位：置位时header带coder字段
+const uint32_t kSerfQtExtendedHeaderFlag = 0x80000000UL;
+
+// coder字段的取值3：后接实际的coder和预测器
+const uint8_t kSerfQtCoderFieldPredicted = 3;
+
+enum SerfQtPredictor {
+  // q_i原样编码，即以前一个重建值为预测
+  kSerfQtPredictorPrevious = 0,
+  // q_i - q_(i-1)，匀速运动时接近0
+  kSerfQtPredictorDeltaOfDelta = 1,
+  // q_i - round(c * q_(i-1) / 8)，c按block拟合，见QtPredictor
+  kSerfQtPredictorLinear = 2
+};
+
 class SerfQtCompressor {
  public:
-  SerfQtCompressor(uint16_t block_size, float max_diff);
+  // select_predictor：每个block缓存后选择SerfQtPredictor，Elias Gamma模式下也需block_size * 4字节的缓存
+  // power_of_two_bound：误差界向下取到2的幂，量化和重建只调整指数域，不做浮点乘除；格式不变
+  SerfQtCompressor(uint16_t block_size, float max_diff, SerfQtCoder coder = kSerfQtCoderEliasGamma,
+                   bool select_predictor = false, bool power_of_two_bound = false);
+
+  // block已有block_size个值，或该值按最坏情况写不进位流缓冲区时返回false，不改变压缩器状态
+  bool AddValue(float v);
 
-  void AddValue(float v);
+  /*
+   * 块模式：结果与逐个AddValue()解压误差相同（不超过max_diff）。先对整段数据并行求量化网格位置
+   * round((v - 2) / (2 * max_diff))（宿主机支持时用AVX2，否则标量循环），与当前位置之差即为q；
+   * 只剩按位流写入的最后一遍是串行的。网格位置的重建值超出误差时该值退回AddValue()的算法，
+   * 因此在恰好位于两个网格中点的罕见值上，q可能与逐个AddValue()不同。8051上等同于逐个AddValue()。
+   * 返回接受的值个数，遇到第一个被拒绝的值即停止。
+   */
+  uint16_t AddValues(const float *values, uint16_t count);
 
   const Array<uint8_t>& compressed_bytes() const;
 
-  void Close();
+  // 写出当前block，len为实际的值个数；block超出位流缓冲区或无法分配输出时返回false，compressed_bytes()为空
+  bool Close();
 
   uint32_t get_compressed_size_in_bits() const;
 
+  // 当前未关闭block的快照（已写入的位、rANS模式下缓存的值），用于采集进程的检查点和故障切换
+  Array<uint8_t> SaveState() const;
+
+  // 须由相同参数构造的压缩器恢复；快照不匹配、截断或损坏时返回false，压缩器保持原状态
+  bool LoadState(const Array<uint8_t> &snapshot);
+
   // 析构函数
   ~SerfQtCompressor();
 
  private:
-  const float kMaxDiff;
+  // 'Q'和快照版本
+  static const uint16_t kStateTag = 0x5107;
+  // header的最大位数：len、max_diff、coder字段和线性预测器的扩展字段；Elias Gamma且不用预测器时只有len和max_diff
+  static const uint8_t kMaxHeaderBits = 16 + 32 + 2 + 2 + 2 + QtPredictor::kCoefficientBits;
+
   const uint16_t kBlockSize;
+  const float kMaxDiff;
+  const SerfQtCoder kCoder;
+  const bool kSelectPredictor;
+  const bool kPowerOfTwoBound;
+  // 2的幂模式下步长2 * max_diff的指数
+  const int16_t kStepExponent;
   bool first_;
   OutputBitStream* output_bit_stream_; // 使用指针替代std::unique_ptr
   Array<uint8_t> compressed_bytes_;
+  // 当前网格位置，即已编码q的累加和；重建值为2 + 2 * max_diff * position_
+  int32_t position_;
   float pre_value_;
   uint32_t compressed_size_in_bits_;
   uint32_t stored_compressed_size_in_bits_;
+  // rANS、packed模式或选择预测器时：缓存整个block的zigzag值，Close()时统一编码
+  Array<uint32_t> zigzag_values_;
+  uint16_t number_of_values_;
+  // 本block已接受的值个数，Close()时写入len
+  uint16_t number_of_values_this_block_;
+  // 缓存模式下本block按Elias Gamma编码的总位数，是Close()时各编码器输出的上限
+  uint32_t gamma_bits_;
+  // 本block选中的预测器，Close()时确定
+  SerfQtPredictor predictor_;
+  int8_t coefficient_;
+
+  bool IsBuffered() const;
+  uint8_t HeaderBits(SerfQtCoder coder) const;
+  void WriteHeader(SerfQtCoder coder);
+  void SelectPredictor();
+  bool Fits(int32_t q) const;
+  void EncodeQuantized(int32_t q);
+  float RecoverValue(int32_t position) const;
+  int32_t Quantize(float delta) const;
+  void EncodeGammaBlock();
+  void EncodeRansBlock();
+  void EncodePackedBlock();
+  void ResetBlock();
 };
 
 #endif  // SERF_QT_COMPRESSOR_H
@@ -0,0 +1,99 @@
+#include "serf_qt_fixed_compressor.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+SerfQtFixedCompressor::SerfQtFixedCompressor(uint16_t block_size, int32_t max_diff, float unit)
+    : kBlockSize(block_size) {
+  // 2^shift不超过1.5 * max_diff的最大shift，半步长不超过max_diff的3/4
+  uint32_t limit = max_diff > 0 ? (uint32_t)max_diff + (uint32_t)max_diff / 2 : 0;
+  step_shift_ = 0;
+  while (step_shift_ < 30 && ((uint32_t)1 << (step_shift_ + 1)) <= limit) {
+    step_shift_++;
+  }
+  // 以下浮点运算只在构造时执行一次；乘以2的幂是精确的
+  max_diff_bits_ = Double::FloatToLongBits(unit * (float)((uint32_t)1 << step_shift_) * 0.5f);
+  offset_ = (int32_t)(2.0f / unit + 0.5f);
+
+  // 与SerfQtCompressor的Elias Gamma模式相同
+  uint32_t buffer_size = SERF_QT_BLOCK_BUFFER_BYTES(block_size);
+  if (buffer_size > SERF_BIT_STREAM_MAX_BYTES) {
+    buffer_size = SERF_BIT_STREAM_MAX_BYTES;
+  }
+  output_bit_stream_ = new OutputBitStream(buffer_size);
+  first_ = true;
+  position_ = 0;
+  compressed_size_in_bits_ = 0;
+  stored_compressed_size_in_bits_ = 0;
+  number_of_values_this_block_ = 0;
+}
+
+bool SerfQtFixedCompressor::AddValue(int32_t value) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  // 最近的网格位置：加半步长后算术右移，即round((value - offset) / 2^shift)
+  int32_t half_step = (int32_t)(((uint32_t)1 << step_shift_) >> 1);
+  int32_t position = (value - offset_ + half_step) >> step_shift_;
+  int32_t q = position - position_;
+  int32_t zigzag_value = ZigZagCodec::Encode(q) + 1;
+
+  uint32_t bits = compressed_size_in_bits_ + (first_ ? 16 + 32 : 0) + EliasGammaCodec::Length((uint32_t)zigzag_value);
+  if (number_of_values_this_block_ >= kBlockSize || bits > output_bit_stream_->capacity() * 8) {
+    return false;
+  }
+  if (first_) {
+    first_ = false;
+    compressed_size_in_bits_ += output_bit_stream_->WriteInt(kBlockSize, 16);
+    compressed_size_in_bits_ += output_bit_stream_->WriteLong(max_diff_bits_, 32);
+  }
+  position_ = position;
+  number_of_values_this_block_++;
+  compressed_size_in_bits_ += EliasGammaCodec::Encode(zigzag_value, output_bit_stream_);
+  return true;
+}
+
+const Array<uint8_t>& SerfQtFixedCompressor::compressed_bytes() const {
+  return compressed_bytes_;
+}
+
+bool SerfQtFixedCompressor::Close() {
+  output_bit_stream_->Flush();
+  uint32_t buffer_len = (compressed_size_in_bits_ + 7) / 8;
+
+  // AddValue()已拒绝放不下的值，溢出只在缓冲区分配失败时发生
+  bool ok = !output_bit_stream_->overflowed();
+  Array<uint8_t> temp_array(ok ? buffer_len : 0);
+  compressed_bytes_.swap(temp_array);
+  if (!ok) {
+    printf("Close: block of %lu bits exceeds the bit stream buffer\n", (unsigned long)compressed_size_in_bits_);
+  } else if (buffer_len > 0) {
+    ok = compressed_bytes_.is_valid() &&
+         output_bit_stream_->CopyBufferTo(compressed_bytes_.begin(), compressed_bytes_.length());
+    if (!ok) {
+      printf("Close: cannot copy a block of %lu bytes\n", (unsigned long)buffer_len);
+      compressed_bytes_ = Array<uint8_t>(0);
+    } else {
+      OutputBitStream::PatchBlockCount(compressed_bytes_, number_of_values_this_block_);
+    }
+  }
+
+  output_bit_stream_->Refresh();
+  first_ = true;
+  position_ = 0;
+  number_of_values_this_block_ = 0;
+  stored_compressed_size_in_bits_ = compressed_size_in_bits_;
+  compressed_size_in_bits_ = 0;
+  return ok;
+}
+
+uint32_t SerfQtFixedCompressor::get_compressed_size_in_bits() const {
+  return stored_compressed_size_in_bits_;
+}
+
+uint8_t SerfQtFixedCompressor::step_shift() const {
+  return step_shift_;
+}
+
+SerfQtFixedCompressor::~SerfQtFixedCompressor() {
+  if (output_bit_stream_ != NULL) {
+    delete output_bit_stream_;
+  }
+}
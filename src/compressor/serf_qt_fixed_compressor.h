@@ -0,0 +1,60 @@
+#ifndef SERF_QT_FIXED_COMPRESSOR_H
+#define SERF_QT_FIXED_COMPRESSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../utils/output_bit_stream.h"
+#include "../utils/array.h"
+#include "../utils/double.h"
+#include "../utils/elias_gamma_codec.h"
+#include "../utils/zig_zag_codec.h"
+#include "../utils/perf_counters.h"
+#include "serf_qt_compressor.h"
+
+/*
+ * SERF-QT on pre-scaled integers for targets without an FPU: a value is an int32 count of unit (e.g. 1e-6 degree
+ * for GPS), and max_diff is given in the same units. Quantization is an add and a shift on the integer only; the
+ * grid step is the power of two 2^shift units with 2^shift <= 1.5 * max_diff, so the float decoder's rounding
+ * always has at least max_diff / 4 of slack.
+ *
+ * Blocks are ordinary kSerfQtCoderEliasGamma SERF-QT blocks whose header max_diff is 2^(shift-1) * unit, so
+ * SerfQtDecompressor decodes them unchanged and recovers value * unit within max_diff * unit, as long as that
+ * bound is above the float resolution of the values. Values must stay within +-(2^31 - 2 / unit).
+ */
+class SerfQtFixedCompressor {
+ public:
+  SerfQtFixedCompressor(uint16_t block_size, int32_t max_diff, float unit);
+
+  // 与SerfQtCompressor::AddValue()相同，block已满或写不进位流缓冲区时返回false
+  bool AddValue(int32_t value);
+
+  const Array<uint8_t>& compressed_bytes() const;
+
+  // 与SerfQtCompressor::Close()相同，len为实际的值个数
+  bool Close();
+
+  uint32_t get_compressed_size_in_bits() const;
+
+  // 网格步长为2^step_shift()个单位
+  uint8_t step_shift() const;
+
+  ~SerfQtFixedCompressor();
+
+ private:
+  const uint16_t kBlockSize;
+  uint8_t step_shift_;
+  // 解压端的2.0f偏移，换算为单位数
+  int32_t offset_;
+  uint32_t max_diff_bits_;
+  bool first_;
+  OutputBitStream* output_bit_stream_;
+  Array<uint8_t> compressed_bytes_;
+  // 当前网格位置，与SerfQtCompressor相同
+  int32_t position_;
+  uint32_t compressed_size_in_bits_;
+  uint32_t stored_compressed_size_in_bits_;
+  uint16_t number_of_values_this_block_;
+};
+
+#endif  // SERF_QT_FIXED_COMPRESSOR_H
@@ -0,0 +1,169 @@
+#include "serf_trajectory_compressor.h"
+#include <stdio.h>
+
+SerfTrajectoryCompressor::SerfTrajectoryCompressor(uint16_t block_size, float max_diff_latitude,
+                                                   float max_diff_longitude)
+    : kMaxDiffLatitude(max_diff_latitude * 0.999f),
+      kMaxDiffLongitude(max_diff_longitude * 0.999f) {
+  Array<trajectory_point_t> temp_points(block_size);
+  points_.swap(temp_points);
+  if (!points_.is_valid()) {
+    printf("SerfTrajectoryCompressor: ERROR - failed to allocate %u points\n", block_size);
+  }
+  number_of_points_ = 0;
+  previous_predictor_bits_ = 0;
+  recovered_latitude_ = 0;
+  recovered_longitude_ = 0;
+  stored_compressed_size_in_bits_ = 0;
+}
+
+// 以pred为预测值量化v，recovered返回解压端将得到的值
+static uint32_t QuantizeResidual(float v, float pred, float max_diff, float *recovered) {
+  int32_t q = (int32_t)roundf((v - pred) / (2.0f * max_diff));
+  *recovered = pred + 2.0f * max_diff * (float)q;
+  return (uint32_t)ZigZagCodec::Encode(q);
+}
+
+bool SerfTrajectoryCompressor::AddPoint(const trajectory_point_t &point) {
+  if (number_of_points_ >= points_.length()) {
+    return false;
+  }
+  float recovered_latitude = point.latitude;
+  float recovered_longitude = point.longitude;
+  uint32_t bits = 0;
+  if (number_of_points_ > 0) {
+    uint32_t latitude_zigzag = QuantizeResidual(point.latitude, recovered_latitude_, kMaxDiffLatitude,
+                                                &recovered_latitude);
+    uint32_t longitude_zigzag = QuantizeResidual(point.longitude, recovered_longitude_, kMaxDiffLongitude,
+                                                 &recovered_longitude);
+    bits = EliasGammaCodec::Length(latitude_zigzag + 1) + EliasGammaCodec::Length(longitude_zigzag + 1);
+  }
+  // Close()按块长度分配位流，不超过SERF_BIT_STREAM_MAX_BYTES
+  if (kHeaderBits + 64 + previous_predictor_bits_ + bits > SERF_BIT_STREAM_MAX_BYTES * 8) {
+    return false;
+  }
+  previous_predictor_bits_ += bits;
+  recovered_latitude_ = recovered_latitude;
+  recovered_longitude_ = recovered_longitude;
+  points_[number_of_points_++] = point;
+  return true;
+}
+
+// 按predictor编码第1个点之后的残差，返回位数；output_bit_stream为NULL时只统计，still_points返回两个残差均为0的点数
+uint32_t SerfTrajectoryCompressor::EncodeResiduals(uint8_t predictor, bool still_flag,
+                                                   OutputBitStream *output_bit_stream, uint16_t *still_points) {
+  float latitude = points_[0].latitude;
+  float before_latitude = latitude;
+  float longitude = points_[0].longitude;
+  float before_longitude = longitude;
+  uint32_t size_in_bits = 0;
+  uint16_t still_count = 0;
+
+  for (uint16_t i = 1; i < number_of_points_; i++) {
+    float recovered_latitude;
+    float recovered_longitude;
+    uint32_t latitude_zigzag = QuantizeResidual(
+        points_[i].latitude, SerfTrajectoryPredict(predictor, latitude, before_latitude),
+        kMaxDiffLatitude, &recovered_latitude);
+    uint32_t longitude_zigzag = QuantizeResidual(
+        points_[i].longitude, SerfTrajectoryPredict(predictor, longitude, before_longitude),
+        kMaxDiffLongitude, &recovered_longitude);
+    before_latitude = latitude;
+    latitude = recovered_latitude;
+    before_longitude = longitude;
+    longitude = recovered_longitude;
+
+    bool moved = latitude_zigzag != 0 || longitude_zigzag != 0;
+    if (!moved) {
+      still_count++;
+    }
+    if (still_flag) {
+      size_in_bits += 1;
+      if (output_bit_stream != NULL) {
+        output_bit_stream->WriteBit(moved);
+      }
+      if (!moved) {
+        continue;
+      }
+    }
+    if (output_bit_stream != NULL) {
+      size_in_bits += EliasGammaCodec::Encode((int32_t)latitude_zigzag + 1, output_bit_stream);
+      size_in_bits += EliasGammaCodec::Encode((int32_t)longitude_zigzag + 1, output_bit_stream);
+    } else {
+      size_in_bits += EliasGammaCodec::Length(latitude_zigzag + 1) + EliasGammaCodec::Length(longitude_zigzag + 1);
+    }
+  }
+
+  if (still_points != NULL) {
+    *still_points = still_count;
+  }
+  return size_in_bits;
+}
+
+const Array<uint8_t>& SerfTrajectoryCompressor::compressed_bytes() const {
+  return compressed_bytes_;
+}
+
+bool SerfTrajectoryCompressor::Close() {
+  // 两种预测器各统计一遍；静止点在still=1时只占1位（否则为两个1位的gamma码），其余点多1位
+  uint8_t predictor = kSerfTrajectoryPredictorPrevious;
+  bool still_flag = false;
+  uint32_t residual_bits = 0;
+  if (number_of_points_ > 1) {
+    residual_bits = 0xFFFFFFFFUL;
+    for (uint8_t candidate = kSerfTrajectoryPredictorPrevious; candidate <= kSerfTrajectoryPredictorVelocity;
+         candidate++) {
+      uint16_t still_points;
+      uint32_t bits = EncodeResiduals(candidate, false, NULL, &still_points);
+      uint32_t bits_with_still_flag = bits + (number_of_points_ - 1) - 2 * still_points;
+      if (bits < residual_bits) {
+        residual_bits = bits;
+        predictor = candidate;
+        still_flag = false;
+      }
+      if (bits_with_still_flag < residual_bits) {
+        residual_bits = bits_with_still_flag;
+        predictor = candidate;
+        still_flag = true;
+      }
+    }
+  }
+
+  // 块长度在选择后已知，按精确大小分配
+  uint32_t size_in_bits = kHeaderBits + (number_of_points_ > 0 ? 64 + residual_bits : 0);
+  OutputBitStream output_bit_stream(size_in_bits / 8 + 1);
+  output_bit_stream.WriteInt(number_of_points_, 16);
+  output_bit_stream.WriteLong(Double::FloatToLongBits(kMaxDiffLatitude), 32);
+  output_bit_stream.WriteLong(Double::FloatToLongBits(kMaxDiffLongitude), 32);
+  output_bit_stream.WriteBit(predictor == kSerfTrajectoryPredictorVelocity);
+  output_bit_stream.WriteBit(still_flag);
+  if (number_of_points_ > 0) {
+    output_bit_stream.WriteLong(Double::FloatToLongBits(points_[0].latitude), 32);
+    output_bit_stream.WriteLong(Double::FloatToLongBits(points_[0].longitude), 32);
+    EncodeResiduals(predictor, still_flag, &output_bit_stream, NULL);
+  }
+  output_bit_stream.Flush();
+
+  uint32_t buffer_len = (size_in_bits + 7) / 8;
+  // AddPoint()已拒绝写不下的点，溢出只在缓冲区分配失败时发生
+  bool ok = !output_bit_stream.overflowed();
+  Array<uint8_t> temp_array(ok ? buffer_len : 0);
+  compressed_bytes_.swap(temp_array);
+  if (!ok) {
+    printf("Close: block of %lu bits exceeds the bit stream buffer\n", (unsigned long)size_in_bits);
+  } else if (compressed_bytes_.is_valid()) {
+    output_bit_stream.CopyBufferTo(compressed_bytes_.begin(), compressed_bytes_.length());
+  } else {
+    printf("Close: cannot create array of size %lu\n", (unsigned long)buffer_len);
+    ok = false;
+  }
+
+  stored_compressed_size_in_bits_ = size_in_bits;
+  number_of_points_ = 0;
+  previous_predictor_bits_ = 0;
+  return ok;
+}
+
+uint32_t SerfTrajectoryCompressor::get_compressed_size_in_bits() const {
+  return stored_compressed_size_in_bits_;
+}
@@ -0,0 +1,75 @@
+#ifndef SERF_TRAJECTORY_COMPRESSOR_H
+#define SERF_TRAJECTORY_COMPRESSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "../utils/output_bit_stream.h"
+#include "../utils/array.h"
+#include "../utils/double.h"
+#include "../utils/elias_gamma_codec.h"
+#include "../utils/zig_zag_codec.h"
+#include "../utils/file_reader.h"
+
+/*
+ * SERF-QT over (latitude, longitude) pairs: one header per block, both residuals of a point written next to
+ * each other.
+ *
+ * +------------+---------------------+---------------------+-------------+--------------+-----------------+-----------------+---------------+
+ * |16bits - len|32bits - max_diff_lat|32bits - max_diff_lon|1bit - pred  |1bit - still  |32bits - lat[0]  |32bits - lon[0]  |Encoded Content|
+ * +------------+---------------------+---------------------+-------------+--------------+-----------------+-----------------+---------------+
+ *
+ * The first point is stored exactly. Every following point is quantized against a prediction from the
+ * already recovered points: pred=0 uses the previous point, pred=1 extrapolates the previous movement vector.
+ * When still=1 each point starts with a bit telling whether it moved; a point that did not move has no
+ * residuals. The compressor picks pred and still per block, whichever gives the smallest block.
+ */
+
+enum SerfTrajectoryPredictor {
+  kSerfTrajectoryPredictorPrevious = 0,
+  kSerfTrajectoryPredictorVelocity = 1
+};
+
+// 压缩端与解压端共用，保证两端预测值逐位一致
+static inline float SerfTrajectoryPredict(uint8_t predictor, float previous, float before_previous) {
+  if (predictor == kSerfTrajectoryPredictorVelocity) {
+    return previous + (previous - before_previous);
+  }
+  return previous;
+}
+
+class SerfTrajectoryCompressor {
+ public:
+  static const uint8_t kHeaderBits = 16 + 32 + 32 + 1 + 1;
+
+  SerfTrajectoryCompressor(uint16_t block_size, float max_diff_latitude, float max_diff_longitude);
+
+  // block已有block_size个点，或按前一点预测时该点写不进位流缓冲区时返回false
+  bool AddPoint(const trajectory_point_t &point);
+
+  const Array<uint8_t>& compressed_bytes() const;
+
+  // block超出位流缓冲区或无法分配输出时返回false，compressed_bytes()为空
+  bool Close();
+
+  uint32_t get_compressed_size_in_bits() const;
+
+ private:
+  const float kMaxDiffLatitude;
+  const float kMaxDiffLongitude;
+  // 整个block缓存到Close()，以便选择预测器
+  Array<trajectory_point_t> points_;
+  uint16_t number_of_points_;
+  // 按pred=0、still=0编码的残差位数和解压端的重建点；Close()选出的编码不会更长
+  uint32_t previous_predictor_bits_;
+  float recovered_latitude_;
+  float recovered_longitude_;
+  Array<uint8_t> compressed_bytes_;
+  uint32_t stored_compressed_size_in_bits_;
+
+  uint32_t EncodeResiduals(uint8_t predictor, bool still_flag, OutputBitStream *output_bit_stream,
+                           uint16_t *still_points);
+};
+
+#endif  // SERF_TRAJECTORY_COMPRESSOR_H
@@ -0,0 +1,227 @@
+#include "serf_xor_batch_compressor.h"
+
+namespace {
+
+// positions behind kSerfXORDefaultTableSet
+const Array<int> kDefaultLeadPositions = {0, 8, 12, 16, 18, 20, 22, 24};
+const Array<int> kDefaultTrailPositions = {0, 22, 28, 32, 36, 40, 42, 46};
+
+}  // namespace
+
+SerfXORBatchCompressor::SerfXORBatchCompressor(uint32_t number_of_series, int block_size, int window_size,
+                                               double max_diff, long adjust_digit) :
+    kNumberOfSeries(number_of_series), kBlockSize(std::min<int>(block_size, OutputBitStream::kMaxBlockValues)),
+    kWindowSize(window_size), kMaxDiff(max_diff), kAdjustDigit(adjust_digit),
+    stored_vals_(number_of_series, Double::DoubleToLongBits(2)),
+    stored_leading_zeros_(number_of_series, UINT8_MAX),
+    stored_trailing_zeros_(number_of_series, UINT8_MAX),
+    table_set_ids_(number_of_series, 0),
+    compressed_sizes_this_block_(number_of_series, 0),
+    distributions_(static_cast<size_t>(number_of_series) * 128, 0),
+    // 16-bit count, update flag and two sets of up to 32 positions, then at most 76 bits per value: case 00 with
+    // 5-bit lead and trail codes and no zeros to strip
+    output_buffers_(number_of_series, OutputBitStream((kBlockSize * 76 + 16 + 1 + 2 * (5 + 6 * 32) + 7) / 8)),
+    compressed_sizes_last_block_(number_of_series, 0),
+    compressed_sizes_this_window_(number_of_series, 0),
+    compression_ratios_last_window_(number_of_series, 0),
+    compressed_bytes_last_block_(number_of_series) {
+  table_sets_.push_back(kSerfXORDefaultTableSet);
+  table_set_references_.push_back(number_of_series);
+  table_set_keys_.emplace_back(PositionMask(kDefaultLeadPositions), PositionMask(kDefaultTrailPositions),
+                               kSerfXORDefaultTableSet.leading_bits_per_value,
+                               kSerfXORDefaultTableSet.trailing_bits_per_value);
+  table_set_ids_by_key_.emplace(table_set_keys_[0], 0);
+
+  for (uint32_t s = 0; s < kNumberOfSeries; ++s) {
+    compressed_sizes_this_block_[s] = output_buffers_[s].WriteBlockCountPlaceholder();
+    compressed_sizes_this_block_[s] += output_buffers_[s].WriteInt(0, 1);
+  }
+}
+
+bool SerfXORBatchCompressor::AddValues(const double *values) {
+  if (SERF_UNLIKELY(number_of_values_this_block_ >= kBlockSize)) {
+    return false;
+  }
+  for (uint32_t s = 0; s < kNumberOfSeries; ++s) {
+    double v = values[s];
+    uint64_t stored_val = stored_vals_[s];
+    uint64_t this_val;
+    if (SERF_LIKELY(std::abs(Double::LongBitsToDouble(stored_val) - kAdjustDigit - v) > kMaxDiff)) {
+      double adjust_value = v + kAdjustDigit;
+      this_val = SerfUtils64::FindAppLong(adjust_value - kMaxDiff, adjust_value + kMaxDiff, v, stored_val,
+                                          kMaxDiff, kAdjustDigit);
+    } else {
+      this_val = stored_val;
+    }
+    compressed_sizes_this_block_[s] += CompressValue(s, this_val);
+    stored_vals_[s] = this_val;
+  }
+  ++number_of_values_this_block_;
+  ++number_of_values_this_window_;
+  return true;
+}
+
+bool SerfXORBatchCompressor::Close() {
+  bool ok = true;
+  for (uint32_t s = 0; s < kNumberOfSeries; ++s) {
+    OutputBitStream &output_buffer = output_buffers_[s];
+    output_buffer.Flush();
+    // the buffers are sized for the worst case, so this only trips on a bug; never hand out a cut block
+    Array<uint8_t> block;
+    if (SERF_LIKELY(!output_buffer.overflowed())) {
+      block = output_buffer.GetBuffer(std::ceil((double) compressed_sizes_this_block_[s] / 8.0));
+      OutputBitStream::PatchBlockCount(block, static_cast<uint16_t>(number_of_values_this_block_));
+    } else {
+      ok = false;
+    }
+    compressed_bytes_last_block_[s].swap(block);
+    output_buffer.Refresh();
+    compressed_sizes_last_block_[s] = compressed_sizes_this_block_[s];
+    compressed_sizes_this_block_[s] = output_buffer.WriteBlockCountPlaceholder();
+  }
+  number_of_values_this_block_ = 0;
+
+  // every series has the same number of values in its window, so the window closes for all of them at once
+  if (SERF_LIKELY(number_of_values_this_window_ < kWindowSize)) {
+    for (uint32_t s = 0; s < kNumberOfSeries; ++s) {
+      compressed_sizes_this_window_[s] += compressed_sizes_last_block_[s];
+      compressed_sizes_this_block_[s] += output_buffers_[s].WriteInt(0, 1);
+    }
+    return ok;
+  }
+  for (uint32_t s = 0; s < kNumberOfSeries; ++s) {
+    double compression_ratio_this_window =
+        (double) compressed_sizes_this_window_[s] / (number_of_values_this_window_ * 64);
+    if (SERF_UNLIKELY(compression_ratios_last_window_[s] < compression_ratio_this_window)) {
+      compressed_sizes_this_block_[s] += UpdatePositions(s);
+    } else {
+      compressed_sizes_this_block_[s] += output_buffers_[s].WriteInt(0, 1);
+    }
+    compression_ratios_last_window_[s] = compression_ratio_this_window;
+    std::fill_n(distributions_.begin() + static_cast<size_t>(s) * 128, 128, 0);
+    compressed_sizes_this_window_[s] = 0;
+  }
+  number_of_values_this_window_ = 0;
+  return ok;
+}
+
+uint32_t SerfXORBatchCompressor::number_of_series() const {
+  return kNumberOfSeries;
+}
+
+uint32_t SerfXORBatchCompressor::number_of_table_sets() const {
+  return table_set_ids_by_key_.size();
+}
+
+long SerfXORBatchCompressor::compressed_size_last_block(uint32_t series_id) const {
+  return compressed_sizes_last_block_[series_id];
+}
+
+Array<uint8_t> &SerfXORBatchCompressor::compressed_bytes(uint32_t series_id) {
+  return compressed_bytes_last_block_[series_id];
+}
+
+int SerfXORBatchCompressor::CompressValue(uint32_t series_id, uint64_t value) {
+  OutputBitStream &output_buffer = output_buffers_[series_id];
+  uint64_t xor_result = stored_vals_[series_id] ^ value;
+
+  if (SERF_UNLIKELY(xor_result == 0)) {
+    // case 01
+    return output_buffer.WriteInt(0, 1) + output_buffer.WriteInt(1, 1);
+  }
+  const serf_xor_table_set_t &tables = table_sets_[table_set_ids_[series_id]];
+  int leading_count = __builtin_clzll(xor_result);
+  int trailing_count = __builtin_ctzll(xor_result);
+  int leading_zeros = tables.leading_round[leading_count];
+  int trailing_zeros = tables.trailing_round[trailing_count];
+  uint32_t *distribution = &distributions_[static_cast<size_t>(series_id) * 128];
+  ++distribution[leading_count];
+  ++distribution[64 + trailing_count];
+
+  int stored_leading_zeros = stored_leading_zeros_[series_id];
+  int stored_trailing_zeros = stored_trailing_zeros_[series_id];
+  if (SERF_UNLIKELY(leading_zeros >= stored_leading_zeros && trailing_zeros >= stored_trailing_zeros &&
+      (leading_zeros - stored_leading_zeros) + (trailing_zeros - stored_trailing_zeros) <
+          1 + tables.leading_bits_per_value + tables.trailing_bits_per_value)) {
+    // case 1
+    int center_bits = 64 - stored_leading_zeros - stored_trailing_zeros;
+    output_buffer.WriteInt(1, 1);
+    output_buffer.WriteLong(xor_result >> stored_trailing_zeros, center_bits);
+    return 1 + center_bits;
+  }
+  stored_leading_zeros_[series_id] = leading_zeros;
+  stored_trailing_zeros_[series_id] = trailing_zeros;
+  int center_bits = 64 - leading_zeros - trailing_zeros;
+
+  // case 00
+  int bits_per_value = tables.leading_bits_per_value + tables.trailing_bits_per_value;
+  output_buffer.WriteInt(0, 2);
+  output_buffer.WriteInt((tables.leading_representation[leading_zeros] << tables.trailing_bits_per_value) |
+      tables.trailing_representation[trailing_zeros], bits_per_value);
+  output_buffer.WriteLong(xor_result >> trailing_zeros, center_bits);
+  return 2 + bits_per_value + center_bits;
+}
+
+int SerfXORBatchCompressor::UpdatePositions(uint32_t series_id) {
+  const uint32_t *distribution = &distributions_[static_cast<size_t>(series_id) * 128];
+  for (int i = 0; i < 64; ++i) {
+    lead_distribution_[i] = static_cast<int>(distribution[i]);
+    trail_distribution_[i] = static_cast<int>(distribution[64 + i]);
+  }
+  Array<int> lead_positions = PostOfficeSolver::SolvePositions(lead_distribution_);
+  Array<int> trail_positions = PostOfficeSolver::SolvePositions(trail_distribution_);
+
+  serf_xor_table_set_t table_set;
+  SerfXORTables::Fill(lead_positions, 64, table_set.leading_representation, table_set.leading_round);
+  SerfXORTables::Fill(trail_positions, 64, table_set.trailing_representation, table_set.trailing_round);
+  table_set.leading_bits_per_value = PostOfficeSolver::kPositionLength2Bits[lead_positions.length()];
+  table_set.trailing_bits_per_value = PostOfficeSolver::kPositionLength2Bits[trail_positions.length()];
+  TableSetKey key(PositionMask(lead_positions), PositionMask(trail_positions), table_set.leading_bits_per_value,
+                  table_set.trailing_bits_per_value);
+  uint32_t table_set_id = AcquireTableSet(table_set, key);
+  ReleaseTableSet(table_set_ids_[series_id]);
+  table_set_ids_[series_id] = table_set_id;
+
+  OutputBitStream *output_buffer = &output_buffers_[series_id];
+  return output_buffer->WriteInt(1, 1)
+      + PostOfficeSolver::WritePositions(lead_positions, output_buffer)
+      + PostOfficeSolver::WritePositions(trail_positions, output_buffer);
+}
+
+uint32_t SerfXORBatchCompressor::AcquireTableSet(const serf_xor_table_set_t &table_set, const TableSetKey &key) {
+  auto it = table_set_ids_by_key_.find(key);
+  if (it != table_set_ids_by_key_.end()) {
+    ++table_set_references_[it->second];
+    return it->second;
+  }
+  uint32_t table_set_id;
+  if (free_table_set_ids_.empty()) {
+    table_set_id = table_sets_.size();
+    table_sets_.push_back(table_set);
+    table_set_references_.push_back(1);
+    table_set_keys_.push_back(key);
+  } else {
+    table_set_id = free_table_set_ids_.back();
+    free_table_set_ids_.pop_back();
+    table_sets_[table_set_id] = table_set;
+    table_set_references_[table_set_id] = 1;
+    table_set_keys_[table_set_id] = key;
+  }
+  table_set_ids_by_key_.emplace(key, table_set_id);
+  return table_set_id;
+}
+
+void SerfXORBatchCompressor::ReleaseTableSet(uint32_t table_set_id) {
+  if (--table_set_references_[table_set_id] == 0) {
+    table_set_ids_by_key_.erase(table_set_keys_[table_set_id]);
+    free_table_set_ids_.push_back(table_set_id);
+  }
+}
+
+uint64_t SerfXORBatchCompressor::PositionMask(const Array<int> &positions) {
+  uint64_t mask = 0;
+  for (int i = 1; i < (int)positions.length(); ++i) {
+    mask |= 1ULL << positions[i];
+  }
+  return mask;
+}
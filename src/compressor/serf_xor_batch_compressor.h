@@ -0,0 +1,100 @@
+#ifndef SERF_XOR_BATCH_COMPRESSOR_H_
+#define SERF_XOR_BATCH_COMPRESSOR_H_
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "compressor/serf_xor_compressor.h"
+#include "utils/double.h"
+#include "utils/output_bit_stream.h"
+#include "utils/serf_utils_64.h"
+#include "utils/post_office_solver.h"
+#include "utils/array.h"
+#include "utils/serf_xor_tables.h"
+
+/*
+ * Many independent SERF-XOR series compressed tick by tick: AddValues() takes one value of every series and
+ * encodes them in one loop. Every series produces exactly the blocks a SerfXORCompressor(window_size, max_diff,
+ * adjust_digit) fed with it alone would, so they decode with SerfXORDecompressor.
+ *
+ * The per-value state of all series is kept column by column (stored value, stored leading/trailing zeros, table
+ * set, block size), so the loop walks a few dense arrays instead of one scattered object per series. The tables
+ * are not per series: a series refers to a shared, reference counted table set, all series start on the default
+ * one, and a series whose window solves to new positions moves to the set with those positions, which is only
+ * created if no other series uses it yet. Series of the same kind keep sharing a handful of sets.
+ *
+ * Every series receives a value per tick, so the block and window value counts are common to all. Only the fixed
+ * post-office window is supported, and the adjust digit is the same for all series. At most block_size ticks may
+ * be added between two Close() calls, the per-series bit streams are sized for it.
+ */
+class SerfXORBatchCompressor {
+ public:
+  SerfXORBatchCompressor(uint32_t number_of_series, int block_size, int window_size, double max_diff,
+                         long adjust_digit);
+
+  // values[i] is the value of series i; returns false, adding nothing, once block_size values, at most 65535, are
+  // in the open block
+  bool AddValues(const double *values);
+
+  // Returns false if the block of some series overflowed its bit stream; compressed_bytes() of that series is empty
+  bool Close();
+
+  uint32_t number_of_series() const;
+
+  // Distinct table sets currently referred to by some series
+  uint32_t number_of_table_sets() const;
+
+  long compressed_size_last_block(uint32_t series_id) const;
+
+  Array<uint8_t> &compressed_bytes(uint32_t series_id);
+
+ private:
+  typedef std::tuple<uint64_t, uint64_t, uint8_t, uint8_t> TableSetKey;
+
+  const uint32_t kNumberOfSeries;
+  const int kBlockSize;
+  const int kWindowSize;
+  const double kMaxDiff;
+  const long kAdjustDigit;
+
+  int number_of_values_this_block_ = 0;
+  int number_of_values_this_window_ = 0;
+
+  // hot, touched for every value
+  std::vector<uint64_t> stored_vals_;
+  std::vector<uint8_t> stored_leading_zeros_;
+  std::vector<uint8_t> stored_trailing_zeros_;
+  std::vector<uint32_t> table_set_ids_;
+  std::vector<uint32_t> compressed_sizes_this_block_;
+  // 64 lead counts followed by 64 trail counts per series
+  std::vector<uint32_t> distributions_;
+  std::vector<OutputBitStream> output_buffers_;
+
+  // cold, touched at block boundaries
+  std::vector<long> compressed_sizes_last_block_;
+  std::vector<long> compressed_sizes_this_window_;
+  std::vector<double> compression_ratios_last_window_;
+  std::vector<Array<uint8_t>> compressed_bytes_last_block_;
+
+  std::vector<serf_xor_table_set_t> table_sets_;
+  std::vector<uint32_t> table_set_references_;
+  std::vector<TableSetKey> table_set_keys_;
+  std::vector<uint32_t> free_table_set_ids_;
+  std::map<TableSetKey, uint32_t> table_set_ids_by_key_;
+
+  // solver scratch, reused by every series
+  Array<int> lead_distribution_ = Array<int>(64);
+  Array<int> trail_distribution_ = Array<int>(64);
+
+  int CompressValue(uint32_t series_id, uint64_t value);
+  int UpdatePositions(uint32_t series_id);
+  uint32_t AcquireTableSet(const serf_xor_table_set_t &table_set, const TableSetKey &key);
+  void ReleaseTableSet(uint32_t table_set_id);
+  static uint64_t PositionMask(const Array<int> &positions);
+};
+
+#endif  // SERF_XOR_BATCH_COMPRESSOR_H_
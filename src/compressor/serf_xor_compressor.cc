@@ -1,27 +1,65 @@
 #include "serf_xor_compressor.h"
 
 SerfXORCompressor::SerfXORCompressor(int windows_size, double max_diff, long adjust_digit) :
-    kWindowSize(windows_size), kMaxDiff(max_diff), kAdjustDigit(adjust_digit) {
+    SerfXORCompressor(windows_size, max_diff, adjust_digit, false) {}
+
+SerfXORCompressor::SerfXORCompressor(int windows_size, double max_diff) :
+    SerfXORCompressor(windows_size, max_diff, 0, true) {}
+
+SerfXORCompressor::SerfXORCompressor(int windows_size, double max_diff, long adjust_digit, bool online_adjust_digit) :
+    kMaxDiff(max_diff), kOnlineAdjustDigit(online_adjust_digit), kWindowSize(windows_size),
+    adjust_digit_(adjust_digit) {
   output_buffer_ = std::make_unique<OutputBitStream>(std::floor(((windows_size + 1) * 8 + windows_size / 8 + 1) * 1.2));
-  compressed_size_this_block_ = output_buffer_->WriteInt(0, 1);
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += output_buffer_->WriteInt(0, 1);
+}
+
+bool SerfXORCompressor::AddValue(double v) {
+  // values waiting for the adjust digit count towards the block as well, as does the 32-bit digit update
+  size_t values = number_of_values_this_block_ + pending_values_.size();
+  long max_bits = compressed_size_this_block_ + static_cast<long>(pending_values_.size() + 1) * MaxValueBits() +
+      (kOnlineAdjustDigit ? 32 : 0);
+  if (SERF_UNLIKELY(values >= OutputBitStream::kMaxBlockValues ||
+                    max_bits > static_cast<long>(output_buffer_->capacity()) * 8)) {
+    return false;
+  }
+  if (kOnlineAdjustDigit) {
+    pending_values_.push_back(v);
+  } else {
+    EncodeValue(v);
+  }
+  return true;
+}
+
+void SerfXORCompressor::EnableAdaptiveWindow(const serf_xor_window_config_t &config) {
+  window_config_ = config;
+}
+
+long SerfXORCompressor::adjust_digit() const {
+  return adjust_digit_;
 }
 
-void SerfXORCompressor::AddValue(double v) {
+void SerfXORCompressor::EncodeValue(double v) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
   uint64_t this_val;
   // note we cannot let > max_diff_, because kNan - v > max_diff_ is always false
-  if (SERF_LIKELY(std::abs(Double::LongBitsToDouble(stored_val_) - kAdjustDigit - v) > kMaxDiff)) {
+  if (SERF_LIKELY(std::abs(Double::LongBitsToDouble(stored_val_) - adjust_digit_ - v) > kMaxDiff)) {
     // in our implementation, we do not consider special cases and overflow case
-    double adjust_value = v + kAdjustDigit;
+    double adjust_value = v + adjust_digit_;
     this_val = SerfUtils64::FindAppLong(adjust_value - kMaxDiff, adjust_value + kMaxDiff, v, stored_val_,
-                                        kMaxDiff, kAdjustDigit);
+                                        kMaxDiff, adjust_digit_);
+    SERF_STATS(RecordSearch());
   } else {
     // let current value be the last value, making an XORed value of 0.
     this_val = stored_val_;
+    SERF_STATS(++stats_.stored_val_reuses);
   }
+  SERF_STATS(++stats_.values);
 
   compressed_size_this_block_ += CompressValue(this_val);
   stored_val_ = this_val;
   ++number_of_values_this_window_;
+  ++number_of_values_this_block_;
 }
 
 long SerfXORCompressor::compressed_size_last_block() const {
@@ -36,42 +74,233 @@ Array<uint8_t>& SerfXORCompressor::compressed_bytes() {
   return compressed_bytes_last_block_;
 }
 
-void SerfXORCompressor::Close() {
-  compressed_size_this_block_ += CompressValue(Double::DoubleToLongBits(Double::kNan));
+bool SerfXORCompressor::Close() {
+  if (kOnlineAdjustDigit) {
+    compressed_size_this_block_ += UpdateAdjustDigitIfNeeded();
+    for (double v : pending_values_) {
+      EncodeValue(v);
+    }
+    pending_values_.clear();
+  }
   output_buffer_->Flush();
-  compressed_bytes_last_block_ = output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0));
+  // AddValue() keeps the worst case within the buffer, so this only trips on a bug; never hand out a cut block
+  bool ok = !output_buffer_->overflowed();
+  compressed_bytes_last_block_ = ok ? output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0))
+                                    : Array<uint8_t>(0);
+  if (ok) {
+    OutputBitStream::PatchBlockCount(compressed_bytes_last_block_, number_of_values_this_block_);
+  }
   output_buffer_->Refresh();
   compressed_size_last_block_ = compressed_size_this_block_;
-  compressed_size_this_block_ = UpdatePositionsIfNeeded();
+  number_of_values_this_block_ = 0;
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += UpdatePositionsIfNeeded();
+  return ok;
+}
+
+static void SaveTable(const Array<int> &table, StateWriter *writer) {
+  writer->PutVarint(table.length());
+  for (const auto &entry : table) {
+    writer->PutVarint(static_cast<uint32_t>(entry));
+  }
+}
+
+static bool LoadTable(StateReader *reader, Array<int> &table) {
+  if (reader->GetVarint() != table.length()) {
+    return false;
+  }
+  for (auto &entry : table) {
+    entry = static_cast<int>(reader->GetVarint());
+  }
+  return reader->ok();
+}
+
+// same encoding as the Array<int> tables
+static void SaveTable(const uint8_t (&table)[64], StateWriter *writer) {
+  writer->PutVarint(64);
+  for (uint8_t entry : table) {
+    writer->PutVarint(entry);
+  }
+}
+
+static bool LoadTable(StateReader *reader, uint8_t (&table)[64]) {
+  if (reader->GetVarint() != 64) {
+    return false;
+  }
+  for (auto &entry : table) {
+    uint32_t value = reader->GetVarint();
+    if (value > 64) {
+      return false;
+    }
+    entry = static_cast<uint8_t>(value);
+  }
+  return reader->ok();
+}
+
+Array<uint8_t> SerfXORCompressor::SaveState() const {
+  StateWriter writer(1024);
+  writer.PutVarint(kStateTag);
+  writer.PutVarint(kWindowSize);
+  writer.PutDouble(kMaxDiff);
+  writer.PutVarint(kOnlineAdjustDigit);
+
+  writer.PutVarint(static_cast<uint32_t>(adjust_digit_));
+  writer.PutBytes(&stored_val_, sizeof(stored_val_));
+  writer.PutVarint(static_cast<uint32_t>(stored_leading_zeros_));
+  writer.PutVarint(static_cast<uint32_t>(stored_trailing_zeros_));
+  writer.PutVarint(tables_->leading_bits_per_value);
+  writer.PutVarint(tables_->trailing_bits_per_value);
+  SaveTable(tables_->leading_representation, &writer);
+  SaveTable(tables_->leading_round, &writer);
+  SaveTable(tables_->trailing_representation, &writer);
+  SaveTable(tables_->trailing_round, &writer);
+  SaveTable(lead_distribution_, &writer);
+  SaveTable(trail_distribution_, &writer);
+
+  writer.PutVarint(window_config_.min_window);
+  writer.PutVarint(window_config_.max_window);
+  writer.PutDouble(window_config_.drift_threshold);
+  if (window_config_.max_window > 0) {
+    SaveTable(solved_lead_distribution_, &writer);
+    SaveTable(solved_trail_distribution_, &writer);
+  }
+
+  writer.PutVarint(static_cast<uint32_t>(compressed_size_this_block_));
+  writer.PutVarint(static_cast<uint32_t>(compressed_size_last_block_));
+  writer.PutVarint(static_cast<uint32_t>(compressed_size_this_window_));
+  writer.PutVarint(number_of_values_this_window_);
+  writer.PutVarint(number_of_values_this_block_);
+  writer.PutDouble(compression_ratio_last_window_);
+
+  if (kOnlineAdjustDigit) {
+    writer.PutDouble(seen_min_);
+    writer.PutDouble(seen_max_);
+    writer.PutVarint(static_cast<uint32_t>(pending_values_.size()));
+    for (double v : pending_values_) {
+      writer.PutDouble(v);
+    }
+  }
+
+  output_buffer_->SaveState(&writer);
+  return writer.Finish();
+}
+
+bool SerfXORCompressor::LoadState(const Array<uint8_t> &snapshot) {
+  StateReader reader(snapshot);
+  if (reader.GetVarint() != kStateTag || reader.GetVarint() != static_cast<uint32_t>(kWindowSize) ||
+      reader.GetDouble() != kMaxDiff || reader.GetVarint() != static_cast<uint32_t>(kOnlineAdjustDigit)) {
+    return false;
+  }
+
+  // parse into temporaries, so a truncated or corrupt snapshot leaves the compressor as it was
+  long adjust_digit = reader.GetVarint();
+  uint64_t stored_val;
+  reader.GetBytes(&stored_val, sizeof(stored_val));
+  int stored_leading_zeros = static_cast<int>(reader.GetVarint());
+  int stored_trailing_zeros = static_cast<int>(reader.GetVarint());
+  serf_xor_table_set_t tables;
+  tables.leading_bits_per_value = static_cast<uint8_t>(reader.GetVarint());
+  tables.trailing_bits_per_value = static_cast<uint8_t>(reader.GetVarint());
+  Array<int> lead_distribution(64);
+  Array<int> trail_distribution(64);
+  if (!LoadTable(&reader, tables.leading_representation) || !LoadTable(&reader, tables.leading_round) ||
+      !LoadTable(&reader, tables.trailing_representation) || !LoadTable(&reader, tables.trailing_round) ||
+      !LoadTable(&reader, lead_distribution) || !LoadTable(&reader, trail_distribution)) {
+    return false;
+  }
+
+  serf_xor_window_config_t window_config;
+  window_config.min_window = static_cast<int>(reader.GetVarint());
+  window_config.max_window = static_cast<int>(reader.GetVarint());
+  window_config.drift_threshold = reader.GetDouble();
+  Array<int> solved_lead_distribution(64);
+  Array<int> solved_trail_distribution(64);
+  if (window_config.max_window > 0 &&
+      (!LoadTable(&reader, solved_lead_distribution) || !LoadTable(&reader, solved_trail_distribution))) {
+    return false;
+  }
+
+  long compressed_size_this_block = reader.GetVarint();
+  long compressed_size_last_block = reader.GetVarint();
+  long compressed_size_this_window = reader.GetVarint();
+  int number_of_values_this_window = static_cast<int>(reader.GetVarint());
+  uint32_t number_of_values_this_block = reader.GetVarint();
+  double compression_ratio_last_window = reader.GetDouble();
+
+  double seen_min = std::numeric_limits<double>::max();
+  double seen_max = std::numeric_limits<double>::lowest();
+  std::vector<double> pending_values;
+  if (kOnlineAdjustDigit) {
+    seen_min = reader.GetDouble();
+    seen_max = reader.GetDouble();
+    uint32_t pending_count = reader.GetVarint();
+    for (uint32_t i = 0; reader.ok() && i < pending_count; ++i) {
+      pending_values.push_back(reader.GetDouble());
+    }
+  }
+  if (!reader.ok() || number_of_values_this_block + pending_values.size() > OutputBitStream::kMaxBlockValues) {
+    return false;
+  }
+
+  auto output_buffer = std::make_unique<OutputBitStream>(output_buffer_->capacity());
+  if (!output_buffer->LoadState(&reader) || !reader.finished()) {
+    return false;
+  }
+
+  adjust_digit_ = adjust_digit;
+  stored_val_ = stored_val;
+  stored_leading_zeros_ = stored_leading_zeros;
+  stored_trailing_zeros_ = stored_trailing_zeros;
+  tables_ = SerfXORTables::Assign(tables, kSerfXORDefaultTableSet, own_tables_);
+  lead_distribution_.swap(lead_distribution);
+  trail_distribution_.swap(trail_distribution);
+  window_config_ = window_config;
+  if (window_config_.max_window > 0) {
+    solved_lead_distribution_.swap(solved_lead_distribution);
+    solved_trail_distribution_.swap(solved_trail_distribution);
+  }
+  compressed_size_this_block_ = compressed_size_this_block;
+  compressed_size_last_block_ = compressed_size_last_block;
+  compressed_size_this_window_ = compressed_size_this_window;
+  number_of_values_this_window_ = number_of_values_this_window;
+  number_of_values_this_block_ = static_cast<uint16_t>(number_of_values_this_block);
+  compression_ratio_last_window_ = compression_ratio_last_window;
+  if (kOnlineAdjustDigit) {
+    seen_min_ = seen_min;
+    seen_max_ = seen_max;
+  }
+  pending_values_.swap(pending_values);
+  output_buffer_.swap(output_buffer);
+  return true;
 }
 
 int SerfXORCompressor::CompressValue(uint64_t value) {
+  SERF_PERF_SCOPE(kPerfRegionCompressValue);
   int this_size = 0;
   uint64_t xor_result = stored_val_ ^ value;
+  const serf_xor_table_set_t &tables = *tables_;
 
   if (SERF_UNLIKELY(xor_result == 0)) {
     // case 01
-    this_size += output_buffer_->WriteInt(1, 2);
+    SERF_STATS(++stats_.case_01);
+    this_size += output_buffer_->WriteInt(0, 1) + output_buffer_->WriteInt(1, 1);
   } else {
     int leading_count = __builtin_clzll(xor_result);
     int trailing_count = __builtin_ctzll(xor_result);
-    int leading_zeros = leading_round_[leading_count];
-    int trailing_zeros = trailing_round_[trailing_count];
+    int leading_zeros = tables.leading_round[leading_count];
+    int trailing_zeros = tables.trailing_round[trailing_count];
     ++lead_distribution_[leading_count];
     ++trail_distribution_[trailing_count];
 
     if (SERF_UNLIKELY(leading_zeros >= stored_leading_zeros_ && trailing_zeros >= stored_trailing_zeros_ &&
         (leading_zeros - stored_leading_zeros_) + (trailing_zeros - stored_trailing_zeros_) <
-            1 + leading_bits_per_value_ + trailing_bits_per_value_)) {
+            1 + tables.leading_bits_per_value + tables.trailing_bits_per_value)) {
       // case 1
+      SERF_STATS(++stats_.case_1);
       int center_bits = 64 - stored_leading_zeros_ - stored_trailing_zeros_;
       int len = 1 + center_bits;
-      if (SERF_UNLIKELY(len > 64)) {
-        output_buffer_->WriteInt(1, 1);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong((1ULL << center_bits) | (xor_result >> stored_trailing_zeros_), 1 + center_bits);
-      }
+      output_buffer_->WriteInt(1, 1);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     } else {
       stored_leading_zeros_ = leading_zeros;
@@ -79,24 +308,29 @@ int SerfXORCompressor::CompressValue(uint64_t value) {
       int center_bits = 64 - stored_leading_zeros_ - stored_trailing_zeros_;
 
       // case 00
-      int len = 2 + leading_bits_per_value_ + trailing_bits_per_value_ + center_bits;
-      if (SERF_UNLIKELY(len > 64)) {
-        output_buffer_->WriteInt((leading_representation_[stored_leading_zeros_] << trailing_bits_per_value_) |
-            trailing_representation_[stored_trailing_zeros_], 2 + leading_bits_per_value_ + trailing_bits_per_value_);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong(((((uint64_t) leading_representation_[stored_leading_zeros_] <<
-                                                                                               trailing_bits_per_value_)
-            | trailing_representation_[stored_trailing_zeros_]) << center_bits) | (xor_result
-            >> stored_trailing_zeros_), len);
-      }
+      SERF_STATS(++stats_.case_00);
+      int len = 2 + tables.leading_bits_per_value + tables.trailing_bits_per_value + center_bits;
+      output_buffer_->WriteInt(0, 2);
+      output_buffer_->WriteInt((tables.leading_representation[stored_leading_zeros_] <<
+          tables.trailing_bits_per_value) | tables.trailing_representation[stored_trailing_zeros_],
+          tables.leading_bits_per_value + tables.trailing_bits_per_value);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     }
   }
   return this_size;
 }
 
+int SerfXORCompressor::MaxValueBits() const {
+  // case 00 with no zeros to strip; the positions only change at a block boundary
+  return 2 + tables_->leading_bits_per_value + tables_->trailing_bits_per_value + 64;
+}
+
 int SerfXORCompressor::UpdatePositionsIfNeeded() {
+  SERF_PERF_SCOPE(kPerfRegionUpdatePositionsIfNeeded);
+  if (window_config_.max_window > 0) {
+    return UpdatePositionsIfDrifted();
+  }
   int len;
   if (SERF_LIKELY(number_of_values_this_window_ < kWindowSize)) {
     // Only Check if update flag
@@ -105,26 +339,103 @@ int SerfXORCompressor::UpdatePositionsIfNeeded() {
   } else {
     double compression_ratio_this_window_ = (double) compressed_size_this_window_ / (number_of_values_this_window_ * 64);
     if (SERF_UNLIKELY(compression_ratio_last_window_ < compression_ratio_this_window_)) {
-      // update positions
-      Array<int> lead_positions = PostOfficeSolver::InitRoundAndRepresentation(lead_distribution_,
-                                                                               leading_representation_,
-                                                                               leading_round_);
-      leading_bits_per_value_ = PostOfficeSolver::kPositionLength2Bits[lead_positions.length()];
-      Array<int> trail_positions = PostOfficeSolver::InitRoundAndRepresentation(trail_distribution_,
-                                                                                trailing_representation_,
-                                                                                trailing_round_);
-      trailing_bits_per_value_ = PostOfficeSolver::kPositionLength2Bits[trail_positions.length()];
-      len = output_buffer_->WriteInt(1, 1)
-          + PostOfficeSolver::WritePositions(lead_positions, output_buffer_.get())
-          + PostOfficeSolver::WritePositions(trail_positions, output_buffer_.get());
+      len = UpdatePositions();
     } else {
       len = output_buffer_->WriteInt(0, 1);
     }
-    compression_ratio_last_window_ = compression_ratio_this_window_;
-    __builtin_memset(lead_distribution_.begin(), 0, 64 * sizeof(int));
-    __builtin_memset(trail_distribution_.begin(), 0, 64 * sizeof(int));
-    compressed_size_this_window_ = 0;
-    number_of_values_this_window_ = 0;
+    ResetWindow(compression_ratio_this_window_);
+  }
+  return len;
+}
+
+int SerfXORCompressor::UpdatePositionsIfDrifted() {
+  compressed_size_this_window_ += compressed_size_last_block_;
+  if (SERF_LIKELY(number_of_values_this_window_ < window_config_.min_window)) {
+    return output_buffer_->WriteInt(0, 1);
   }
+  double drift = std::max(PostOfficeSolver::Divergence(lead_distribution_, solved_lead_distribution_),
+                          PostOfficeSolver::Divergence(trail_distribution_, solved_trail_distribution_));
+  double compression_ratio_this_window_ = (double) compressed_size_this_window_ / (number_of_values_this_window_ * 64);
+  bool window_full = number_of_values_this_window_ >= window_config_.max_window;
+  int len;
+  if (drift > window_config_.drift_threshold ||
+      (window_full && compression_ratio_last_window_ < compression_ratio_this_window_)) {
+    len = UpdatePositions();
+  } else if (window_full) {
+    len = output_buffer_->WriteInt(0, 1);
+  } else {
+    // stationary, keep stretching the window
+    return output_buffer_->WriteInt(0, 1);
+  }
+  ResetWindow(compression_ratio_this_window_);
   return len;
 }
+
+int SerfXORCompressor::UpdatePositions() {
+  SERF_STATS(++stats_.position_updates);
+  Array<int> lead_positions = PostOfficeSolver::SolvePositions(lead_distribution_);
+  Array<int> trail_positions = PostOfficeSolver::SolvePositions(trail_distribution_);
+  serf_xor_table_set_t tables;
+  SerfXORTables::Fill(lead_positions, 64, tables.leading_representation, tables.leading_round);
+  SerfXORTables::Fill(trail_positions, 64, tables.trailing_representation, tables.trailing_round);
+  tables.leading_bits_per_value = PostOfficeSolver::kPositionLength2Bits[lead_positions.length()];
+  tables.trailing_bits_per_value = PostOfficeSolver::kPositionLength2Bits[trail_positions.length()];
+  tables_ = SerfXORTables::Assign(tables, kSerfXORDefaultTableSet, own_tables_);
+  if (window_config_.max_window > 0) {
+    __builtin_memcpy(solved_lead_distribution_.begin(), lead_distribution_.begin(), 64 * sizeof(int));
+    __builtin_memcpy(solved_trail_distribution_.begin(), trail_distribution_.begin(), 64 * sizeof(int));
+  }
+  return output_buffer_->WriteInt(1, 1)
+      + PostOfficeSolver::WritePositions(lead_positions, output_buffer_.get())
+      + PostOfficeSolver::WritePositions(trail_positions, output_buffer_.get());
+}
+
+void SerfXORCompressor::ResetWindow(double compression_ratio_this_window) {
+  compression_ratio_last_window_ = compression_ratio_this_window;
+  __builtin_memset(lead_distribution_.begin(), 0, 64 * sizeof(int));
+  __builtin_memset(trail_distribution_.begin(), 0, 64 * sizeof(int));
+  compressed_size_this_window_ = 0;
+  number_of_values_this_window_ = 0;
+}
+
+int SerfXORCompressor::UpdateAdjustDigitIfNeeded() {
+  if (pending_values_.empty()) {
+    return output_buffer_->WriteInt(0, 1);
+  }
+  auto range = std::minmax_element(pending_values_.begin(), pending_values_.end());
+  seen_min_ = std::min(seen_min_, *range.first);
+  seen_max_ = std::max(seen_max_, *range.second);
+  long adjust_digit = CalAdjustDigit(seen_min_, seen_max_);
+  if (adjust_digit == adjust_digit_) {
+    return output_buffer_->WriteInt(0, 1);
+  }
+  // the decoder rebases its stored value with the same double arithmetic, so both sides stay bit-identical
+  stored_val_ = Double::DoubleToLongBits(Double::LongBitsToDouble(stored_val_) - adjust_digit_ + adjust_digit);
+  adjust_digit_ = adjust_digit;
+  return output_buffer_->WriteInt(1, 1) + output_buffer_->WriteInt(static_cast<uint32_t>(adjust_digit_), 32);
+}
+
+long SerfXORCompressor::CalAdjustDigit(double min, double max) {
+  // same as test/adjust_digit_calculator.cpp, clamped to the 32 bits of the header field
+  int u = static_cast<int>(std::ceil(std::log2(std::floor(max) - std::floor(min) + 1)));
+  double lambda = std::ldexp(1.0, u) - std::floor(min);
+  return static_cast<long>(std::min(std::max(0.0, lambda), static_cast<double>(UINT32_MAX)));
+}
+
+#ifdef SERF_ENABLE_STATS
+const serf_xor_stats_t &SerfXORCompressor::stats() const {
+  return stats_;
+}
+
+void SerfXORCompressor::ResetStats() {
+  stats_ = serf_xor_stats_t();
+}
+
+void SerfXORCompressor::RecordSearch() {
+  int depth = SerfUtils64::last_search_depth();
+  ++stats_.find_app_long_calls;
+  stats_.find_app_long_iterations += depth;
+  ++stats_.search_depth_histogram[depth];
+  stats_.find_app_long_fallbacks += SerfUtils64::last_search_fell_back();
+}
+#endif
@@ -14,18 +14,54 @@
 
 #include <cstdint>
 #include <cmath>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 #include "utils/double.h"
 #include "utils/output_bit_stream.h"
 #include "utils/serf_utils_64.h"
 #include "utils/post_office_solver.h"
+#include "utils/serf_xor_tables.h"
 #include "utils/array.h"
+#include "utils/perf_counters.h"
+#include "utils/serf_stats.h"
+#include "utils/state_snapshot.h"
+
+/*
+ * Adaptive post-office window. The fixed policy re-solves the positions only every windows_size values, and
+ * only if the compression ratio got worse. The adaptive one checks at every block boundary once min_window values
+ * are in: it re-solves as soon as the lead or trail histogram drifted more than drift_threshold (total variation
+ * distance) from the histogram the active positions were solved from, and stretches the window up to max_window
+ * while the data is stationary, where the ratio check of the fixed policy applies. {500, 4000, 0.3} halves the
+ * solver runs on the bundled data sets at about the same ratio and follows bursty series much closer.
+ */
+typedef struct {
+  int min_window;
+  int max_window;
+  double drift_threshold;
+} serf_xor_window_config_t;
 
 class SerfXORCompressor {
  public:
   SerfXORCompressor(int windows_size, double max_diff, long adjust_digit);
 
-  void AddValue(double v);
+  /*
+   * Online adjust digit, for streams whose global range is unknown. The values of a block are held back until
+   * Close(), which derives the adjust digit from the range seen so far, this block included, and records it in the
+   * block header after the update flag (1 bit, followed by the new 32-bit digit if it changed). The range only
+   * grows, so the digit settles on the offline one and changes rarely. Decode with SerfXORDecompressor().
+   */
+  SerfXORCompressor(int windows_size, double max_diff);
+
+  // Returns false, without adding v, once the open block holds OutputBitStream::kMaxBlockValues values or the
+  // bit stream, sized from windows_size, has no room for the longest encoding of another value; Close() it. With
+  // the online adjust digit the held-back values count at their longest too, so blocks stay near windows_size
+  bool AddValue(double v);
+
+  void EnableAdaptiveWindow(const serf_xor_window_config_t &config);
+
+  long adjust_digit() const;
 
   long compressed_size_last_block() const;
 
@@ -33,12 +69,33 @@ class SerfXORCompressor {
 
   Array<uint8_t> &compressed_bytes();
 
-  void Close();
+  // Returns false, with compressed_bytes_last_block() empty, if the block overflowed the bit stream
+  bool Close();
+
+  /*
+   * Snapshot of the live state, the open block's bits and held-back values included, so a collector can
+   * checkpoint or move a series to another node without closing the block early. The last closed block and the
+   * stats are not part of it. LoadState() expects a compressor constructed with the same parameters and returns
+   * false, leaving the compressor unchanged, on a truncated or corrupt snapshot or a snapshot of anything else.
+   */
+  Array<uint8_t> SaveState() const;
+
+  bool LoadState(const Array<uint8_t> &snapshot);
+
+#ifdef SERF_ENABLE_STATS
+  const serf_xor_stats_t &stats() const;
+
+  void ResetStats();
+#endif
 
  private:
+  // 'X' and the snapshot version
+  constexpr static uint32_t kStateTag = 0x5802;
+
   const double kMaxDiff;
-  const long kAdjustDigit;
+  const bool kOnlineAdjustDigit;
   const int kWindowSize;
+  long adjust_digit_;
   uint64_t stored_val_ = Double::DoubleToLongBits(2);
 
   std::unique_ptr<OutputBitStream> output_buffer_;
@@ -48,58 +105,40 @@ class SerfXORCompressor {
   long compressed_size_last_block_ = 0;
   long compressed_size_this_window_ = 0;
   int number_of_values_this_window_ = 0;
+  uint16_t number_of_values_this_block_ = 0;
+  std::vector<double> pending_values_;
+  double seen_min_ = std::numeric_limits<double>::max();
+  double seen_max_ = std::numeric_limits<double>::lowest();
   double compression_ratio_last_window_ = 0;
 
-  Array<int> leading_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 1, 2, 2, 2, 2,
-      3, 3, 4, 4, 5, 5, 6, 6,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7
-  };
-  Array<int> leading_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      8, 8, 8, 8, 12, 12, 12, 12,
-      16, 16, 18, 18, 20, 20, 22, 22,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24,
-      24, 24, 24, 24, 24, 24, 24, 24
-  };
-  Array<int> trailing_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 1, 1,
-      1, 1, 1, 1, 2, 2, 2, 2,
-      3, 3, 3, 3, 4, 4, 4, 4,
-      5, 5, 6, 6, 6, 6, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-      7, 7, 7, 7, 7, 7, 7, 7,
-  };
-  Array<int> trailing_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 22, 22,
-      22, 22, 22, 22, 28, 28, 28, 28,
-      32, 32, 32, 32, 36, 36, 36, 36,
-      40, 40, 42, 42, 42, 42, 46, 46,
-      46, 46, 46, 46, 46, 46, 46, 46,
-      46, 46, 46, 46, 46, 46, 46, 46,
-  };
-
-  int leading_bits_per_value_ = 3;
-  int trailing_bits_per_value_ = 3;
+  // the shared ROM tables until this instance's positions diverge from them, see SerfXORTables::Assign
+  const serf_xor_table_set_t *tables_ = &kSerfXORDefaultTableSet;
+  std::unique_ptr<serf_xor_table_set_t> own_tables_;
   Array<int> lead_distribution_ = Array<int>(64);
   Array<int> trail_distribution_ = Array<int>(64);
+  // histograms the active positions were solved from, only kept with the adaptive window
+  Array<int> solved_lead_distribution_ = Array<int>(64);
+  Array<int> solved_trail_distribution_ = Array<int>(64);
+  serf_xor_window_config_t window_config_ = {0, 0, 0};
   int stored_leading_zeros_ = std::numeric_limits<int>::max();
   int stored_trailing_zeros_ = std::numeric_limits<int>::max();
+#ifdef SERF_ENABLE_STATS
+  serf_xor_stats_t stats_ = {};
+
+  void RecordSearch();
+#endif
+
+  SerfXORCompressor(int windows_size, double max_diff, long adjust_digit, bool online_adjust_digit);
 
+  void EncodeValue(double v);
   int CompressValue(uint64_t value);
+  int MaxValueBits() const;
   int UpdatePositionsIfNeeded();
+  int UpdatePositionsIfDrifted();
+  int UpdatePositions();
+  void ResetWindow(double compression_ratio_this_window);
+  int UpdateAdjustDigitIfNeeded();
+  static long CalAdjustDigit(double min, double max);
 };
 
 #endif // SERF_XOR_COMPRESSOR_H_
@@ -3,10 +3,17 @@
 SerfXORCompressorNoAppr::SerfXORCompressorNoAppr(int windows_size, double max_diff, long adjust_digit)
     : kWindowSize(windows_size), kMaxDiff(max_diff), kAdjustDigit(adjust_digit) {
   output_buffer_ = std::make_unique<OutputBitStream>(std::floor(((windows_size + 1) * 8 + windows_size / 8 + 1) * 1.2));
-  compressed_size_this_block_ = output_buffer_->WriteInt(0, 1);;
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += output_buffer_->WriteInt(0, 1);
 }
 
-void SerfXORCompressorNoAppr::AddValue(double v) {
+bool SerfXORCompressorNoAppr::AddValue(double v) {
+  // the longest a value can get is case 00 with no zeros to strip
+  long max_value_bits = 2 + leading_bits_per_value_ + trailing_bits_per_value_ + 64;
+  if (SERF_UNLIKELY(number_of_values_this_block_ == OutputBitStream::kMaxBlockValues ||
+                    compressed_size_this_block_ + max_value_bits > static_cast<long>(output_buffer_->capacity()) * 8)) {
+    return false;
+  }
   uint64_t this_val;
   // note we cannot let > max_diff_, because kNan - v > max_diff_ is always false
   if (__builtin_expect(std::abs(Double::LongBitsToDouble(stored_val_) - kAdjustDigit - v) > kMaxDiff, false)) {
@@ -22,6 +29,8 @@ void SerfXORCompressorNoAppr::AddValue(double v) {
   compressed_size_this_block_ += CompressValue(this_val);
   stored_val_ = this_val;
   ++number_of_values_this_window_;
+  ++number_of_values_this_block_;
+  return true;
 }
 
 long SerfXORCompressorNoAppr::compressed_size_last_block() const {
@@ -32,13 +41,21 @@ Array<uint8_t> SerfXORCompressorNoAppr::compressed_bytes_last_block() {
   return compressed_bytes_last_block_;
 }
 
-void SerfXORCompressorNoAppr::Close() {
-  compressed_size_this_block_ += CompressValue(Double::DoubleToLongBits(Double::kNan));
+bool SerfXORCompressorNoAppr::Close() {
   output_buffer_->Flush();
-  compressed_bytes_last_block_ = output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0));
+  // AddValue() keeps the worst case within the buffer, so this only trips on a bug; never hand out a cut block
+  bool ok = !output_buffer_->overflowed();
+  compressed_bytes_last_block_ = ok ? output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0))
+                                    : Array<uint8_t>(0);
+  if (ok) {
+    OutputBitStream::PatchBlockCount(compressed_bytes_last_block_, number_of_values_this_block_);
+  }
   output_buffer_->Refresh();
   compressed_size_last_block_ = compressed_size_this_block_;
-  compressed_size_this_block_ = UpdatePositionsIfNeeded();
+  number_of_values_this_block_ = 0;
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += UpdatePositionsIfNeeded();
+  return ok;
 }
 
 int SerfXORCompressorNoAppr::CompressValue(uint64_t value) {
@@ -47,7 +64,7 @@ int SerfXORCompressorNoAppr::CompressValue(uint64_t value) {
 
   if (__builtin_expect(xor_result == 0, true)) {
     // case 01
-    this_size += output_buffer_->WriteInt(1, 2);
+    this_size += output_buffer_->WriteInt(0, 1) + output_buffer_->WriteInt(1, 1);
   } else {
     int leading_count = __builtin_clzll(xor_result);
     int trailing_count = __builtin_ctzll(xor_result);
@@ -62,12 +79,8 @@ int SerfXORCompressorNoAppr::CompressValue(uint64_t value) {
       // case 1
       int center_bits = 64 - stored_leading_zeros_ - stored_trailing_zeros_;
       int len = 1 + center_bits;
-      if (len > 64) {
-        output_buffer_->WriteInt(1, 1);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong((1ULL << center_bits) | (xor_result >> stored_trailing_zeros_), 1 + center_bits);
-      }
+      output_buffer_->WriteInt(1, 1);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     } else {
       stored_leading_zeros_ = leading_zeros;
@@ -76,16 +89,10 @@ int SerfXORCompressorNoAppr::CompressValue(uint64_t value) {
 
       // case 00
       int len = 2 + leading_bits_per_value_ + trailing_bits_per_value_ + center_bits;
-      if (len > 64) {
-        output_buffer_->WriteInt((leading_representation_[stored_leading_zeros_] << trailing_bits_per_value_) |
-            trailing_representation_[stored_trailing_zeros_], 2 + leading_bits_per_value_ + trailing_bits_per_value_);
-        output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteLong(((((uint64_t) leading_representation_[stored_leading_zeros_] <<
-                                                                                               trailing_bits_per_value_)
-            | trailing_representation_[stored_trailing_zeros_]) << center_bits) | (xor_result
-            >> stored_trailing_zeros_), len);
-      }
+      output_buffer_->WriteInt(0, 2);
+      output_buffer_->WriteInt((leading_representation_[stored_leading_zeros_] << trailing_bits_per_value_) |
+          trailing_representation_[stored_trailing_zeros_], leading_bits_per_value_ + trailing_bits_per_value_);
+      output_buffer_->WriteLong(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     }
   }
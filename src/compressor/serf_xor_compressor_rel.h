@@ -14,6 +14,7 @@
 
 #include <cstdint>
 #include <cmath>
+#include <memory>
 
 #include "utils/double.h"
 #include "utils/output_bit_stream.h"
@@ -25,13 +26,16 @@ class SerfXORCompressorRel {
  public:
   SerfXORCompressorRel(int windows_size, double rel_diff, long adjust_digit);
 
-  void AddValue(double v);
+  // Returns false, without adding v, once the open block holds OutputBitStream::kMaxBlockValues values or the
+  // bit stream, sized from the window, has no room for the longest encoding of another value; Close() it
+  bool AddValue(double v);
 
   long compressed_size_last_block() const;
 
   Array<uint8_t> compressed_bytes_last_block();
 
-  void Close();
+  // Returns false, with compressed_bytes_last_block() empty, if the block overflowed the bit stream
+  bool Close();
 
  private:
   const double kRelDiff;
@@ -47,6 +51,7 @@ class SerfXORCompressorRel {
   long compressed_size_last_block_ = 0;
   long compressed_size_this_window_ = 0;
   int number_of_values_this_window_ = 0;
+  uint16_t number_of_values_this_block_ = 0;
   double compression_ratio_last_window_ = 0;
 
   Array<int> leading_representation_ = {
@@ -1,7 +1,10 @@
 #include "compressor_32/serf_qt_compressor_32.h"
 
-SerfQtCompressor32::SerfQtCompressor32(int block_size, float max_diff): kBlockSize(block_size),
-kMaxDiff(max_diff * 0.99f) {
+SerfQtCompressor32::SerfQtCompressor32(int block_size, float max_diff, bool power_of_two_bound):
+kBlockSize(block_size),
+kMaxDiff(power_of_two_bound ? PowerOfTwoBound::Bound(max_diff, 0.99f) : max_diff * 0.99f),
+kPowerOfTwoBound(power_of_two_bound && PowerOfTwoBound::IsPowerOfTwo(kMaxDiff)),
+kStepExponent(PowerOfTwoBound::Exponent(kMaxDiff) + 1) {
   output_bit_stream_ = std::make_unique<OutputBitStream>(2 * kBlockSize * 8);
 }
 
@@ -11,8 +14,16 @@ void SerfQtCompressor32::AddValue(float v) {
     compressed_size_in_bits_ += output_bit_stream_->WriteInt(kBlockSize, 16);
     compressed_size_in_bits_ += output_bit_stream_->WriteInt(Float::FloatToIntBits(kMaxDiff), 32);
   }
-  long q = static_cast<long>(std::round((v - pre_value_) / (2 * kMaxDiff)));
-  float recover_value = pre_value_ + 2 * kMaxDiff * static_cast<float>(q);
+  long q;
+  float recover_value;
+  if (kPowerOfTwoBound) {
+    // exact, so the reconstruction matches the multiplication below bit for bit
+    q = static_cast<long>(std::round(std::ldexp(v - pre_value_, -kStepExponent)));
+    recover_value = pre_value_ + std::ldexp(static_cast<float>(q), kStepExponent);
+  } else {
+    q = static_cast<long>(std::round((v - pre_value_) / (2 * kMaxDiff)));
+    recover_value = pre_value_ + 2 * kMaxDiff * static_cast<float>(q);
+  }
   compressed_size_in_bits_ += EliasGammaCodec::Encode(ZigZagCodec::Encode(static_cast<int64_t>(q)) + 1,
                                                       output_bit_stream_.get());
   pre_value_ = recover_value;
@@ -9,10 +9,13 @@
 #include "utils/float.h"
 #include "utils/elias_gamma_codec.h"
 #include "utils/zig_zag_codec.h"
+#include "utils/power_of_two_bound.h"
 
 class SerfQtCompressor32 {
  public:
-  explicit SerfQtCompressor32(int block_size, float max_diff);
+  // power_of_two_bound rounds the bound down to a power of two, so quantization and reconstruction are ldexp
+  // exponent adjustments instead of a divide and a multiply; the blocks stay in the same format
+  explicit SerfQtCompressor32(int block_size, float max_diff, bool power_of_two_bound = false);
 
   void AddValue(float v);
 
@@ -25,6 +28,9 @@ class SerfQtCompressor32 {
  private:
   const int kBlockSize;
   const float kMaxDiff;
+  const bool kPowerOfTwoBound;
+  // exponent of the step 2 * kMaxDiff in power-of-two mode
+  const int kStepExponent;
   bool first_ = true;
   std::unique_ptr<OutputBitStream> output_bit_stream_;
   float pre_value_ = 2;
@@ -3,10 +3,18 @@
 SerfXORCompressor32::SerfXORCompressor32(int window_size, float max_diff)
     : kWindowSize(window_size), kMaxDiff(max_diff) {
   output_buffer_ = std::make_unique<OutputBitStream>(std::floor(((window_size + 1) * 4 + window_size / 4 + 1) * 1.2));
-  compressed_size_this_block_ = output_buffer_->WriteInt(0, 1);
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += output_buffer_->WriteInt(0, 1);
 }
 
-void SerfXORCompressor32::AddValue(float v) {
+bool SerfXORCompressor32::AddValue(float v) {
+  SERF_PERF_SCOPE(kPerfRegionAddValue);
+  // the longest a value can get is case 00 with no zeros to strip
+  long max_value_bits = 2 + tables_->leading_bits_per_value + tables_->trailing_bits_per_value + 32;
+  if (SERF_UNLIKELY(number_of_values_this_block_ == OutputBitStream::kMaxBlockValues ||
+                    compressed_size_this_block_ + max_value_bits > static_cast<long>(output_buffer_->capacity()) * 8)) {
+    return false;
+  }
   uint32_t this_val;
   // note we cannot let > maxDiff, because kNan - v > maxDiff is always false
   if (SERF_LIKELY(std::abs(Float::IntBitsToFloat(stored_val_) - v) > kMaxDiff)) {
@@ -20,6 +28,8 @@ void SerfXORCompressor32::AddValue(float v) {
   compressed_size_this_block_ += CompressValue(this_val);
   stored_val_ = this_val;
   ++number_of_values_this_window_;
+  ++number_of_values_this_block_;
+  return true;
 }
 
 long SerfXORCompressor32::compressed_size_last_block() const {
@@ -30,41 +40,48 @@ Array<uint8_t> SerfXORCompressor32::compressed_bytes_last_block() {
   return compressed_bytes_last_block_;
 }
 
-void SerfXORCompressor32::Close() {
-  compressed_size_this_block_ += CompressValue(Float::FloatToIntBits(Float::kNan));
+bool SerfXORCompressor32::Close() {
   output_buffer_->Flush();
-  compressed_bytes_last_block_ = output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0));
+  // AddValue() keeps the worst case within the buffer, so this only trips on a bug; never hand out a cut block
+  bool ok = !output_buffer_->overflowed();
+  compressed_bytes_last_block_ = ok ? output_buffer_->GetBuffer(std::ceil((double) compressed_size_this_block_ / 8.0))
+                                    : Array<uint8_t>(0);
+  if (ok) {
+    OutputBitStream::PatchBlockCount(compressed_bytes_last_block_, number_of_values_this_block_);
+  }
   output_buffer_->Refresh();
   compressed_size_last_block_ = compressed_size_this_block_;
-  compressed_size_this_block_ = UpdatePositionsIfNeeded();
+  number_of_values_this_block_ = 0;
+  compressed_size_this_block_ = output_buffer_->WriteBlockCountPlaceholder();
+  compressed_size_this_block_ += UpdatePositionsIfNeeded();
+  return ok;
 }
 
 int SerfXORCompressor32::CompressValue(uint32_t value) {
+  SERF_PERF_SCOPE(kPerfRegionCompressValue);
   int this_size = 0;
   uint32_t xor_result = stored_val_ ^ value;
+  const serf_xor_table_set_32_t &tables = *tables_;
 
   if (SERF_UNLIKELY(xor_result == 0)) {
-    this_size += static_cast<int>(output_buffer_->WriteInt(1, 2));
+    // case 01
+    this_size += static_cast<int>(output_buffer_->WriteInt(0, 1) + output_buffer_->WriteInt(1, 1));
   } else {
     int leading_count = __builtin_clz(xor_result);
     int trailing_count = __builtin_ctz(xor_result);
-    int leading_zeros = leading_round_[leading_count];
-    int trailing_zeros = trailing_round_[trailing_count];
+    int leading_zeros = tables.leading_round[leading_count];
+    int trailing_zeros = tables.trailing_round[trailing_count];
     ++lead_distribution_[leading_count];
     ++trail_distribution_[trailing_count];
 
     if (SERF_UNLIKELY(leading_zeros >= stored_leading_zeros_ && trailing_zeros >= stored_trailing_zeros_ &&
         (leading_zeros - stored_leading_zeros_) + (trailing_zeros - stored_trailing_zeros_)
-            < 1 + leading_bits_per_value_ + trailing_bits_per_value_)) {
+            < 1 + tables.leading_bits_per_value + tables.trailing_bits_per_value)) {
       // case 1
       int center_bits = 32 - stored_leading_zeros_ - stored_trailing_zeros_;
       int len = 1 + center_bits;
-      if (SERF_UNLIKELY(len > 32)) {
-        output_buffer_->WriteInt(1, 1);
-        output_buffer_->WriteInt(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteInt((1 << center_bits) | (xor_result >> stored_trailing_zeros_), 1 + center_bits);
-      }
+      output_buffer_->WriteInt(1, 1);
+      output_buffer_->WriteInt(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     } else {
       stored_leading_zeros_ = leading_zeros;
@@ -72,18 +89,12 @@ int SerfXORCompressor32::CompressValue(uint32_t value) {
       int center_bits = 32 - stored_leading_zeros_ - stored_trailing_zeros_;
 
       // case 00
-      int len = 2 + leading_bits_per_value_ + trailing_bits_per_value_ + center_bits;
-      if (SERF_UNLIKELY(len > 32)) {
-        output_buffer_->WriteInt((leading_representation_[stored_leading_zeros_]
-                                         << trailing_bits_per_value_)
-                                         | trailing_representation_[stored_trailing_zeros_],
-                                     2 + leading_bits_per_value_ + trailing_bits_per_value_);
-        output_buffer_->WriteInt(xor_result >> stored_trailing_zeros_, center_bits);
-      } else {
-        output_buffer_->WriteInt((((leading_representation_[stored_leading_zeros_]
-            << trailing_bits_per_value_) | trailing_representation_[stored_trailing_zeros_])
-            << center_bits) | (xor_result >> stored_trailing_zeros_), len);
-      }
+      int len = 2 + tables.leading_bits_per_value + tables.trailing_bits_per_value + center_bits;
+      output_buffer_->WriteInt(0, 2);
+      output_buffer_->WriteInt((tables.leading_representation[stored_leading_zeros_] <<
+          tables.trailing_bits_per_value) | tables.trailing_representation[stored_trailing_zeros_],
+          tables.leading_bits_per_value + tables.trailing_bits_per_value);
+      output_buffer_->WriteInt(xor_result >> stored_trailing_zeros_, center_bits);
       this_size += len;
     }
   }
@@ -91,6 +102,7 @@ int SerfXORCompressor32::CompressValue(uint32_t value) {
 }
 
 int SerfXORCompressor32::UpdatePositionsIfNeeded() {
+  SERF_PERF_SCOPE(kPerfRegionUpdatePositionsIfNeeded);
   int len;
   if (SERF_LIKELY(number_of_values_this_window_ < kWindowSize)) {
     // Only Check if update flag
@@ -101,14 +113,14 @@ int SerfXORCompressor32::UpdatePositionsIfNeeded() {
         compression_ratio_this_window_ = (double) compressed_size_this_window_ / (number_of_values_this_window_ * 32);
     if (SERF_UNLIKELY(compression_ratio_last_window_ < compression_ratio_this_window_)) {
       // update positions
-      Array<int> lead_positions = PostOfficeSolver32::InitRoundAndRepresentation(lead_distribution_,
-                                                                                 leading_representation_,
-                                                                                 leading_round_);
-      leading_bits_per_value_ = PostOfficeSolver32::kPositionLength2Bits[lead_positions.length()];
-      Array<int> trail_positions = PostOfficeSolver32::InitRoundAndRepresentation(trail_distribution_,
-                                                                                  trailing_representation_,
-                                                                                  trailing_round_);
-      trailing_bits_per_value_ = PostOfficeSolver32::kPositionLength2Bits[trail_positions.length()];
+      Array<int> lead_positions = PostOfficeSolver32::SolvePositions(lead_distribution_);
+      Array<int> trail_positions = PostOfficeSolver32::SolvePositions(trail_distribution_);
+      serf_xor_table_set_32_t tables;
+      SerfXORTables::Fill(lead_positions, 32, tables.leading_representation, tables.leading_round);
+      SerfXORTables::Fill(trail_positions, 32, tables.trailing_representation, tables.trailing_round);
+      tables.leading_bits_per_value = PostOfficeSolver32::kPositionLength2Bits[lead_positions.length()];
+      tables.trailing_bits_per_value = PostOfficeSolver32::kPositionLength2Bits[trail_positions.length()];
+      tables_ = SerfXORTables::Assign(tables, kSerfXOR32DefaultTableSet, own_tables_);
       len = output_buffer_->WriteInt(1, 1)
           + PostOfficeSolver32::WritePositions(lead_positions, output_buffer_.get())
           + PostOfficeSolver32::WritePositions(trail_positions, output_buffer_.get());
@@ -13,6 +13,7 @@
 #endif
 
 #include <cmath>
+#include <memory>
 #include <cstdint>
 
 #include "utils/output_bit_stream.h"
@@ -20,18 +21,23 @@
 #include "utils/array.h"
 #include "utils/serf_utils_32.h"
 #include "utils/post_office_solver_32.h"
+#include "utils/serf_xor_tables.h"
+#include "utils/perf_counters.h"
 
 class SerfXORCompressor32 {
  public:
   SerfXORCompressor32(int window_size, float max_diff);
 
-  void AddValue(float v);
+  // Returns false, without adding v, once the open block holds OutputBitStream::kMaxBlockValues values or the
+  // bit stream, sized from the window, has no room for the longest encoding of another value; Close() it
+  bool AddValue(float v);
 
   long compressed_size_last_block() const;
 
   Array<uint8_t> compressed_bytes_last_block();
 
-  void Close();
+  // Returns false, with compressed_bytes_last_block() empty, if the block overflowed the bit stream
+  bool Close();
 
  private:
   const float kMaxDiff;
@@ -45,35 +51,12 @@ class SerfXORCompressor32 {
   long compressed_size_last_block_ = 0;
   long compressed_size_this_window_ = 0;
   int number_of_values_this_window_ = 0;
+  uint16_t number_of_values_this_block_ = 0;
   double compression_ratio_last_window_ = 0;
 
-  Array<int> leading_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 1, 2, 2, 2, 2,
-      3, 3, 3, 3, 3, 3, 3, 3,
-      3, 3, 3, 3, 3, 3, 3, 3,
-  };
-  Array<int> leading_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      8, 8, 8, 8, 12, 12, 12, 12,
-      16, 16, 16, 16, 16, 16, 16, 16,
-      16, 16, 16, 16, 16, 16, 16, 16
-  };
-  Array<int> trailing_representation_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      1, 1, 1, 1, 1, 1, 1, 1,
-      1, 1, 1, 1, 1, 1, 1, 1
-  };
-  Array<int> trailing_round_ = {
-      0, 0, 0, 0, 0, 0, 0, 0,
-      0, 0, 0, 0, 0, 0, 0, 0,
-      16, 16, 16, 16, 16, 16, 16, 16,
-      16, 16, 16, 16, 16, 16, 16, 16
-  };
-
-  int leading_bits_per_value_ = 2;
-  int trailing_bits_per_value_ = 1;
+  // the shared ROM tables until this instance's positions diverge from them, see SerfXORTables::Assign
+  const serf_xor_table_set_32_t *tables_ = &kSerfXOR32DefaultTableSet;
+  std::unique_ptr<serf_xor_table_set_32_t> own_tables_;
   Array<int> lead_distribution_ = Array<int>(32);
   Array<int> trail_distribution_ = Array<int>(32);
   int stored_leading_zeros_ = std::numeric_limits<int>::max();
@@ -1,19 +1,77 @@
 #include "net_serf_qt_decompressor.h"
+#include <stdio.h>
 
 NetSerfQtDecompressor::NetSerfQtDecompressor(double max_diff) 
     : kMaxDiff(max_diff * 0.999), pre_value_(2.0) {
   input_bit_stream_ = new InputBitStream();
+  resync_ = NULL;
 }
 
 NetSerfQtDecompressor::~NetSerfQtDecompressor() {
   if (input_bit_stream_ != NULL) {
     delete input_bit_stream_;
   }
+  if (resync_ != NULL) {
+    delete resync_;
+  }
 }
 
 double NetSerfQtDecompressor::Decompress(Array<uint8_t> &bs) {
+  double value = pre_value_;
+  Decompress(bs, &value);
+  return value;
+}
+
+NetResyncStatus NetSerfQtDecompressor::Decompress(Array<uint8_t> &bs, double *value) {
   input_bit_stream_->SetBuffer(bs);
+  NetSeriesId::Read(input_bit_stream_);
+  NetResyncStatus status = kNetResyncOk;
+  if (resync_ != NULL) {
+    bool keyframe;
+    status = resync_->ReadHeader(input_bit_stream_, &keyframe);
+    if (status == kNetResyncLost) {
+      return status;
+    }
+    if (keyframe) {
+      pre_value_ = 2.0;
+    }
+  }
+  *value = NextValue();
+  return status;
+}
+
+net_serf_qt_series_state_t NetSerfQtDecompressor::SaveSeriesState() const {
+  net_serf_qt_series_state_t state;
+  state.pre_value = pre_value_;
+  return state;
+}
+
+void NetSerfQtDecompressor::LoadSeriesState(const net_serf_qt_series_state_t &state) {
+  pre_value_ = state.pre_value;
+}
+
+void NetSerfQtDecompressor::EnableResync() {
+  if (resync_ != NULL) {
+    delete resync_;
+  }
+  resync_ = new NetResyncDecoder();
+}
+
+uint8_t NetSerfQtDecompressor::DecompressFrame(Array<uint8_t> &frame, Array<double> &output) {
+  input_bit_stream_->SetBuffer(frame);
   input_bit_stream_->ReadInt(4);
+  uint8_t count = (uint8_t)input_bit_stream_->ReadInt(8);
+  if (!output.is_valid() || output.length() < count) {
+    printf("DecompressFrame: output array invalid or too small\n");
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    output[i] = NextValue();
+  }
+  return count;
+}
+
+double NetSerfQtDecompressor::NextValue() {
   int32_t eliasGammaValue = EliasGammaCodec::Decode(input_bit_stream_);
   int32_t decodeValue = ZigZagCodec::Decode(eliasGammaValue - 1);
   pre_value_ = pre_value_ + 2.0 * kMaxDiff * (double)decodeValue;
@@ -8,6 +8,9 @@
 #include "../utils/zig_zag_codec.h"
 #include "../utils/elias_gamma_codec.h"
 #include "../utils/array.h"
+#include "../utils/net_series_id.h"
+#include "../utils/net_resync.h"
+#include "../compressor/net_serf_qt_compressor.h"
 
 class NetSerfQtDecompressor {
  public:
@@ -17,10 +20,26 @@ class NetSerfQtDecompressor {
   // 返回double（GPS坐标通常使用double）
   double Decompress(Array<uint8_t> &bs);
 
+  // 可重同步模式下检测丢包；返回kNetResyncLost时*value保持上一个解出的值
+  NetResyncStatus Decompress(Array<uint8_t> &bs, double *value);
+
+  net_serf_qt_series_state_t SaveSeriesState() const;
+
+  void LoadSeriesState(const net_serf_qt_series_state_t &state);
+
+  // 与NetSerfQtCompressor::EnableResync对应
+  void EnableResync();
+
+  // 解压NetSerfQtCompressor聚合模式的一帧，返回值个数；output容量不足时返回0
+  uint8_t DecompressFrame(Array<uint8_t> &frame, Array<double> &output);
+
  private:
   const double kMaxDiff;
   double pre_value_;
   InputBitStream* input_bit_stream_;
+  NetResyncDecoder* resync_;
+
+  double NextValue();
 };
 
 #endif  // NET_SERF_QT_DECOMPRESSOR_H
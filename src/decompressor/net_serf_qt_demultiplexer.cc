@@ -0,0 +1,39 @@
+#include "net_serf_qt_demultiplexer.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+NetSerfQtDemultiplexer::NetSerfQtDemultiplexer(uint32_t number_of_series, double max_diff)
+    : decompressor_(max_diff), number_of_series_(number_of_series) {
+  series_states_ = (net_serf_qt_series_state_t*)malloc(number_of_series * sizeof(net_serf_qt_series_state_t));
+  if (series_states_ == NULL) {
+    printf("NetSerfQtDemultiplexer: ERROR - failed to allocate %lu series\n", (unsigned long)number_of_series);
+    number_of_series_ = 0;
+    return;
+  }
+  net_serf_qt_series_state_t initial_state = decompressor_.SaveSeriesState();
+  for (uint32_t i = 0; i < number_of_series_; i++) {
+    series_states_[i] = initial_state;
+  }
+}
+
+NetSerfQtDemultiplexer::~NetSerfQtDemultiplexer() {
+  if (series_states_ != NULL) {
+    free(series_states_);
+  }
+}
+
+bool NetSerfQtDemultiplexer::Decompress(Array<uint8_t> &packet, uint32_t *series_id, double *value) {
+  uint32_t id = NetSeriesId::Peek(packet);
+  if (id >= number_of_series_) {
+    return false;
+  }
+  decompressor_.LoadSeriesState(series_states_[id]);
+  *value = decompressor_.Decompress(packet);
+  series_states_[id] = decompressor_.SaveSeriesState();
+  *series_id = id;
+  return true;
+}
+
+uint32_t NetSerfQtDemultiplexer::number_of_series() const {
+  return number_of_series_;
+}
@@ -0,0 +1,28 @@
+#ifndef NET_SERF_QT_DEMULTIPLEXER_H
+#define NET_SERF_QT_DEMULTIPLEXER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../utils/array.h"
+#include "../utils/net_series_id.h"
+#include "net_serf_qt_decompressor.h"
+
+// NetSerfQtMultiplexer的接收端：按包头中的序列号直接索引状态表
+class NetSerfQtDemultiplexer {
+ public:
+  NetSerfQtDemultiplexer(uint32_t number_of_series, double max_diff);
+  ~NetSerfQtDemultiplexer();
+
+  // 返回false表示序列号超出范围，此时不更新任何序列的状态
+  bool Decompress(Array<uint8_t> &packet, uint32_t *series_id, double *value);
+
+  uint32_t number_of_series() const;
+
+ private:
+  NetSerfQtDecompressor decompressor_;
+  net_serf_qt_series_state_t* series_states_;
+  uint32_t number_of_series_;
+};
+
+#endif  // NET_SERF_QT_DEMULTIPLEXER_H
@@ -4,13 +4,64 @@ NetSerfXORDecompressor::NetSerfXORDecompressor(int window_size, long adjust_digi
                                                                                      kAdjustDigit(adjust_digit) {}
 
 double NetSerfXORDecompressor::Decompress(Array<uint8_t> &bs) {
+  double value = Double::LongBitsToDouble(stored_val_) - kAdjustDigit;
+  Decompress(bs, &value);
+  return value;
+}
+
+NetResyncStatus NetSerfXORDecompressor::Decompress(Array<uint8_t> &bs, double *value) {
   input_bit_stream_->SetBuffer(bs);
-  return Double::LongBitsToDouble(ReadValue()) - kAdjustDigit;
+  // the transition header only carries the series ID, which the demultiplexer has already peeked
+  NetSeriesId::Read(input_bit_stream_.get());
+  NetResyncStatus status = kNetResyncOk;
+  if (resync_ != nullptr) {
+    bool keyframe;
+    status = resync_->ReadHeader(input_bit_stream_.get(), &keyframe);
+    if (status == kNetResyncLost) {
+      return status;
+    }
+    if (keyframe) {
+      ResetPredictor();
+    }
+  }
+  *value = Double::LongBitsToDouble(ReadValue()) - kAdjustDigit;
+  return status;
 }
 
-uint64_t NetSerfXORDecompressor::ReadValue() {
-  // empty read 4 bits for getting rid of transmit header
+void NetSerfXORDecompressor::EnableResync() {
+  resync_ = std::make_unique<NetResyncDecoder>();
+}
+
+net_serf_xor_series_state_t NetSerfXORDecompressor::SaveSeriesState() const {
+  net_serf_xor_series_state_t state;
+  state.stored_val = stored_val_;
+  state.stored_leading_zeros = stored_leading_zeros_ > 64 ? 0xFF : stored_leading_zeros_;
+  state.stored_trailing_zeros = stored_trailing_zeros_ > 64 ? 0xFF : stored_trailing_zeros_;
+  return state;
+}
+
+void NetSerfXORDecompressor::LoadSeriesState(const net_serf_xor_series_state_t &state) {
+  stored_val_ = state.stored_val;
+  stored_leading_zeros_ = state.stored_leading_zeros > 64 ? std::numeric_limits<int>::max()
+                                                          : state.stored_leading_zeros;
+  stored_trailing_zeros_ = state.stored_trailing_zeros > 64 ? std::numeric_limits<int>::max()
+                                                            : state.stored_trailing_zeros;
+}
+
+uint8_t NetSerfXORDecompressor::DecompressFrame(Array<uint8_t> &frame, Array<double> &output) {
+  input_bit_stream_->SetBuffer(frame);
   input_bit_stream_->ReadInt(4);
+  uint8_t count = input_bit_stream_->ReadInt(8);
+  if (output.length() < count) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < count; ++i) {
+    output[i] = Double::LongBitsToDouble(ReadValue()) - kAdjustDigit;
+  }
+  return count;
+}
+
+uint64_t NetSerfXORDecompressor::ReadValue() {
   if (number_of_values_ >= kWindowSize) {
     UpdatePositionsIfNeeded();
   }
@@ -19,6 +70,21 @@ uint64_t NetSerfXORDecompressor::ReadValue() {
   return stored_val_;
 }
 
+void NetSerfXORDecompressor::ResetPredictor() {
+  stored_val_ = Double::DoubleToLongBits(2);
+  stored_leading_zeros_ = std::numeric_limits<int>::max();
+  stored_trailing_zeros_ = std::numeric_limits<int>::max();
+  leading_representation_ = Array<int>(8);
+  trailing_representation_ = Array<int>(8);
+  for (int i = 0; i < 8; ++i) {
+    leading_representation_[i] = NetSerfXORCompressor::kDefaultLeadingPositions[i];
+    trailing_representation_[i] = NetSerfXORCompressor::kDefaultTrailingPositions[i];
+  }
+  leading_bits_per_value_ = 3;
+  trailing_bits_per_value_ = 3;
+  number_of_values_ = 0;
+}
+
 void NetSerfXORDecompressor::NextValue() {
   uint64_t value;
   int center_bits;
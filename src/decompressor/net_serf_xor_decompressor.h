@@ -8,6 +8,9 @@
 #include "utils/double.h"
 #include "utils/input_bit_stream.h"
 #include "utils/post_office_solver.h"
+#include "utils/net_series_id.h"
+#include "utils/net_resync.h"
+#include "compressor/net_serf_xor_compressor.h"
 
 class NetSerfXORDecompressor {
  public:
@@ -15,6 +18,20 @@ class NetSerfXORDecompressor {
 
   double Decompress(Array<uint8_t> &bs);
 
+  // Detects lost packets in resync mode; on kNetResyncLost *value is left untouched
+  NetResyncStatus Decompress(Array<uint8_t> &bs, double *value);
+
+  net_serf_xor_series_state_t SaveSeriesState() const;
+
+  void LoadSeriesState(const net_serf_xor_series_state_t &state);
+
+  // Counterpart of NetSerfXORCompressor::EnableResync
+  void EnableResync();
+
+  // Decompress one frame of NetSerfXORCompressor's coalescing mode, returns the number of values or 0 when
+  // output is too small
+  uint8_t DecompressFrame(Array<uint8_t> &frame, Array<double> &output);
+
  private:
   const int kWindowSize;
   const long kAdjustDigit;
@@ -25,6 +42,7 @@ class NetSerfXORDecompressor {
   int stored_trailing_zeros_ = std::numeric_limits<int>::max();
 
   std::unique_ptr<InputBitStream> input_bit_stream_ = std::make_unique<InputBitStream>();
+  std::unique_ptr<NetResyncDecoder> resync_;
 
   Array<int> leading_representation_ = {0, 8, 12, 16, 18, 20, 22, 24};
   Array<int> trailing_representation_ = {0, 22, 28, 32, 36, 40, 42, 46};
@@ -33,6 +51,7 @@ class NetSerfXORDecompressor {
   int number_of_values_ = 0;
 
   uint64_t ReadValue();
+  void ResetPredictor();
   void NextValue();
   void UpdatePositionsIfNeeded();
   void UpdateLeadingRepresentation();
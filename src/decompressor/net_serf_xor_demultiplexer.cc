@@ -0,0 +1,22 @@
+#include "decompressor/net_serf_xor_demultiplexer.h"
+
+NetSerfXORDemultiplexer::NetSerfXORDemultiplexer(uint32_t number_of_series, int window_size, long adjust_digit)
+    : decompressor_(window_size, adjust_digit),
+      series_states_(number_of_series, decompressor_.SaveSeriesState()) {}
+
+bool NetSerfXORDemultiplexer::Decompress(Array<uint8_t> &packet, uint32_t *series_id, double *value) {
+  uint32_t id = NetSeriesId::Peek(packet);
+  if (id >= series_states_.size()) {
+    return false;
+  }
+  net_serf_xor_series_state_t &state = series_states_[id];
+  decompressor_.LoadSeriesState(state);
+  *value = decompressor_.Decompress(packet);
+  state = decompressor_.SaveSeriesState();
+  *series_id = id;
+  return true;
+}
+
+uint32_t NetSerfXORDemultiplexer::number_of_series() const {
+  return series_states_.size();
+}
@@ -0,0 +1,26 @@
+#ifndef NET_SERF_XOR_DEMULTIPLEXER_H
+#define NET_SERF_XOR_DEMULTIPLEXER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "utils/array.h"
+#include "utils/net_series_id.h"
+#include "decompressor/net_serf_xor_decompressor.h"
+
+// Receiving side of NetSerfXORMultiplexer, the series ID from the header indexes the state table directly
+class NetSerfXORDemultiplexer {
+ public:
+  NetSerfXORDemultiplexer(uint32_t number_of_series, int window_size, long adjust_digit);
+
+  // Returns false for an unknown series ID, in which case no state changes
+  bool Decompress(Array<uint8_t> &packet, uint32_t *series_id, double *value);
+
+  uint32_t number_of_series() const;
+
+ private:
+  NetSerfXORDecompressor decompressor_;
+  std::vector<net_serf_xor_series_state_t> series_states_;
+};
+
+#endif  // NET_SERF_XOR_DEMULTIPLEXER_H
@@ -1,13 +1,22 @@
 #include "serf_qt_decompressor.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef SERF_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 SerfQtDecompressor::SerfQtDecompressor() {
   // IAR适配：使用new替代std::make_unique
   input_bit_stream_ = new InputBitStream();
   block_size_ = 0;
   max_diff_ = 0.0f;
-  pre_value_ = 2.0f;
+  coder_ = kSerfQtCoderEliasGamma;
+  predictor_ = kSerfQtPredictorPrevious;
+  coefficient_ = 0;
+  power_of_two_step_ = false;
+  step_exponent_ = 0;
 }
 
 SerfQtDecompressor::~SerfQtDecompressor() {
@@ -16,7 +25,7 @@ SerfQtDecompressor::~SerfQtDecompressor() {
   }
 }
 
-Array<float> SerfQtDecompressor::Decompress(const Array<uint8_t> &bs, uint32_t valid_bits) {
+bool SerfQtDecompressor::ReadHeader(const Array<uint8_t> &bs, uint32_t valid_bits) {
   input_bit_stream_->SetBuffer(bs);
   if (valid_bits > 0) {
     input_bit_stream_->SetValidBits(valid_bits);
@@ -24,9 +33,37 @@ Array<float> SerfQtDecompressor::Decompress(const Array<uint8_t> &bs, uint32_t v
   
   block_size_ = input_bit_stream_->ReadInt(16);
   uint32_t max_diff_bits = input_bit_stream_->ReadLong(32);
-  max_diff_ = Double::LongBitsToFloat(max_diff_bits);
+  max_diff_ = Double::LongBitsToFloat(max_diff_bits & ~kSerfQtExtendedHeaderFlag);
+  power_of_two_step_ = PowerOfTwoBound::IsPowerOfTwo(max_diff_);
+  step_exponent_ = PowerOfTwoBound::Exponent(max_diff_) + 1;
+  // 符号位未置位的block没有coder字段，是Elias Gamma
+  coder_ = kSerfQtCoderEliasGamma;
+  predictor_ = kSerfQtPredictorPrevious;
+  coefficient_ = 0;
+  if ((max_diff_bits & kSerfQtExtendedHeaderFlag) != 0) {
+    coder_ = (uint8_t)input_bit_stream_->ReadInt(2);
+  }
+  if (coder_ == kSerfQtCoderFieldPredicted) {
+    coder_ = (uint8_t)input_bit_stream_->ReadInt(2);
+    predictor_ = (uint8_t)input_bit_stream_->ReadInt(2);
+    if (predictor_ == kSerfQtPredictorLinear) {
+      // 4位补码
+      uint8_t coefficient = (uint8_t)input_bit_stream_->ReadInt(QtPredictor::kCoefficientBits);
+      coefficient_ = (int8_t)(coefficient >= 8 ? coefficient - 16 : coefficient);
+    } else if (predictor_ != kSerfQtPredictorDeltaOfDelta) {
+      return false;
+    }
+  }
   
-  pre_value_ = 2.0f;
+  return coder_ == kSerfQtCoderEliasGamma || coder_ == kSerfQtCoderRans || coder_ == kSerfQtCoderPacked;
+}
+
+Array<float> SerfQtDecompressor::Decompress(const Array<uint8_t> &bs, uint32_t valid_bits) {
+  SERF_PERF_SCOPE(kPerfRegionDecompress);
+  if (!ReadHeader(bs, valid_bits)) {
+    printf("Decompress failed: unknown coder %u or predictor %u\n", coder_, predictor_);
+    return Array<float>(0);
+  }
   
   // IAR适配：使用固定大小数组替代std::vector
   Array<float> decompressed_value_list(block_size_);
@@ -35,25 +72,19 @@ Array<float> SerfQtDecompressor::Decompress(const Array<uint8_t> &bs, uint32_t v
     return Array<float>(0); // 返回空数组
   }
   
-  for (uint16_t i = 0; i < block_size_; i++) {
-    decompressed_value_list[i] = NextValue();
+  if (!DecodeBlock(decompressed_value_list.begin())) {
+    return Array<float>(0);
   }
-  
   return decompressed_value_list;
 }
 
 bool SerfQtDecompressor::DecompressTo(const Array<uint8_t> &bs, Array<float> &output, uint32_t valid_bits) {
-  input_bit_stream_->SetBuffer(bs);
-  if (valid_bits > 0) {
-    input_bit_stream_->SetValidBits(valid_bits);
+  SERF_PERF_SCOPE(kPerfRegionDecompress);
+  if (!ReadHeader(bs, valid_bits)) {
+    printf("DecompressTo: unknown coder %u or predictor %u\n", coder_, predictor_);
+    return false;
   }
   
-  block_size_ = input_bit_stream_->ReadInt(16);
-  uint32_t max_diff_bits = input_bit_stream_->ReadLong(32);
-  max_diff_ = Double::LongBitsToFloat(max_diff_bits);
-  
-  pre_value_ = 2.0f;
-  
   // 确保output数组有足够的空间
   if (!output.is_valid() || output.length() < block_size_) {
     printf("DecompressTo: output array invalid or too small\n");
@@ -61,23 +92,152 @@ bool SerfQtDecompressor::DecompressTo(const Array<uint8_t> &bs, Array<float> &ou
   }
   
   // 直接写入output数组
+  return DecodeBlock(output.begin());
+}
+
+bool SerfQtDecompressor::DecodeBlock(float *output) {
+  // 先把整个block的q解码到output中（int32与float同宽），再统一重建
+  if (coder_ == kSerfQtCoderRans) {
+    if (!DecodeRansBlock(output)) {
+      return false;
+    }
+  } else if (coder_ == kSerfQtCoderPacked) {
+    if (!DecodePackedBlock(output)) {
+      return false;
+    }
+  } else {
+    DecodeEliasGammaBlock(output);
+  }
+  if (predictor_ != kSerfQtPredictorPrevious) {
+    RestoreDeltas(output);
+  }
+  RecoverBlock(output);
+  return true;
+}
+
+void SerfQtDecompressor::DecodeEliasGammaBlock(float *output) {
+  for (uint16_t i = 0; i < block_size_; i++) {
+    int32_t q = ZigZagCodec::Decode(EliasGammaCodec::Decode(input_bit_stream_) - 1);
+    memcpy(output + i, &q, sizeof(q));
+  }
+}
+
+bool SerfQtDecompressor::DecodePackedBlock(float *output) {
+  // zigzag值直接解包到output的存储中，再原地还原为q
+  uint32_t *zigzag_values = (uint32_t *)output;
+  if (!BitPackingCodec::Decode(input_bit_stream_, block_size_, zigzag_values)) {
+    printf("DecodePackedBlock: malformed packed payload\n");
+    return false;
+  }
   for (uint16_t i = 0; i < block_size_; i++) {
-    output[i] = NextValue();
+    int32_t q = ZigZagCodec::Decode((int32_t)zigzag_values[i]);
+    memcpy(output + i, &q, sizeof(q));
+  }
+  return true;
+}
+
+bool SerfQtDecompressor::DecodeRansBlock(float *output) {
+  uint16_t freq[RansCodec::kAlphabetSize];
+  if (input_bit_stream_->ReadBit()) {
+    RansCodec::ReadFrequencies(input_bit_stream_, freq);
+  } else {
+    memcpy(freq, RansCodec::kStaticFrequencies, sizeof(freq));
+  }
+  
+  Array<uint8_t> slot_to_symbol(RansCodec::kTotalFreq);
+  Array<uint8_t> symbols(block_size_);
+  if (!slot_to_symbol.is_valid() || !symbols.is_valid() ||
+      !RansCodec::Decode(input_bit_stream_, freq, slot_to_symbol.begin(), symbols.begin(), block_size_)) {
+    printf("DecodeRansBlock: failed to decode rANS payload\n");
+    return false;
   }
   
+  // escape值按顺序位于rANS数据之后
+  for (uint16_t i = 0; i < block_size_; i++) {
+    int32_t zigzag_value = symbols[i];
+    if (symbols[i] == RansCodec::kEscapeSymbol) {
+      zigzag_value = EliasGammaCodec::Decode(input_bit_stream_) - 1 + RansCodec::kEscapeSymbol;
+    }
+    int32_t q = ZigZagCodec::Decode(zigzag_value);
+    memcpy(output + i, &q, sizeof(q));
+  }
   return true;
 }
 
+void SerfQtDecompressor::RestoreDeltas(float *output) {
+  // 残差还原为q，须与SerfQtCompressor::SelectPredictor()一致；前两个值的预测为0
+  int32_t previous_delta = 0;
+  for (uint16_t i = 0; i < block_size_; i++) {
+    int32_t residual;
+    memcpy(&residual, output + i, sizeof(residual));
+    int32_t prediction = predictor_ == kSerfQtPredictorDeltaOfDelta ?
+        previous_delta : QtPredictor::Linear(coefficient_, previous_delta);
+    int32_t delta = QtPredictor::Restore(residual, prediction);
+    memcpy(output + i, &delta, sizeof(delta));
+    previous_delta = i == 0 ? 0 : delta;
+  }
+}
+
 void SerfQtDecompressor::Clear() {
   if (input_bit_stream_ != NULL) {
     input_bit_stream_->Clear();
   }
 }
 
-float SerfQtDecompressor::NextValue() {
-  int32_t eliasGammaValue = EliasGammaCodec::Decode(input_bit_stream_);
-  int32_t decodeValue = ZigZagCodec::Decode(eliasGammaValue - 1);
-  float recoverValue = pre_value_ + 2.0f * max_diff_ * (float)decodeValue;
-  pre_value_ = recoverValue;
-  return recoverValue;
+#ifdef SERF_AVX2_DISPATCH
+// 8路int32前缀和：先在两个128位通道内各自累加，再把低通道的和加到高通道，最后加上前一组的总和
+__attribute__((target("avx2")))
+static void RecoverBlockAvx2(float *output, uint16_t count, float step) {
+  const __m256 two = _mm256_set1_ps(2.0f);
+  const __m256 step_vector = _mm256_set1_ps(step);
+  const __m256i last_lane = _mm256_set1_epi32(7);
+  __m256i carry = _mm256_setzero_si256();
+  uint16_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(output + i));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    __m256i low_sum = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low_sum, low_sum, 0x08));
+    x = _mm256_add_epi32(x, carry);
+    carry = _mm256_permutevar8x32_epi32(x, last_lane);
+    _mm256_storeu_ps(output + i, _mm256_add_ps(two, _mm256_mul_ps(step_vector, _mm256_cvtepi32_ps(x))));
+  }
+  int32_t position = _mm256_cvtsi256_si32(carry);
+  for (; i < count; i++) {
+    int32_t q;
+    memcpy(&q, output + i, sizeof(q));
+    position += q;
+    output[i] = 2.0f + step * (float)position;
+  }
+}
+#endif
+
+void SerfQtDecompressor::RecoverBlock(float *output) {
+  // 重建值为2 + 2 * max_diff * (q之和)，累加在整数上进行，浮点误差不随block累积；须与压缩端逐位一致
+  const float step = 2.0f * max_diff_;
+#ifdef SERF_AVX2_DISPATCH
+  static const bool use_avx2 = __builtin_cpu_supports("avx2");
+  if (use_avx2) {
+    RecoverBlockAvx2(output, block_size_, step);
+    return;
+  }
+#endif
+  int32_t position = 0;
+  if (power_of_two_step_) {
+    // 与乘以step逐位相同，8051上省去软件浮点乘法
+    for (uint16_t i = 0; i < block_size_; i++) {
+      int32_t q;
+      memcpy(&q, output + i, sizeof(q));
+      position += q;
+      output[i] = 2.0f + PowerOfTwoBound::Scale((float)position, step_exponent_);
+    }
+    return;
+  }
+  for (uint16_t i = 0; i < block_size_; i++) {
+    int32_t q;
+    memcpy(&q, output + i, sizeof(q));
+    position += q;
+    output[i] = 2.0f + step * (float)position;
+  }
 }
@@ -10,6 +10,11 @@
 #include "../utils/zig_zag_codec.h"
 #include "../utils/elias_gamma_codec.h"
 #include "../utils/array.h"
+#include "../utils/perf_counters.h"
+#include "../utils/rans_codec.h"
+#include "../utils/bit_packing_codec.h"
+#include "../utils/power_of_two_bound.h"
+#include "../compressor/serf_qt_compressor.h"
 
 class SerfQtDecompressor {
  public:
@@ -29,9 +34,20 @@ class SerfQtDecompressor {
   uint16_t block_size_;
   float max_diff_;
   InputBitStream* input_bit_stream_; // 使用指针替代std::unique_ptr
-  float pre_value_;
+  uint8_t coder_;
+  uint8_t predictor_;
+  int8_t coefficient_;
+  // max_diff为2的幂时，重建只调整指数域
+  bool power_of_two_step_;
+  int16_t step_exponent_;
 
-  float NextValue();
+  bool ReadHeader(const Array<uint8_t> &bs, uint32_t valid_bits);
+  bool DecodeBlock(float *output);
+  void DecodeEliasGammaBlock(float *output);
+  bool DecodeRansBlock(float *output);
+  bool DecodePackedBlock(float *output);
+  void RestoreDeltas(float *output);
+  void RecoverBlock(float *output);
 };
 
 #endif //SERF_QT_DECOMPRESSOR_H
@@ -0,0 +1,85 @@
+#include "serf_trajectory_decompressor.h"
+#include <stdio.h>
+
+SerfTrajectoryDecompressor::SerfTrajectoryDecompressor() {
+  input_bit_stream_ = new InputBitStream();
+  number_of_points_ = 0;
+  max_diff_latitude_ = 0.0f;
+  max_diff_longitude_ = 0.0f;
+  predictor_ = kSerfTrajectoryPredictorPrevious;
+  still_flag_ = false;
+}
+
+SerfTrajectoryDecompressor::~SerfTrajectoryDecompressor() {
+  if (input_bit_stream_ != NULL) {
+    delete input_bit_stream_;
+  }
+}
+
+void SerfTrajectoryDecompressor::ReadHeader(const Array<uint8_t> &bs, uint32_t valid_bits) {
+  input_bit_stream_->SetBuffer(bs);
+  if (valid_bits > 0) {
+    input_bit_stream_->SetValidBits(valid_bits);
+  }
+
+  number_of_points_ = input_bit_stream_->ReadInt(16);
+  max_diff_latitude_ = Double::LongBitsToFloat(input_bit_stream_->ReadLong(32));
+  max_diff_longitude_ = Double::LongBitsToFloat(input_bit_stream_->ReadLong(32));
+  predictor_ = input_bit_stream_->ReadBit() ? kSerfTrajectoryPredictorVelocity : kSerfTrajectoryPredictorPrevious;
+  still_flag_ = input_bit_stream_->ReadBit();
+}
+
+Array<trajectory_point_t> SerfTrajectoryDecompressor::Decompress(const Array<uint8_t> &bs, uint32_t valid_bits) {
+  ReadHeader(bs, valid_bits);
+  Array<trajectory_point_t> points(number_of_points_);
+  if (!points.is_valid()) {
+    printf("Decompress failed: cannot create array of size %lu\n", (unsigned long)number_of_points_);
+    return Array<trajectory_point_t>(0);
+  }
+  DecodePoints(points);
+  return points;
+}
+
+bool SerfTrajectoryDecompressor::DecompressTo(const Array<uint8_t> &bs, Array<trajectory_point_t> &output,
+                                              uint32_t valid_bits) {
+  ReadHeader(bs, valid_bits);
+  if (!output.is_valid() || output.length() < number_of_points_) {
+    printf("DecompressTo: output array invalid or too small\n");
+    return false;
+  }
+  DecodePoints(output);
+  return true;
+}
+
+uint16_t SerfTrajectoryDecompressor::number_of_points() const {
+  return number_of_points_;
+}
+
+void SerfTrajectoryDecompressor::DecodePoints(Array<trajectory_point_t> &output) {
+  if (number_of_points_ == 0) {
+    return;
+  }
+  float latitude = Double::LongBitsToFloat(input_bit_stream_->ReadLong(32));
+  float longitude = Double::LongBitsToFloat(input_bit_stream_->ReadLong(32));
+  float before_latitude = latitude;
+  float before_longitude = longitude;
+  output[0].latitude = latitude;
+  output[0].longitude = longitude;
+
+  for (uint16_t i = 1; i < number_of_points_; i++) {
+    float latitude_pred = SerfTrajectoryPredict(predictor_, latitude, before_latitude);
+    float longitude_pred = SerfTrajectoryPredict(predictor_, longitude, before_longitude);
+    int32_t latitude_q = 0;
+    int32_t longitude_q = 0;
+    if (!still_flag_ || input_bit_stream_->ReadBit()) {
+      latitude_q = ZigZagCodec::Decode(EliasGammaCodec::Decode(input_bit_stream_) - 1);
+      longitude_q = ZigZagCodec::Decode(EliasGammaCodec::Decode(input_bit_stream_) - 1);
+    }
+    before_latitude = latitude;
+    latitude = latitude_pred + 2.0f * max_diff_latitude_ * (float)latitude_q;
+    before_longitude = longitude;
+    longitude = longitude_pred + 2.0f * max_diff_longitude_ * (float)longitude_q;
+    output[i].latitude = latitude;
+    output[i].longitude = longitude;
+  }
+}
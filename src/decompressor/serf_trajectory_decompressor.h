@@ -0,0 +1,40 @@
+#ifndef SERF_TRAJECTORY_DECOMPRESSOR_H
+#define SERF_TRAJECTORY_DECOMPRESSOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../utils/double.h"
+#include "../utils/input_bit_stream.h"
+#include "../utils/zig_zag_codec.h"
+#include "../utils/elias_gamma_codec.h"
+#include "../utils/array.h"
+#include "../utils/file_reader.h"
+#include "../compressor/serf_trajectory_compressor.h"
+
+class SerfTrajectoryDecompressor {
+ public:
+  SerfTrajectoryDecompressor();
+  ~SerfTrajectoryDecompressor();
+
+  Array<trajectory_point_t> Decompress(const Array<uint8_t> &bs, uint32_t valid_bits = 0);
+
+  // 通过引用参数返回结果，output至少容纳number_of_points()个点
+  bool DecompressTo(const Array<uint8_t> &bs, Array<trajectory_point_t> &output, uint32_t valid_bits = 0);
+
+  // 最近一次解压的block中的点数
+  uint16_t number_of_points() const;
+
+ private:
+  InputBitStream* input_bit_stream_;
+  uint16_t number_of_points_;
+  float max_diff_latitude_;
+  float max_diff_longitude_;
+  uint8_t predictor_;
+  bool still_flag_;
+
+  void ReadHeader(const Array<uint8_t> &bs, uint32_t valid_bits);
+  void DecodePoints(Array<trajectory_point_t> &output);
+};
+
+#endif  // SERF_TRAJECTORY_DECOMPRESSOR_H
@@ -1,13 +1,17 @@
 #include "serf_xor_decompressor.h"
 
 std::vector<double> SerfXORDecompressor::Decompress(const Array<uint8_t> &bs) {
+  SERF_PERF_SCOPE(kPerfRegionDecompress);
   input_bit_stream_.SetBuffer(bs);
+  uint16_t count = static_cast<uint16_t>(input_bit_stream_.ReadInt(16));
   UpdatePositionsIfNeeded();
-  std::vector<double> values; values.reserve(1000);
-  uint64_t value;
-  while (SERF_LIKELY((value = ReadValue()) != Double::DoubleToLongBits(Double::kNan))) {
-    values.emplace_back(Double::LongBitsToDouble(value) - static_cast<double>(adjust_digit_));
-    stored_val_ = value;
+  if (kOnlineAdjustDigit) {
+    UpdateAdjustDigitIfNeeded();
+  }
+  std::vector<double> values(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    stored_val_ = ReadValue();
+    values[i] = Double::LongBitsToDouble(stored_val_) - static_cast<double>(adjust_digit_);
   }
   return values;
 }
@@ -44,6 +48,14 @@ void SerfXORDecompressor::UpdatePositionsIfNeeded() {
   }
 }
 
+void SerfXORDecompressor::UpdateAdjustDigitIfNeeded() {
+  if (input_bit_stream_.ReadBit()) {
+    long adjust_digit = static_cast<long>(input_bit_stream_.ReadInt(32));
+    stored_val_ = Double::DoubleToLongBits(Double::LongBitsToDouble(stored_val_) - adjust_digit_ + adjust_digit);
+    adjust_digit_ = adjust_digit;
+  }
+}
+
 void SerfXORDecompressor::UpdateLeadingRepresentation() {
   int num = static_cast<int>(input_bit_stream_.ReadInt(5));
   num = branch_less_table[num];
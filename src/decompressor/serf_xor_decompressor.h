@@ -21,10 +21,14 @@
 #include "utils/double.h"
 #include "utils/array.h"
 #include "utils/serf_utils_64.h"
+#include "utils/perf_counters.h"
 
 class SerfXORDecompressor {
  public:
-  explicit SerfXORDecompressor(long adjust_digit) : adjust_digit_(adjust_digit) {};
+  explicit SerfXORDecompressor(long adjust_digit) : kOnlineAdjustDigit(false), adjust_digit_(adjust_digit) {};
+
+  // Pairs with SerfXORCompressor(windows_size, max_diff), the adjust digit is read from the block headers
+  SerfXORDecompressor() : kOnlineAdjustDigit(true), adjust_digit_(0) {};
 
   std::vector<double> Decompress(const Array<uint8_t> &bs);
 
@@ -37,6 +41,7 @@ class SerfXORDecompressor {
   Array<int> trailing_representation_ = {0, 22, 28, 32, 36, 40, 42, 46};
   int leading_bits_per_value_ = 3;
   int trailing_bits_per_value_ = 3;
+  const bool kOnlineAdjustDigit;
   long adjust_digit_;
 
   int branch_less_table[32] = {32, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
@@ -46,6 +51,7 @@ class SerfXORDecompressor {
 
   uint64_t ReadValue();
   void UpdatePositionsIfNeeded();
+  void UpdateAdjustDigitIfNeeded();
   void UpdateLeadingRepresentation();
   void UpdateTrailingRepresentation();
 };
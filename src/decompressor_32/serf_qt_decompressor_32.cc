@@ -4,6 +4,8 @@ std::vector<float> SerfQtDecompressor32::Decompress(const Array<uint8_t> &bs) {
   input_bit_stream_->SetBuffer(bs);
   block_size_ = input_bit_stream_->ReadInt(16);
   max_diff_ = Float::IntBitsToFloat(input_bit_stream_->ReadInt(32));
+  power_of_two_step_ = PowerOfTwoBound::IsPowerOfTwo(max_diff_);
+  step_exponent_ = PowerOfTwoBound::Exponent(max_diff_) + 1;
   pre_value_ = 2;
   std::vector<float> decompressedValueList;
   decompressedValueList.reserve(block_size_);
@@ -13,7 +15,9 @@ std::vector<float> SerfQtDecompressor32::Decompress(const Array<uint8_t> &bs) {
 
 float SerfQtDecompressor32::NextValue() {
   int64_t decodeValue = ZigZagCodec::Decode(EliasGammaCodec::Decode(input_bit_stream_.get()) - 1);
-  float recoverValue = pre_value_ + 2 * max_diff_ * static_cast<float>(decodeValue);
+  float recoverValue = power_of_two_step_ ?
+      pre_value_ + std::ldexp(static_cast<float>(decodeValue), step_exponent_) :
+      pre_value_ + 2 * max_diff_ * static_cast<float>(decodeValue);
   pre_value_ = recoverValue;
   return recoverValue;
 }
@@ -8,6 +8,7 @@
 #include "utils/elias_gamma_codec.h"
 #include "utils/float.h"
 #include "utils/input_bit_stream.h"
+#include "utils/power_of_two_bound.h"
 
 class SerfQtDecompressor32 {
  public:
@@ -17,6 +18,9 @@ class SerfQtDecompressor32 {
  private:
   int block_size_;
   float max_diff_;
+  // a power-of-two max_diff is recovered with ldexp instead of a multiply
+  bool power_of_two_step_ = false;
+  int step_exponent_ = 0;
   std::unique_ptr<InputBitStream> input_bit_stream_ = std::make_unique<InputBitStream>();
   float pre_value_ = 2;
 
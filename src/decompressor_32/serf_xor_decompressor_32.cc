@@ -2,13 +2,12 @@
 
 std::vector<float> SerfXORDecompressor32::Decompress(const Array<uint8_t> &bs) {
   input_bit_stream_->SetBuffer(bs);
+  uint16_t count = static_cast<uint16_t>(input_bit_stream_->ReadInt(16));
   UpdatePositionsIfNeeded();
-  std::vector<float> values;
-  values.reserve(1000);
-  uint32_t value;
-  while (SERF_LIKELY((value = ReadValue()) != Float::FloatToIntBits(Float::kNan))) {
-    values.emplace_back(Float::IntBitsToFloat(value));
-    stored_val_ = value;
+  std::vector<float> values(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    stored_val_ = ReadValue();
+    values[i] = Float::IntBitsToFloat(stored_val_);
   }
   return values;
 }
@@ -5,9 +5,14 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#if __cplusplus >= 201103L
+#include <initializer_list>
+#endif
+
+#include "serf_config.h"
 
 // IAR适配：使用malloc/free，确保正确的内存管理
-#define MAX_ARRAY_SIZE 512
+// 长度上限MAX_ARRAY_SIZE由平台profile决定
 
 template<typename T>
 class Array {
@@ -15,11 +20,31 @@ class Array {
   Array<T>() : length_(0), data_(NULL) {
   }
 
-  explicit Array<T>(uint16_t length) : length_(length), data_(NULL) {
-    if (length > 0 && length <= MAX_ARRAY_SIZE) {
-      data_ = (T*)malloc(length * sizeof(T));
+  explicit Array<T>(serf_size_t length) : length_(length), data_(NULL) {
+    if (IsValidLength(length)) {
+      data_ = (T*)malloc((size_t)length * sizeof(T));
+      if (data_ != NULL) {
+        memset(data_, 0, (size_t)length * sizeof(T));
+      } else {
+        length_ = 0;
+      }
+    } else {
+      length_ = 0;
+    }
+  }
+
+#if __cplusplus >= 201103L
+  // 宿主机构建：64位SERF-XOR的位置表使用列表初始化，IAR EW8051不支持。
+  // GCC 12把内联后列表的底层常量数组误报为可能未初始化，只在这里关闭-Wmaybe-uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+  Array<T>(std::initializer_list<T> list) : length_((serf_size_t)list.size()), data_(NULL) {
+    if (IsValidLength(length_)) {
+      data_ = (T*)malloc((size_t)length_ * sizeof(T));
       if (data_ != NULL) {
-        memset(data_, 0, length * sizeof(T));
+        memcpy(data_, list.begin(), (size_t)length_ * sizeof(T));
       } else {
         length_ = 0;
       }
@@ -27,13 +52,17 @@ class Array {
       length_ = 0;
     }
   }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
 
   // 复制构造函数
   Array<T>(const Array<T> &other) : length_(other.length_), data_(NULL) {
-    if (other.data_ != NULL && length_ > 0 && length_ <= MAX_ARRAY_SIZE) {
-      data_ = (T*)malloc(length_ * sizeof(T));
+    if (other.data_ != NULL && IsValidLength(length_)) {
+      data_ = (T*)malloc((size_t)length_ * sizeof(T));
       if (data_ != NULL) {
-        memcpy(data_, other.data_, length_ * sizeof(T));
+        memcpy(data_, other.data_, (size_t)length_ * sizeof(T));
       } else {
         length_ = 0;
       }
@@ -52,10 +81,10 @@ class Array {
       }
       
       length_ = right.length_;
-      if (right.data_ != NULL && length_ > 0 && length_ <= MAX_ARRAY_SIZE) {
-        data_ = (T*)malloc(length_ * sizeof(T));
+      if (right.data_ != NULL && IsValidLength(length_)) {
+        data_ = (T*)malloc((size_t)length_ * sizeof(T));
         if (data_ != NULL) {
-          memcpy(data_, right.data_, length_ * sizeof(T));
+          memcpy(data_, right.data_, (size_t)length_ * sizeof(T));
         } else {
           length_ = 0;
         }
@@ -73,11 +102,11 @@ class Array {
     }
   }
 
-  T &operator[](uint16_t index) const {
+  T &operator[](serf_size_t index) const {
     if (data_ != NULL && index < length_) {
       return data_[index];
     }
-    static T error_value = {0};
+    static T error_value = {};
     return error_value;
   }
 
@@ -89,7 +118,7 @@ class Array {
     return (data_ != NULL) ? (data_ + length_) : NULL;
   }
 
-  uint16_t length() const {
+  serf_size_t length() const {
     return length_;
   }
 
@@ -99,7 +128,7 @@ class Array {
   
   void swap(Array<T> &other) {
     T* temp_data = data_;
-    uint16_t temp_length = length_;
+    serf_size_t temp_length = length_;
     
     data_ = other.data_;
     length_ = other.length_;
@@ -109,8 +138,17 @@ class Array {
   }
 
  private:
-  uint16_t length_;
+  serf_size_t length_;
   T* data_;
+
+  // 宿主机上MAX_ARRAY_SIZE为serf_size_t的最大值，上限比较恒为真（-Wtype-limits），只在更小的上限下比较
+  static bool IsValidLength(serf_size_t length) {
+#if MAX_ARRAY_SIZE < SERF_SIZE_MAX
+    return length > 0 && length <= MAX_ARRAY_SIZE;
+#else
+    return length > 0;
+#endif
+  }
 };
 
 #endif  // SERF_ARRAY_H
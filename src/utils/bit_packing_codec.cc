@@ -0,0 +1,196 @@
+#include "bit_packing_codec.h"
+#include <string.h>
+
+#ifdef SERF_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+// 向上取整到字节边界的位数
+static inline uint32_t PaddedBits(uint32_t bits) {
+  return (bits + 7) & ~(uint32_t)7;
+}
+
+static inline uint32_t LowMask(uint8_t width) {
+  return width >= 32 ? 0xFFFFFFFFUL : ((uint32_t)1 << width) - 1;
+}
+
+uint8_t BitPackingCodec::BitWidth(uint32_t value) {
+#ifdef __GNUC__
+  return value == 0 ? 0 : (uint8_t)(32 - __builtin_clz(value));
+#else
+  uint8_t width = 0;
+  while (value != 0) {
+    value >>= 1;
+    width++;
+  }
+  return width;
+#endif
+}
+
+BitPackingCodec::mini_block_layout_t BitPackingCodec::ChooseLayout(const uint32_t *values, uint16_t count) {
+  uint16_t histogram[33];
+  memset(histogram, 0, sizeof(histogram));
+  uint8_t max_width = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t width = BitWidth(values[i]);
+    ++histogram[width];
+    if (width > max_width) {
+      max_width = width;
+    }
+  }
+
+  // 从最大宽度向下尝试，宽于b的值成为异常；代价相同时取异常更少的宽度
+  mini_block_layout_t best = {max_width, 0, 0};
+  uint32_t best_bits = MiniBlockBits(best, count);
+  uint16_t exception_count = 0;
+  for (int width = max_width - 1; width >= 0; width--) {
+    exception_count += histogram[width + 1];
+    mini_block_layout_t layout = {(uint8_t)width, (uint8_t)exception_count, (uint8_t)(max_width - width)};
+    uint32_t bits = MiniBlockBits(layout, count);
+    if (bits < best_bits) {
+      best = layout;
+      best_bits = bits;
+    }
+  }
+  return best;
+}
+
+uint32_t BitPackingCodec::MiniBlockBits(const mini_block_layout_t &layout, uint16_t count) {
+  return 24 + PaddedBits((uint32_t)count * layout.width) + 8 * (uint32_t)layout.exception_count +
+      PaddedBits((uint32_t)layout.exception_count * layout.high_width);
+}
+
+uint32_t BitPackingCodec::EncodedBits(const uint32_t *values, uint16_t count, uint32_t bit_position) {
+  uint32_t bits = PaddedBits(bit_position) - bit_position;
+  for (uint16_t offset = 0; offset < count; offset += kMiniBlockSize) {
+    uint16_t length = count - offset < kMiniBlockSize ? count - offset : kMiniBlockSize;
+    bits += MiniBlockBits(ChooseLayout(values + offset, length), length);
+  }
+  return bits;
+}
+
+uint32_t BitPackingCodec::Encode(const uint32_t *values, uint16_t count, OutputBitStream *output_bit_stream_ptr) {
+  uint32_t bits = output_bit_stream_ptr->AlignToByte();
+  for (uint16_t offset = 0; offset < count; offset += kMiniBlockSize) {
+    uint16_t length = count - offset < kMiniBlockSize ? count - offset : kMiniBlockSize;
+    const uint32_t *mini_block = values + offset;
+    mini_block_layout_t layout = ChooseLayout(mini_block, length);
+    bits += output_bit_stream_ptr->WriteInt(layout.width, 8);
+    bits += output_bit_stream_ptr->WriteInt(layout.exception_count, 8);
+    bits += output_bit_stream_ptr->WriteInt(layout.high_width, 8);
+
+    uint32_t mask = LowMask(layout.width);
+    for (uint16_t i = 0; i < length; i++) {
+      bits += output_bit_stream_ptr->WriteInt(mini_block[i] & mask, layout.width);
+    }
+    bits += output_bit_stream_ptr->AlignToByte();
+    if (layout.exception_count == 0) {
+      continue;
+    }
+    for (uint16_t i = 0; i < length; i++) {
+      if (mini_block[i] > mask) {
+        bits += output_bit_stream_ptr->WriteInt(i, 8);
+      }
+    }
+    for (uint16_t i = 0; i < length; i++) {
+      if (mini_block[i] > mask) {
+        bits += output_bit_stream_ptr->WriteInt(mini_block[i] >> layout.width, layout.high_width);
+      }
+    }
+    bits += output_bit_stream_ptr->AlignToByte();
+  }
+  return bits;
+}
+
+#if SERF_DOUBLE_WIDTH == 64
+
+#ifdef SERF_AVX2_DISPATCH
+// 每次8个值：按位偏移gather出4字节，变长右移后取低width位；width不超过25时4字节足够
+__attribute__((target("avx2")))
+static uint16_t UnpackAvx2(const uint8_t *bytes, uint32_t available, uint16_t count, uint8_t width,
+                           uint32_t *out_values) {
+  const __m256i mask = _mm256_set1_epi32((int32_t)LowMask(width));
+  const __m256i seven = _mm256_set1_epi32(7);
+  const __m256i step = _mm256_set1_epi32(8 * width);
+  __m256i bit_offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(width));
+  uint16_t i = 0;
+  for (; i + 8 <= count && (((uint32_t)(i + 7) * width) >> 3) + 4 <= available; i += 8) {
+    __m256i words = _mm256_i32gather_epi32((const int *)bytes, _mm256_srli_epi32(bit_offsets, 3), 1);
+    words = _mm256_srlv_epi32(words, _mm256_and_si256(bit_offsets, seven));
+    _mm256_storeu_si256((__m256i *)(out_values + i), _mm256_and_si256(words, mask));
+    bit_offsets = _mm256_add_epi32(bit_offsets, step);
+  }
+  return i;
+}
+#endif
+
+void BitPackingCodec::Unpack(const uint8_t *bytes, uint32_t available, uint16_t count, uint8_t width,
+                             uint32_t *out_values) {
+  uint16_t i = 0;
+#ifdef SERF_AVX2_DISPATCH
+  static const bool use_avx2 = __builtin_cpu_supports("avx2");
+  if (use_avx2 && width <= 25) {
+    i = UnpackAvx2(bytes, available, count, width, out_values);
+  }
+#endif
+  const uint64_t mask = LowMask(width);
+  for (; i < count; i++) {
+    uint32_t bit_offset = (uint32_t)i * width;
+    uint32_t byte_offset = bit_offset >> 3;
+    uint64_t word = 0;
+    // 末尾不足8字节时只读剩余部分
+    uint32_t length = available - byte_offset < 8 ? available - byte_offset : 8;
+    memcpy(&word, bytes + byte_offset, length);
+    out_values[i] = (uint32_t)((word >> (bit_offset & 7)) & mask);
+  }
+}
+
+#endif
+
+bool BitPackingCodec::Decode(InputBitStream *input_bit_stream_ptr, uint16_t count, uint32_t *out_values) {
+  input_bit_stream_ptr->AlignToByte();
+  for (uint16_t offset = 0; offset < count; offset += kMiniBlockSize) {
+    uint16_t length = count - offset < kMiniBlockSize ? count - offset : kMiniBlockSize;
+    uint32_t *mini_block = out_values + offset;
+    uint8_t width = (uint8_t)input_bit_stream_ptr->ReadInt(8);
+    uint8_t exception_count = (uint8_t)input_bit_stream_ptr->ReadInt(8);
+    uint8_t high_width = (uint8_t)input_bit_stream_ptr->ReadInt(8);
+    if (width > 32 || exception_count > length ||
+        (exception_count > 0 && (high_width == 0 || width + high_width > 32))) {
+      return false;
+    }
+
+#if SERF_DOUBLE_WIDTH == 64
+    uint32_t packed_bits = PaddedBits((uint32_t)length * width);
+    uint32_t available;
+    const uint8_t *bytes = input_bit_stream_ptr->AlignedBytes(&available);
+    if (bytes == NULL || packed_bits / 8 > available) {
+      return false;
+    }
+    Unpack(bytes, packed_bits / 8, length, width, mini_block);
+    input_bit_stream_ptr->Skip(packed_bits);
+#else
+    // 8051：逐个按位读取，布局相同
+    for (uint16_t i = 0; i < length; i++) {
+      mini_block[i] = input_bit_stream_ptr->ReadInt(width);
+    }
+    input_bit_stream_ptr->AlignToByte();
+#endif
+
+    if (exception_count == 0) {
+      continue;
+    }
+    uint8_t positions[kMiniBlockSize];
+    for (uint8_t e = 0; e < exception_count; e++) {
+      positions[e] = (uint8_t)input_bit_stream_ptr->ReadInt(8);
+      if (positions[e] >= length) {
+        return false;
+      }
+    }
+    for (uint8_t e = 0; e < exception_count; e++) {
+      mini_block[positions[e]] |= input_bit_stream_ptr->ReadInt(high_width) << width;
+    }
+    input_bit_stream_ptr->AlignToByte();
+  }
+  return true;
+}
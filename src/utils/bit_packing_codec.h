@@ -0,0 +1,55 @@
+#ifndef SERF_BIT_PACKING_CODEC_H
+#define SERF_BIT_PACKING_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "output_bit_stream.h"
+#include "input_bit_stream.h"
+#include "double.h"
+
+/*
+ * Frame-of-reference style bit packing of unsigned values, the fixed-width alternative to Elias gamma in
+ * SERF-QT. Values are cut into mini-blocks of kMiniBlockSize; each is packed at one width b, and the few values
+ * wider than b are exceptions whose high bits are patched in afterwards (as in PFor), so one outlier does not
+ * widen the whole mini-block. The payload starts on a byte boundary and every field is byte aligned:
+ *
+ * +---------+-------------+----------------+----------------+-----------------+-------------------+
+ * |8bits - b|8bits - count|8bits - high    |n * b bits      |count * 8 bits   |count * high bits  |
+ * |         |of exceptions|width           |low bits, padded|positions        |high bits, padded  |
+ * +---------+-------------+----------------+----------------+-----------------+-------------------+
+ *
+ * A decoder can unpack the low bits of a mini-block without any data-dependent branch, on hosts with AVX2 eight
+ * values per step, and only touches the exceptions afterwards.
+ */
+
+class BitPackingCodec {
+ public:
+  static const uint16_t kMiniBlockSize = 128;
+
+  // Bits Encode() writes for count values when the stream is at bit_position, alignment padding included
+  static uint32_t EncodedBits(const uint32_t *values, uint16_t count, uint32_t bit_position);
+
+  // Returns the number of bits written
+  static uint32_t Encode(const uint32_t *values, uint16_t count, OutputBitStream *output_bit_stream_ptr);
+
+  // false on a malformed or truncated payload
+  static bool Decode(InputBitStream *input_bit_stream_ptr, uint16_t count, uint32_t *out_values);
+
+ private:
+  typedef struct {
+    uint8_t width;
+    uint8_t exception_count;
+    uint8_t high_width;
+  } mini_block_layout_t;
+
+  static mini_block_layout_t ChooseLayout(const uint32_t *values, uint16_t count);
+  static uint32_t MiniBlockBits(const mini_block_layout_t &layout, uint16_t count);
+  static uint8_t BitWidth(uint32_t value);
+#if SERF_DOUBLE_WIDTH == 64
+  static void Unpack(const uint8_t *bytes, uint32_t available, uint16_t count, uint8_t width,
+                     uint32_t *out_values);
+#endif
+};
+
+#endif  // SERF_BIT_PACKING_CODEC_H
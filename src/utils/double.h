@@ -3,6 +3,10 @@
 
 #include <stdint.h>
 #include <float.h>
+#include <string.h>
+
+// double的位宽（SERF_DOUBLE_WIDTH）、serf_long_t和SERF_AVX2_DISPATCH由平台profile决定
+#include "serf_config.h"
 
 // IAR适配：8051不支持64位整数，使用32位替代
 // 定义64位结构体用于位操作
@@ -16,9 +20,56 @@ typedef struct {
     int32_t high;
 } int64_struct_t;
 
+// 按double位宽选择位模式类型，每个构建只定义与目标平台对应的特化
+template<int kWidth>
+class DoubleTrait;
+
+#if SERF_DOUBLE_WIDTH == 64
+
+#include <limits>
+
+// 宿主机：位模式为真正的uint64_t，SERF-XOR的64位运算按设计工作
+template<>
+class DoubleTrait<64> {
+ public:
+  typedef uint64_t LongBits;
+
+  static constexpr double kNan = std::numeric_limits<double>::quiet_NaN();
+
+  // memcpy而非指针转换，避免违反strict aliasing；编译器会将其优化为一次寄存器移动
+  static inline uint32_t FloatToLongBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static inline float LongBitsToFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static inline uint64_t DoubleToLongBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static inline double LongBitsToDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+};
+
+#else
+
 // IAR适配：使用C风格头文件和float替代double
-class Double {
+template<>
+class DoubleTrait<32> {
  public:
+  typedef uint64_struct_t LongBits;
+
   // 使用float的NaN值 - 使用内联函数避免重复定义
   static inline float kNan() {
     static const float nan_value = -1.0f; // 使用-1.0f作为特殊值
@@ -48,4 +99,8 @@ class Double {
   }
 };
 
+#endif
+
+typedef DoubleTrait<SERF_DOUBLE_WIDTH> Double;
+
 #endif  // SERF_DOUBLE_H
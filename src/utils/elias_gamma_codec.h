@@ -8,16 +8,21 @@
 #include "output_bit_stream.h"
 #include "input_bit_stream.h"
 #include "double.h"
+#include "perf_counters.h"
 
+/*
+ * number（>= 1）的码字：n = floor(log2(number))个0，随后是最高位的1，再是低n位（LSB优先）。
+ * 格式变更（kSerfQtFormatVersion 2）：版本1在n个0之后直接从LSB开始写number，偶数的LSB为0会被解码端当作前导0，
+ * 该版本写出的位流（包括已部署的8051节点上的）与当前解码端不兼容，须用同一版本压缩和解压。
+ */
 class EliasGammaCodec {
  public:
   static int Encode(int32_t number, OutputBitStream *output_bit_stream_ptr);
 
   static int32_t Decode(InputBitStream *input_bit_stream_ptr);
 
- private:
-  // IAR适配：使用const数组替代constexpr
-  static const float kLog2Table[17];
+  // Encode(number)写出的位数，用于不实际写出时估算编码长度
+  static int Length(uint32_t number);
 };
 
 #endif //SERF_ELIAS_GAMMA_CODEC_H_
@@ -4,8 +4,7 @@
 #include <stdlib.h>
 
 // 假设数据文件已经预加载到内存中
-// 由于CC2530内存限制，我们使用静态数组存储轨迹数据
-#define MAX_TRAJECTORY_POINTS 200  // 从2000减少到200
+// 由于CC2530内存限制，我们使用静态数组存储轨迹数据，容量见serf_config.h
 
 // 静态存储轨迹数据 - 移除__xdata，使用CODE区域（ROM），避免XDATA空间不足
 static trajectory_point_t trajectory_data[MAX_TRAJECTORY_POINTS];
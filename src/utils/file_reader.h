@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "serf_config.h"
+
 // 轨迹点结构体
 typedef struct {
     float latitude;
@@ -18,8 +20,7 @@ typedef struct {
     bool file_opened;
 } file_reader_t;
 
-// 最大轨迹点数量
-#define MAX_TRAJECTORY_POINTS 200
+// 最大轨迹点数量MAX_TRAJECTORY_POINTS由平台profile决定
 
 // 函数声明
 bool file_reader_init(file_reader_t* reader, const char* filename);
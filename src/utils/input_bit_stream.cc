@@ -80,7 +80,13 @@ void InputBitStream::Forward(uint32_t len) {
   }
 }
 
-uint32_t InputBitStream::ReadLong(uint32_t len) {
+serf_long_t InputBitStream::ReadLong(uint32_t len) {
+#if SERF_DOUBLE_WIDTH == 64
+  if (len > 32) {
+    serf_long_t low = ReadInt(32);
+    return low | ((serf_long_t)ReadInt(len - 32) << 32);
+  }
+#endif
   uint32_t ret = Peek(len);
   Forward(len);
   return ret;
@@ -103,6 +109,26 @@ bool InputBitStream::ReadBit() {
   return ret;
 }
 
+void InputBitStream::AlignToByte() {
+  if (bit_in_buffer_ > 0) {
+    Forward(8 - bit_in_buffer_);
+  }
+}
+
+const uint8_t *InputBitStream::AlignedBytes(uint32_t *available) const {
+  uint32_t length = (uint32_t)data_.length() * 4;
+  if (bit_in_buffer_ != 0 || data_.begin() == NULL || cursor_ > length) {
+    *available = 0;
+    return NULL;
+  }
+  *available = length - cursor_;
+  return (const uint8_t *)data_.begin() + cursor_;
+}
+
+void InputBitStream::Skip(uint32_t len) {
+  Forward(len);
+}
+
 bool InputBitStream::HasMoreData() const {
   // 如果设置了最大有效位数，检查是否已经达到
   if (max_valid_bits_ > 0 && total_bits_read_ >= max_valid_bits_) {
@@ -122,7 +148,7 @@ void InputBitStream::SetBuffer(const Array<uint8_t> &new_buffer) {
     max_valid_bits_ = 0;
     
     // 计算需要的uint32_t数量
-    uint16_t words_needed = (uint16_t)ceilf(new_buffer.length() / 4.0f);
+    serf_size_t words_needed = (serf_size_t)(((uint32_t)new_buffer.length() + 3) / 4);
     
     // 释放旧的data_
     if (data_.is_valid()) {
@@ -132,7 +158,7 @@ void InputBitStream::SetBuffer(const Array<uint8_t> &new_buffer) {
     // 分配新的data_ - 使用swap避免赋值操作符问题
     Array<uint32_t> temp_array(words_needed);
     if (!temp_array.is_valid()) {
-      printf("SetBuffer: ERROR - failed to create array of %u words\n", words_needed);
+      printf("SetBuffer: ERROR - failed to create array of %lu words\n", (unsigned long)words_needed);
       return;
     }
     data_.swap(temp_array);
@@ -9,6 +9,7 @@
 
 // IAR适配：移除STL依赖，使用C风格头文件
 #include "array.h"
+#include "double.h"
 
 class InputBitStream {
  public:
@@ -16,12 +17,21 @@ class InputBitStream {
 
   InputBitStream(uint8_t *raw_data, uint32_t size);
 
-  uint32_t ReadLong(uint32_t len);
+  // 宿主机上len可达64，先读低32位
+  serf_long_t ReadLong(uint32_t len);
 
   uint32_t ReadInt(uint32_t len);
 
   bool ReadBit();
 
+  // 跳到下一个字节边界
+  void AlignToByte();
+
+  // 字节对齐时返回当前字节的指针和其后可读的字节数，供整段解包；未对齐时返回NULL
+  const uint8_t *AlignedBytes(uint32_t *available) const;
+
+  void Skip(uint32_t len);
+
   void SetBuffer(const Array<uint8_t> &new_buffer);
   
   // 设置有效位数（用于限制读取，避免读取填充位）
@@ -0,0 +1,65 @@
+#include "net_frame_coalescer.h"
+
+NetFrameCoalescer::NetFrameCoalescer(const net_coalescing_config_t &config) : config_(config) {
+  if (config_.max_values == 0) {
+    config_.max_values = 1;
+  }
+  frame_size_in_bits_ = 0;
+  number_of_values_ = 0;
+  first_value_time_ms_ = 0;
+}
+
+bool NetFrameCoalescer::Fits(const net_coalescing_config_t &config, uint32_t max_value_bits) {
+  return (uint32_t)config.mtu_bytes * 8 >= kFrameHeaderBits + max_value_bits;
+}
+
+uint32_t NetFrameCoalescer::BeginValue(OutputBitStream *output_bit_stream, uint32_t now_ms) {
+  if (number_of_values_ > 0) {
+    return 0;
+  }
+  // 值个数在TakeFrame()时回填
+  first_value_time_ms_ = now_ms;
+  frame_size_in_bits_ = output_bit_stream->WriteInt(0, kFrameHeaderBits);
+  return frame_size_in_bits_;
+}
+
+bool NetFrameCoalescer::EndValue(uint32_t value_bits, uint32_t next_value_max_bits, uint32_t now_ms) {
+  frame_size_in_bits_ += value_bits;
+  ++number_of_values_;
+  return number_of_values_ >= config_.max_values ||
+      frame_size_in_bits_ + next_value_max_bits > (uint32_t)config_.mtu_bytes * 8 ||
+      Expired(now_ms);
+}
+
+bool NetFrameCoalescer::Expired(uint32_t now_ms) const {
+  // 无符号减法，时钟回绕后仍正确
+  return number_of_values_ > 0 && config_.max_latency_ms > 0 &&
+      now_ms - first_value_time_ms_ >= config_.max_latency_ms;
+}
+
+Array<uint8_t> NetFrameCoalescer::TakeFrame(OutputBitStream *output_bit_stream) {
+  if (number_of_values_ == 0) {
+    return Array<uint8_t>(0);
+  }
+  output_bit_stream->Flush();
+  // EndValue()按下一个值的最大位数提前结束帧，不应溢出；溢出时不发出被截断的帧
+  Array<uint8_t> frame = output_bit_stream->overflowed() ? Array<uint8_t>(0) :
+      output_bit_stream->GetBuffer((frame_size_in_bits_ + 7) / 8);
+  output_bit_stream->Refresh();
+  if (frame.is_valid()) {
+    // LSB-first：count占第0字节高4位和第1字节低4位
+    frame[0] = (uint8_t)((frame[0] & 0x0F) | ((number_of_values_ & 0x0F) << 4));
+    frame[1] = (uint8_t)((frame[1] & 0xF0) | (number_of_values_ >> 4));
+  }
+  frame_size_in_bits_ = 0;
+  number_of_values_ = 0;
+  return frame;
+}
+
+bool NetFrameCoalescer::empty() const {
+  return number_of_values_ == 0;
+}
+
+const net_coalescing_config_t &NetFrameCoalescer::config() const {
+  return config_;
+}
@@ -0,0 +1,64 @@
+#ifndef SERF_NET_FRAME_COALESCER_H
+#define SERF_NET_FRAME_COALESCER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "array.h"
+#include "output_bit_stream.h"
+
+/*
+ * Frame policy of the Net compressors in coalescing mode. Instead of one padded packet per value, values are
+ * written bit-contiguously after a single frame header, and the frame is handed out when the next value might
+ * not fit into mtu_bytes, when it holds max_values values, or when its first value is max_latency_ms old.
+ *
+ * +-----------------------------+--------------+-------+-------+-----+
+ * |4bits - transition header    |8bits - count |value 0|value 1| ... |
+ * +-----------------------------+--------------+-------+-------+-----+
+ *
+ * Values are encoded exactly as in the per-value packets minus their own 4-bit header. The compressor owns the
+ * bitstream; this class only writes the frame header, decides when to close and patches the count in.
+ */
+
+typedef struct {
+  // 帧最大字节数（含帧头），如802.15.4为127减去MAC开销
+  uint16_t mtu_bytes;
+  // 每帧最多值个数，1..255
+  uint8_t max_values;
+  // 帧内第一个值写入后最长等待时间，0表示不按时延关闭
+  uint32_t max_latency_ms;
+} net_coalescing_config_t;
+
+class NetFrameCoalescer {
+ public:
+  static const uint8_t kFrameHeaderBits = 4 + 8;
+
+  explicit NetFrameCoalescer(const net_coalescing_config_t &config);
+
+  // 帧的第一个值总会写入，mtu_bytes须至少容纳帧头和一个最长的值，否则该值会越过位流末尾
+  static bool Fits(const net_coalescing_config_t &config, uint32_t max_value_bits);
+
+  // 写入值之前调用，帧为空时写入帧头
+  uint32_t BeginValue(OutputBitStream *output_bit_stream, uint32_t now_ms);
+
+  // 写入值之后调用，next_value_max_bits为下一个值最多占用的位数；返回true表示帧应立即取出
+  bool EndValue(uint32_t value_bits, uint32_t next_value_max_bits, uint32_t now_ms);
+
+  // 帧非空且已超过时延预算
+  bool Expired(uint32_t now_ms) const;
+
+  // 从output_bit_stream取出当前帧并开始新帧，帧为空时返回空数组
+  Array<uint8_t> TakeFrame(OutputBitStream *output_bit_stream);
+
+  bool empty() const;
+
+  const net_coalescing_config_t &config() const;
+
+ private:
+  net_coalescing_config_t config_;
+  uint32_t frame_size_in_bits_;
+  uint8_t number_of_values_;
+  uint32_t first_value_time_ms_;
+};
+
+#endif  // SERF_NET_FRAME_COALESCER_H
@@ -0,0 +1,55 @@
+#include "net_resync.h"
+
+NetResyncEncoder::NetResyncEncoder(const net_resync_config_t &config) : config_(config) {
+  sequence_ = 0;
+  values_since_keyframe_ = 0;
+  last_keyframe_ms_ = 0;
+  // 第一个包总是keyframe，接收端可以从任意时刻开始收听
+  keyframe_pending_ = true;
+}
+
+uint32_t NetResyncEncoder::WriteHeader(OutputBitStream *output_bit_stream_ptr, uint32_t now_ms, bool *keyframe) {
+  // 无符号减法，时钟回绕后仍正确
+  *keyframe = keyframe_pending_ ||
+      (config_.keyframe_interval_values > 0 && values_since_keyframe_ >= config_.keyframe_interval_values) ||
+      (config_.keyframe_interval_ms > 0 && now_ms - last_keyframe_ms_ >= config_.keyframe_interval_ms);
+  if (*keyframe) {
+    keyframe_pending_ = false;
+    values_since_keyframe_ = 0;
+    last_keyframe_ms_ = now_ms;
+  }
+  ++values_since_keyframe_;
+  uint32_t this_size = output_bit_stream_ptr->WriteInt(*keyframe ? 1 : 0, 1);
+  this_size += output_bit_stream_ptr->WriteInt(sequence_, kSequenceBits);
+  sequence_ = (uint8_t)((sequence_ + 1) & ((1 << kSequenceBits) - 1));
+  return this_size;
+}
+
+void NetResyncEncoder::ForceKeyframe() {
+  keyframe_pending_ = true;
+}
+
+NetResyncDecoder::NetResyncDecoder() {
+  expected_sequence_ = 0;
+  synchronized_ = true;
+}
+
+NetResyncStatus NetResyncDecoder::ReadHeader(InputBitStream *input_bit_stream_ptr, bool *keyframe) {
+  *keyframe = input_bit_stream_ptr->ReadBit();
+  uint8_t sequence = (uint8_t)input_bit_stream_ptr->ReadInt(NetResyncEncoder::kSequenceBits);
+  bool gap = sequence != expected_sequence_;
+  expected_sequence_ = (uint8_t)((sequence + 1) & ((1 << NetResyncEncoder::kSequenceBits) - 1));
+  if (*keyframe) {
+    NetResyncStatus status = (gap || !synchronized_) ? kNetResyncRecovered : kNetResyncOk;
+    synchronized_ = true;
+    return status;
+  }
+  if (gap) {
+    synchronized_ = false;
+  }
+  return synchronized_ ? kNetResyncOk : kNetResyncLost;
+}
+
+bool NetResyncDecoder::synchronized() const {
+  return synchronized_;
+}
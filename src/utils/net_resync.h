@@ -0,0 +1,78 @@
+#ifndef SERF_NET_RESYNC_H
+#define SERF_NET_RESYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "output_bit_stream.h"
+#include "input_bit_stream.h"
+
+/*
+ * Loss tolerance of the Net per-value packets. The 4-bit transition header already carries the series ID (see
+ * NetSeriesId), so in resync mode a keyframe flag and a 4-bit sequence number follow it. A keyframe resets the
+ * predictor and the post-office representation on both sides before its value is encoded, so it decodes without
+ * any earlier packet. The decoder detects gaps from the sequence number and drops values until the next keyframe.
+ *
+ * +-----------------------+------------------+-------------------+-----------+
+ * |4bits - id (+ varint)  |1bit - keyframe   |4bits - sequence   |value      |
+ * +-----------------------+------------------+-------------------+-----------+
+ *
+ * The sequence wraps at 16, so a burst of exactly 16k lost packets is not detected; the keyframe interval bounds
+ * the damage in that case.
+ *
+ * Only per-value packets carry this header. Coalesced frames (NetFrameCoalescer) and the multiplexers have none, so
+ * the Net compressors refuse EnableResync and EnableCoalescing together, and the multiplexers offer no resync mode.
+ */
+
+typedef struct {
+  // 每隔多少个值发送一次keyframe，0表示不按个数
+  uint16_t keyframe_interval_values;
+  // 距上一个keyframe超过多少毫秒后发送keyframe，0表示不按时间
+  uint32_t keyframe_interval_ms;
+} net_resync_config_t;
+
+typedef enum {
+  // 值已正确解出
+  kNetResyncOk = 0,
+  // 检测到丢包，本包为keyframe，值已正确解出
+  kNetResyncRecovered = 1,
+  // 检测到丢包或仍在等待keyframe，本包的值无法解出
+  kNetResyncLost = 2
+} NetResyncStatus;
+
+class NetResyncEncoder {
+ public:
+  static const uint8_t kSequenceBits = 4;
+  static const uint8_t kHeaderBits = 1 + kSequenceBits;
+
+  explicit NetResyncEncoder(const net_resync_config_t &config);
+
+  // 写入keyframe标志和序号；*keyframe为true时调用方须在编码值之前重置预测器
+  uint32_t WriteHeader(OutputBitStream *output_bit_stream_ptr, uint32_t now_ms, bool *keyframe);
+
+  // 下一个包强制为keyframe，如接收端请求重同步时
+  void ForceKeyframe();
+
+ private:
+  net_resync_config_t config_;
+  uint8_t sequence_;
+  uint16_t values_since_keyframe_;
+  uint32_t last_keyframe_ms_;
+  bool keyframe_pending_;
+};
+
+class NetResyncDecoder {
+ public:
+  NetResyncDecoder();
+
+  // 读取keyframe标志和序号；*keyframe为true时调用方须在解码值之前重置预测器
+  NetResyncStatus ReadHeader(InputBitStream *input_bit_stream_ptr, bool *keyframe);
+
+  bool synchronized() const;
+
+ private:
+  uint8_t expected_sequence_;
+  bool synchronized_;
+};
+
+#endif  // SERF_NET_RESYNC_H
@@ -0,0 +1,54 @@
+#include "net_series_id.h"
+
+uint32_t NetSeriesId::Write(uint32_t series_id, OutputBitStream *output_bit_stream_ptr) {
+  if (series_id < kExtendedHeader) {
+    return output_bit_stream_ptr->WriteInt(series_id, 4);
+  }
+  uint32_t this_size = output_bit_stream_ptr->WriteInt(kExtendedHeader, 4);
+  uint32_t rest = series_id - kExtendedHeader;
+  do {
+    uint8_t group = rest & 0x7F;
+    rest >>= 7;
+    if (rest != 0) {
+      group |= 0x80;
+    }
+    this_size += output_bit_stream_ptr->WriteInt(group, 8);
+  } while (rest != 0);
+  return this_size;
+}
+
+uint32_t NetSeriesId::Read(InputBitStream *input_bit_stream_ptr) {
+  uint32_t header = input_bit_stream_ptr->ReadInt(4);
+  if (header < kExtendedHeader) {
+    return header;
+  }
+  uint32_t rest = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    uint32_t group = input_bit_stream_ptr->ReadInt(8);
+    rest |= (group & 0x7F) << shift;
+    if ((group & 0x80) == 0) {
+      break;
+    }
+  }
+  return rest + kExtendedHeader;
+}
+
+uint32_t NetSeriesId::Peek(const Array<uint8_t> &packet) {
+  if (!packet.is_valid()) {
+    return 0;
+  }
+  uint8_t header = packet[0] & 0x0F;
+  if (header < kExtendedHeader) {
+    return header;
+  }
+  // LSB-first：第i个varint字节由第i字节高4位和第i+1字节低4位组成，越界时operator[]返回0
+  uint32_t rest = 0;
+  for (uint16_t i = 0; i < 5; i++) {
+    uint8_t group = (uint8_t)((packet[i] >> 4) | (packet[i + 1] << 4));
+    rest |= (uint32_t)(group & 0x7F) << (7 * i);
+    if ((group & 0x80) == 0) {
+      break;
+    }
+  }
+  return rest + kExtendedHeader;
+}
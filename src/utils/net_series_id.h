@@ -0,0 +1,34 @@
+#ifndef SERF_NET_SERIES_ID_H
+#define SERF_NET_SERIES_ID_H
+
+#include <stdint.h>
+
+#include "array.h"
+#include "output_bit_stream.h"
+#include "input_bit_stream.h"
+
+/*
+ * Series ID in the 4-bit transition header of Net packets. IDs below kExtendedHeader are the header itself, so
+ * a single-series stream (ID 0) keeps the all-zero header. Larger IDs set the header to kExtendedHeader and
+ * append ID - kExtendedHeader as a varint, 7 data bits plus a continuation bit per byte, lowest group first.
+ *
+ * +----------------------+--------------------------------------+-----------+
+ * |4bits - id or 15      |8bits * n - varint (only if header=15)|value      |
+ * +----------------------+--------------------------------------+-----------+
+ */
+
+class NetSeriesId {
+ public:
+  static const uint8_t kExtendedHeader = 15;
+  // 32位ID最多5个varint字节
+  static const uint8_t kMaxBits = 4 + 5 * 8;
+
+  static uint32_t Write(uint32_t series_id, OutputBitStream *output_bit_stream_ptr);
+
+  static uint32_t Read(InputBitStream *input_bit_stream_ptr);
+
+  // 不经位流直接从包头解析，供解复用器在解压前查找序列状态
+  static uint32_t Peek(const Array<uint8_t> &packet);
+};
+
+#endif  // SERF_NET_SERIES_ID_H
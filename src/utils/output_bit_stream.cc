@@ -7,8 +7,11 @@
 // 使用简单的字节buffer，每个字节内LSB优先
 
 OutputBitStream::OutputBitStream(uint32_t buffer_size) {
+  if (buffer_size > SERF_BIT_STREAM_MAX_BYTES) {
+    buffer_size = SERF_BIT_STREAM_MAX_BYTES;
+  }
   // data_存储字节数据，但使用uint32_t数组来利用ArrayBufferPool
-  uint16_t array_size = buffer_size / 4 + 1;
+  serf_size_t array_size = buffer_size / 4 + 1;
   Array<uint32_t> temp_array(array_size);
   data_.swap(temp_array);
   
@@ -27,14 +30,27 @@ OutputBitStream::OutputBitStream(uint32_t buffer_size) {
   buffer_ = 0;  // 当前正在构建的字节
   cursor_ = 0;  // 字节索引
   bit_in_buffer_ = 0;  // 当前字节内的位索引（0-7）
+  overflow_ = false;
+}
+
+// 写出当前字节；缓冲区已满时丢弃该字节并记录溢出
+void OutputBitStream::StoreByte() {
+  if (cursor_ < (uint32_t)data_.length() * 4) {
+    ((uint8_t*)data_.begin())[cursor_] = (uint8_t)buffer_;
+    cursor_++;
+  } else {
+    overflow_ = true;
+  }
+  bit_in_buffer_ = 0;
+  buffer_ = 0;
 }
 
 // LSB-first写入：从最低位开始写入
 uint32_t OutputBitStream::Write(uint32_t content, uint32_t len) {
+  SERF_PERF_SCOPE(kPerfRegionBitStreamWrite);
   if (len == 0 || len > 32) return 0;
   
-  uint8_t* byte_buffer = (uint8_t*)data_.begin();
-  if (byte_buffer == NULL) return 0;
+  if (!data_.is_valid()) return 0;
   
   // 逐位写入（从LSB开始）
   for (uint32_t i = 0; i < len; i++) {
@@ -48,18 +64,20 @@ uint32_t OutputBitStream::Write(uint32_t content, uint32_t len) {
     
     // 如果当前字节满了，存储并移到下一个字节
     if (bit_in_buffer_ >= 8) {
-      byte_buffer[cursor_] = (uint8_t)buffer_;
-      cursor_++;
-      bit_in_buffer_ = 0;
-      buffer_ = 0;
+      StoreByte();
     }
   }
   
   return len;
 }
 
-uint32_t OutputBitStream::WriteLong(uint32_t content, uint32_t len) {
-  return Write(content, len);
+uint32_t OutputBitStream::WriteLong(serf_long_t content, uint32_t len) {
+#if SERF_DOUBLE_WIDTH == 64
+  if (len > 32) {
+    return Write((uint32_t)content, 32) + Write((uint32_t)(content >> 32), len - 32);
+  }
+#endif
+  return Write((uint32_t)content, len);
 }
 
 uint32_t OutputBitStream::WriteInt(uint32_t content, uint32_t len) {
@@ -70,22 +88,23 @@ uint32_t OutputBitStream::WriteBit(bool bit) {
   return Write(bit ? 1 : 0, 1);
 }
 
+uint32_t OutputBitStream::AlignToByte() {
+  return bit_in_buffer_ > 0 ? Write(0, 8 - bit_in_buffer_) : 0;
+}
+
 void OutputBitStream::Flush() {
-  if (bit_in_buffer_ > 0) {
-    uint8_t* byte_buffer = (uint8_t*)data_.begin();
-    if (byte_buffer) {
-      byte_buffer[cursor_] = (uint8_t)buffer_;
-      cursor_++;
-      bit_in_buffer_ = 0;
-      buffer_ = 0;
-    }
+  if (bit_in_buffer_ > 0 && data_.is_valid()) {
+    StoreByte();
   }
 }
 
 Array<uint8_t> OutputBitStream::GetBuffer(uint32_t len) {
   Flush();
+  if (len > (uint32_t)data_.length() * 4) {
+    len = (uint32_t)data_.length() * 4;
+  }
   
-  Array<uint8_t> ret(len);
+  Array<uint8_t> ret((serf_size_t)len);
   if (!ret.is_valid()) {
     return ret;
   }
@@ -112,6 +131,9 @@ bool OutputBitStream::CopyBufferTo(uint8_t* dest, uint32_t len) {
   if (data_ptr == NULL) {
     return false;
   }
+  if (len > (uint32_t)data_.length() * 4) {
+    len = (uint32_t)data_.length() * 4;
+  }
   
   // 直接复制字节
   memcpy(dest, data_ptr, len);
@@ -123,6 +145,7 @@ void OutputBitStream::Refresh() {
   cursor_ = 0;
   bit_in_buffer_ = 0;
   buffer_ = 0;
+  overflow_ = false;
   
   // 清零data_数组
   if (data_.is_valid()) {
@@ -132,3 +155,52 @@ void OutputBitStream::Refresh() {
     }
   }
 }
+
+bool OutputBitStream::overflowed() const {
+  return overflow_;
+}
+
+const uint16_t OutputBitStream::kMaxBlockValues;
+
+uint32_t OutputBitStream::WriteBlockCountPlaceholder() {
+  return WriteInt(0, 16);
+}
+
+void OutputBitStream::PatchBlockCount(Array<uint8_t> &block, uint16_t count) {
+  block[0] = (uint8_t)(count & 0xFF);
+  block[1] = (uint8_t)(count >> 8);
+}
+
+uint32_t OutputBitStream::capacity() const {
+  return ((uint32_t)data_.length() - 1) * 4;
+}
+
+void OutputBitStream::SaveState(StateWriter *writer) const {
+  writer->PutVarint(cursor_);
+  writer->PutVarint(bit_in_buffer_);
+  writer->PutVarint(buffer_);
+  writer->PutVarint(overflow_ ? 1 : 0);
+  writer->PutBytes(data_.begin(), (serf_size_t)cursor_);
+}
+
+bool OutputBitStream::LoadState(StateReader *reader) {
+  Refresh();
+  uint32_t cursor = reader->GetVarint();
+  uint32_t bit_in_buffer = reader->GetVarint();
+  uint32_t buffer = reader->GetVarint();
+  uint32_t overflow = reader->GetVarint();
+  // 写满时cursor_恰好等于容量，这种状态同样可以恢复
+  if (!reader->ok() || cursor > (uint32_t)data_.length() * 4 || bit_in_buffer >= 8 || overflow > 1) {
+    return false;
+  }
+  reader->GetBytes(data_.begin(), (serf_size_t)cursor);
+  if (!reader->ok()) {
+    Refresh();
+    return false;
+  }
+  cursor_ = cursor;
+  bit_in_buffer_ = bit_in_buffer;
+  buffer_ = buffer;
+  overflow_ = overflow != 0;
+  return true;
+}
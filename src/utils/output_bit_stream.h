@@ -7,15 +7,15 @@
 // IAR适配：移除endian.h依赖，使用自定义字节序转换
 // 由于CC2530是小端序，我们实现简单的字节序转换函数
 
-// 字节序转换函数（小端序到网络字节序）
-static inline uint32_t htobe32(uint32_t host_32bits) {
+// 字节序转换函数（小端序到网络字节序）；加serf_前缀，避免与glibc <endian.h>中的同名宏冲突
+static inline uint32_t serf_htobe32(uint32_t host_32bits) {
     return ((host_32bits & 0xFF000000) >> 24) |
            ((host_32bits & 0x00FF0000) >> 8)  |
            ((host_32bits & 0x0000FF00) << 8)  |
            ((host_32bits & 0x000000FF) << 24);
 }
 
-static inline uint32_t be32toh(uint32_t big_endian_32bits) {
+static inline uint32_t serf_be32toh(uint32_t big_endian_32bits) {
     return ((big_endian_32bits & 0xFF000000) >> 24) |
            ((big_endian_32bits & 0x00FF0000) >> 8)  |
            ((big_endian_32bits & 0x0000FF00) << 8)  |
@@ -23,33 +23,67 @@ static inline uint32_t be32toh(uint32_t big_endian_32bits) {
 }
 
 #include "array.h"
+#include "double.h"
+#include "perf_counters.h"
+#include "state_snapshot.h"
 
 class OutputBitStream {
  public:
   explicit OutputBitStream(uint32_t buffer_size);
 
+  // LSB优先：content的第0位最先写入。解码端逐字段按位读取，因此多个标志位（如SERF-XOR的case 01）
+  // 须按解码顺序分别写入，不能拼成一个整数一次写入
   uint32_t Write(uint32_t content, uint32_t len);
 
-  uint32_t WriteLong(uint32_t content, uint32_t len);
+  // 宿主机上len可达64，先写低32位
+  uint32_t WriteLong(serf_long_t content, uint32_t len);
 
   uint32_t WriteInt(uint32_t content, uint32_t len);
 
   uint32_t WriteBit(bool bit);
 
+  // 用0填充到字节边界，返回填充的位数
+  uint32_t AlignToByte();
+
   void Flush();
 
+  // len超过位流容量时截断到容量
   Array<uint8_t> GetBuffer(uint32_t len);
   
-  // 新增：直接复制数据到目标缓冲区，避免临时对象
+  // 新增：直接复制数据到目标缓冲区，避免临时对象；len为dest的长度，超过位流容量的部分不复制
   bool CopyBufferTo(uint8_t* dest, uint32_t len);
 
   void Refresh();
 
+  // 自上次Refresh()以来是否写满过缓冲区；写满后多余的位被丢弃，已写入的内容不完整
+  bool overflowed() const;
+
+  // SERF-XOR块头的16位值个数：块开始时写入占位，块取出后由PatchBlockCount回填；返回写入的位数
+  uint32_t WriteBlockCountPlaceholder();
+
+  // 回填GetBuffer()取出的块的值个数；位流LSB优先，低字节在前
+  static void PatchBlockCount(Array<uint8_t> &block, uint16_t count);
+
+  // 一个块最多的值个数，超出时压缩器拒绝新值
+  static const uint16_t kMaxBlockValues = 0xFFFF;
+
+  // 可写入的字节数，按此值构造的位流与本位流容量相同
+  uint32_t capacity() const;
+
+  // 快照只包含已写入的字节、未写满的当前字节和溢出标记，不含空闲容量
+  void SaveState(StateWriter *writer) const;
+
+  // 快照超出本位流容量时返回false，位流保持Refresh()后的状态
+  bool LoadState(StateReader *reader);
+
  private:
   Array<uint32_t> data_;
   uint32_t cursor_;
   uint32_t bit_in_buffer_;
   uint32_t buffer_; // 使用32位替代64位
+  bool overflow_;
+
+  void StoreByte();
 };
 
 #endif  // SERF_OUTPUT_BIT_STREAM_H
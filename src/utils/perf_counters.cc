@@ -0,0 +1,134 @@
+#include "perf_counters.h"
+
+#ifdef SERF_ENABLE_PERF_COUNTERS
+
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+int PerfCounters::fds_[kPerfEventCount] = {-1, -1, -1, -1};
+perf_region_stats_t PerfCounters::stats_[kPerfRegionCount];
+
+static const char *const kRegionNames[kPerfRegionCount] = {
+    "AddValue",
+    "FindAppLong",
+    "CompressValue",
+    "UpdatePositionsIfNeeded",
+    "EliasGammaCodec::Encode",
+    "BitStreamWrite",
+    "Decompress"
+};
+
+#ifdef __linux__
+static int OpenEvent(uint32_t type, uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+bool PerfCounters::Open() {
+#ifdef __linux__
+  if (fds_[0] != -1) return true;
+  const uint32_t types[kPerfEventCount] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+  };
+  const uint64_t configs[kPerfEventCount] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+  };
+  for (int i = 0; i < kPerfEventCount; ++i) {
+    fds_[i] = OpenEvent(types[i], configs[i], i == 0 ? -1 : fds_[0]);
+    if (fds_[i] == -1) {
+      Close();
+      return false;
+    }
+  }
+  Reset();
+  ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void PerfCounters::Close() {
+#ifdef __linux__
+  for (int i = kPerfEventCount - 1; i >= 0; --i) {
+    if (fds_[i] != -1) {
+      close(fds_[i]);
+      fds_[i] = -1;
+    }
+  }
+#endif
+}
+
+void PerfCounters::Reset() {
+  memset(stats_, 0, sizeof(stats_));
+}
+
+bool PerfCounters::Read(uint64_t *out_counts) {
+#ifdef __linux__
+  if (fds_[0] == -1) return false;
+  // PERF_FORMAT_GROUP layout: nr, then one value per event in opening order
+  uint64_t buffer[1 + kPerfEventCount];
+  if (read(fds_[0], buffer, sizeof(buffer)) != (ssize_t) sizeof(buffer)) return false;
+  memcpy(out_counts, buffer + 1, kPerfEventCount * sizeof(uint64_t));
+  return true;
+#else
+  (void) out_counts;
+  return false;
+#endif
+}
+
+void PerfCounters::Accumulate(PerfRegion region, const uint64_t *begin_counts, const uint64_t *end_counts) {
+  perf_region_stats_t &stats = stats_[region];
+  ++stats.calls;
+  for (int i = 0; i < kPerfEventCount; ++i) {
+    stats.counts[i] += end_counts[i] - begin_counts[i];
+  }
+}
+
+const perf_region_stats_t &PerfCounters::stats(PerfRegion region) {
+  return stats_[region];
+}
+
+const char *PerfCounters::RegionName(PerfRegion region) {
+  return kRegionNames[region];
+}
+
+void PerfCounters::Report(FILE *out, uint64_t values) {
+  if (values == 0) values = stats_[kPerfRegionAddValue].calls;
+  fprintf(out, "%-26s %12s %14s %14s %14s %14s %14s\n", "region", "calls", "cycles/call", "instr/call",
+          "br-miss/call", "l1d-miss/call", "cycles/value");
+  for (int r = 0; r < kPerfRegionCount; ++r) {
+    const perf_region_stats_t &stats = stats_[r];
+    if (stats.calls == 0) continue;
+    double calls = (double) stats.calls;
+    fprintf(out, "%-26s %12llu %14.2f %14.2f %14.4f %14.4f", kRegionNames[r], (unsigned long long) stats.calls,
+            stats.counts[kPerfEventCycles] / calls, stats.counts[kPerfEventInstructions] / calls,
+            stats.counts[kPerfEventBranchMisses] / calls, stats.counts[kPerfEventL1dMisses] / calls);
+    if (r != kPerfRegionDecompress && values > 0) {
+      fprintf(out, " %14.2f\n", stats.counts[kPerfEventCycles] / (double) values);
+    } else {
+      fprintf(out, " %14s\n", "-");
+    }
+  }
+}
+
+#endif  // SERF_ENABLE_PERF_COUNTERS
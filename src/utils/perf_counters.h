@@ -0,0 +1,101 @@
+#ifndef SERF_PERF_COUNTERS_H
+#define SERF_PERF_COUNTERS_H
+
+#include <stdint.h>
+
+/*
+ * Optional hardware performance-counter instrumentation (Linux perf_event_open).
+ *
+ * Build with -DSERF_ENABLE_PERF_COUNTERS to turn every SERF_PERF_SCOPE(region) into a scope that reads
+ * cycles, instructions, branch misses and L1D read misses on entry and exit and adds the difference to the
+ * statistics of that region. Without the flag SERF_PERF_SCOPE expands to nothing, so the 8051 build and the
+ * default host build are unaffected.
+ *
+ * Regions nest (e.g. BitStreamWrite inside CompressValue), so every region reports inclusive counts. Each
+ * scope costs two read() syscalls, so absolute cycle numbers of the small regions are inflated; compare
+ * branch misses and instruction counts between builds rather than the raw cycles.
+ */
+
+enum PerfRegion {
+  kPerfRegionAddValue = 0,
+  kPerfRegionFindAppLong,
+  kPerfRegionCompressValue,
+  kPerfRegionUpdatePositionsIfNeeded,
+  kPerfRegionEliasGammaEncode,
+  kPerfRegionBitStreamWrite,
+  kPerfRegionDecompress,
+  kPerfRegionCount
+};
+
+enum PerfEvent {
+  kPerfEventCycles = 0,
+  kPerfEventInstructions,
+  kPerfEventBranchMisses,
+  kPerfEventL1dMisses,
+  kPerfEventCount
+};
+
+#ifdef SERF_ENABLE_PERF_COUNTERS
+
+#include <stdio.h>
+
+typedef struct {
+  uint64_t calls;
+  uint64_t counts[kPerfEventCount];
+} perf_region_stats_t;
+
+class PerfCounters {
+ public:
+  // Open the counter group for the calling thread; returns false if the kernel refuses (e.g. perf_event_paranoid)
+  static bool Open();
+
+  static void Close();
+
+  static void Reset();
+
+  static bool Read(uint64_t *out_counts);
+
+  static void Accumulate(PerfRegion region, const uint64_t *begin_counts, const uint64_t *end_counts);
+
+  static const perf_region_stats_t &stats(PerfRegion region);
+
+  static const char *RegionName(PerfRegion region);
+
+  // Print per-call averages of every region, and cycles per compressed value for the compression regions;
+  // values are the calls of the AddValue region unless given. Decompress runs once per block, so it has no
+  // per-value column.
+  static void Report(FILE *out, uint64_t values = 0);
+
+ private:
+  static int fds_[kPerfEventCount];
+  static perf_region_stats_t stats_[kPerfRegionCount];
+};
+
+class PerfScope {
+ public:
+  explicit PerfScope(PerfRegion region) : region_(region) {
+    active_ = PerfCounters::Read(begin_counts_);
+  }
+
+  ~PerfScope() {
+    uint64_t end_counts[kPerfEventCount];
+    if (active_ && PerfCounters::Read(end_counts)) {
+      PerfCounters::Accumulate(region_, begin_counts_, end_counts);
+    }
+  }
+
+ private:
+  PerfRegion region_;
+  bool active_;
+  uint64_t begin_counts_[kPerfEventCount];
+};
+
+#define SERF_PERF_SCOPE(region) PerfScope serf_perf_scope_(region)
+
+#else
+
+#define SERF_PERF_SCOPE(region) ((void) 0)
+
+#endif  // SERF_ENABLE_PERF_COUNTERS
+
+#endif  // SERF_PERF_COUNTERS_H
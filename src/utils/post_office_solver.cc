@@ -1,9 +1,35 @@
 #include <algorithm>
+#include <cmath>
 
 #include "utils/post_office_solver.h"
 
 Array<int>
 PostOfficeSolver::InitRoundAndRepresentation(Array<int> &distribution, Array<int> &representation, Array<int> &round) {
+  Array<int> positions = SolvePositions(distribution);
+
+  representation[0] = 0;
+  round[0] = 0;
+  int i = 1;
+  for (int j = 1; j < (int)distribution.length(); ++j) {
+    // Bad but useful code
+    int magic_code = (i < (int)positions.length() && j == positions[i]);
+    representation[j] = representation[j - 1] + magic_code;
+    round[j] = magic_code ? j : round[j - 1];
+    i += magic_code;
+//    if (i < positions.length() && j == positions[i]) {
+//      representation[j] = representation[j - 1] + 1;
+//      round[j] = j;
+//      ++i;
+//    } else {
+//      representation[j] = representation[j - 1];
+//      round[j] = round[j - 1];
+//    }
+  }
+
+  return positions;
+}
+
+Array<int> PostOfficeSolver::SolvePositions(Array<int> &distribution) {
   // 当前及前面的非零个数（包括当前）
   Array<int> pre_non_zeros_count(distribution.length());
   // 当前后面的非零个数（不包括当前）
@@ -28,26 +54,6 @@ PostOfficeSolver::InitRoundAndRepresentation(Array<int> &distribution, Array<int
       positions = por.office_positions();
     }
   }
-
-  representation[0] = 0;
-  round[0] = 0;
-  int i = 1;
-  for (int j = 1; j < distribution.length(); ++j) {
-    // Bad but useful code
-    int magic_code = (i < positions.length() && j == positions[i]);
-    representation[j] = representation[j - 1] + magic_code;
-    round[j] = magic_code ? j : round[j - 1];
-    i += magic_code;
-//    if (i < positions.length() && j == positions[i]) {
-//      representation[j] = representation[j - 1] + 1;
-//      round[j] = j;
-//      ++i;
-//    } else {
-//      representation[j] = representation[j - 1];
-//      round[j] = round[j - 1];
-//    }
-  }
-
   return positions;
 }
 
@@ -57,7 +63,7 @@ PostOfficeSolver::CalTotalCountAndNonZerosCounts(Array<int> &arr, Array<int> &ou
   int non_zeros_count = arr.length();
   int total_count = arr[0];
   out_pre_non_zeros_count[0] = 1;            // 第一个视为非零
-  for (int i = 1; i < arr.length(); ++i) {
+  for (int i = 1; i < (int)arr.length(); ++i) {
     total_count += arr[i];
     // Bad but useful code
     int magic_code = (arr[i] == 0);
@@ -71,7 +77,7 @@ PostOfficeSolver::CalTotalCountAndNonZerosCounts(Array<int> &arr, Array<int> &ou
     //  out_pre_non_zeros_count[i] = out_pre_non_zeros_count[i - 1] + 1;
     //}
   }
-  for (int i = 0; i < arr.length(); ++i) {
+  for (int i = 0; i < (int)arr.length(); ++i) {
     out_post_non_zeros_count[i] = non_zeros_count - out_pre_non_zeros_count[i];
   }
   return Array<int>{total_count, non_zeros_count};
@@ -95,11 +101,11 @@ PostOfficeResult PostOfficeSolver::BuildPostOffice(Array<int> &arr, int num, int
   // 让dp[0][0]最小时，第-1个邮局所在的位置信息为-1
   pre[0][0] = -1;
 
-  for (int i = 1; i < arr.length(); ++i) {
+  for (int i = 1; i < (int)arr.length(); ++i) {
     if (arr[i] == 0) {
       continue;
     }
-    for (int j = std::max(1, num + i - arr.length()); j <= i && j < num; ++j) {
+    for (int j = std::max(1, num + i - (int)arr.length()); j <= i && j < num; ++j) {
       // arr.length - i < num - j，
       // 表示i后面的居民数（arr.length - i）不足以构建剩下的num - j个邮局
       if (i > 1 && j == 1) {
@@ -140,7 +146,7 @@ PostOfficeResult PostOfficeSolver::BuildPostOffice(Array<int> &arr, int num, int
   }
   int temp_total_app_cost = std::numeric_limits<int>::max();
   int temp_best_last = std::numeric_limits<int>::max();
-  for (int i = num - 1; i < arr.length(); ++i) {
+  for (int i = num - 1; i < (int)arr.length(); ++i) {
     if (num - 1 == 0 && i > 0) {
       break;
     }
@@ -148,7 +154,7 @@ PostOfficeResult PostOfficeSolver::BuildPostOffice(Array<int> &arr, int num, int
       continue;
     }
     int sum = dp[i][num - 1];
-    for (int j = i + 1; j < arr.length(); ++j) {
+    for (int j = i + 1; j < (int)arr.length(); ++j) {
       sum += arr[j] * (j - i);
     }
     if (temp_total_app_cost > sum) {
@@ -191,3 +197,23 @@ int PostOfficeSolver::WritePositions(Array<int> &positions, OutputBitStream *out
     this_size += out->WriteInt(position, 6);
   return this_size;
 }
+
+double PostOfficeSolver::Divergence(const Array<int> &distribution, const Array<int> &reference) {
+  long distribution_total = 0;
+  long reference_total = 0;
+  for (int i = 0; i < (int)distribution.length(); ++i) {
+    distribution_total += distribution[i];
+    reference_total += reference[i];
+  }
+  if (distribution_total == 0) {
+    return 0;
+  }
+  if (reference_total == 0) {
+    return 1;
+  }
+  double distance = 0;
+  for (int i = 0; i < (int)distribution.length(); ++i) {
+    distance += std::abs((double) distribution[i] / distribution_total - (double) reference[i] / reference_total);
+  }
+  return distance / 2;
+}
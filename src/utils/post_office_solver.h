@@ -22,8 +22,15 @@ class PostOfficeSolver {
 
   static Array<int> InitRoundAndRepresentation(Array<int> &distribution, Array<int> &representation, Array<int> &round);
 
+  // Positions only, for callers that keep their tables in another form (see serf_xor_tables.h)
+  static Array<int> SolvePositions(Array<int> &distribution);
+
   static int WritePositions(Array<int> &positions, OutputBitStream *out);
 
+  // Total variation distance in [0, 1] between two histograms of equal length; 0 if distribution is empty, 1 if
+  // only reference is
+  static double Divergence(const Array<int> &distribution, const Array<int> &reference);
+
  private:
   constexpr static int kPow2z[] = {1, 2, 4, 8, 16, 32};
   static Array<int> CalTotalCountAndNonZerosCounts(Array<int> &arr, Array<int> &out_pre_non_zeros_count,
@@ -5,6 +5,26 @@
 Array<int>
 PostOfficeSolver32::InitRoundAndRepresentation(Array<int> &distribution, Array<int> &representation,
                                                Array<int> &round) {
+  Array<int> positions = SolvePositions(distribution);
+
+  representation[0] = 0;
+  round[0] = 0;
+  int i = 1;
+  for (int j = 1; j < (int)distribution.length(); j++) {
+    if (i < (int)positions.length() && j == positions[i]) {
+      representation[j] = representation[j - 1] + 1;
+      round[j] = j;
+      i++;
+    } else {
+      representation[j] = representation[j - 1];
+      round[j] = round[j - 1];
+    }
+  }
+
+  return positions;
+}
+
+Array<int> PostOfficeSolver32::SolvePositions(Array<int> &distribution) {
   // 当前及前面的非零个数（包括当前）
   Array<int> pre_non_zeros_count(distribution.length());
   // 当前后面的非零个数（不包括当前）
@@ -34,21 +54,6 @@ PostOfficeSolver32::InitRoundAndRepresentation(Array<int> &distribution, Array<i
       positions = por.office_positions();
     }
   }
-
-  representation[0] = 0;
-  round[0] = 0;
-  int i = 1;
-  for (int j = 1; j < distribution.length(); j++) {
-    if (i < positions.length() && j == positions[i]) {
-      representation[j] = representation[j - 1] + 1;
-      round[j] = j;
-      i++;
-    } else {
-      representation[j] = representation[j - 1];
-      round[j] = round[j - 1];
-    }
-  }
-
   return positions;
 }
 
@@ -65,7 +70,7 @@ PostOfficeSolver32::CalTotalCountAndNonZerosCounts(Array<int> &arr, Array<int> &
   int non_zeros_count = arr.length();
   int total_count = arr[0];
   out_pre_non_zeros_count[0] = 1;            // 第一个视为非零
-  for (int i = 1; i < arr.length(); i++) {
+  for (int i = 1; i < (int)arr.length(); i++) {
     total_count += arr[i];
     if (arr[i] == 0) {
       non_zeros_count--;
@@ -74,7 +79,7 @@ PostOfficeSolver32::CalTotalCountAndNonZerosCounts(Array<int> &arr, Array<int> &
       out_pre_non_zeros_count[i] = out_pre_non_zeros_count[i - 1] + 1;
     }
   }
-  for (int i = 0; i < arr.length(); i++) {
+  for (int i = 0; i < (int)arr.length(); i++) {
     out_post_non_zeros_count[i] =
         non_zeros_count - out_pre_non_zeros_count[i];
   }
@@ -100,11 +105,11 @@ PostOfficeSolver32::BuildPostOffice(Array<int> &arr, int num, int non_zeros_coun
   // 让dp[0][0]最小时，第-1个邮局所在的位置信息为-1
   pre[0][0] = -1;
 
-  for (int i = 1; i < arr.length(); i++) {
+  for (int i = 1; i < (int)arr.length(); i++) {
     if (arr[i] == 0) {
       continue;
     }
-    for (int j = std::max(1, num + i - arr.length());
+    for (int j = std::max(1, num + i - (int)arr.length());
          j <= i && j < num; j++) {
       // arr.length - i < num - j，
       // 表示i后面的居民数（arr.length - i）不足以构建剩下的num - j个邮局
@@ -149,7 +154,7 @@ PostOfficeSolver32::BuildPostOffice(Array<int> &arr, int num, int non_zeros_coun
   }
   int temp_total_app_cost = std::numeric_limits<int>::max();
   int temp_best_last = std::numeric_limits<int>::max();
-  for (int i = num - 1; i < arr.length(); i++) {
+  for (int i = num - 1; i < (int)arr.length(); i++) {
     if (num - 1 == 0 && i > 0) {
       break;
     }
@@ -160,7 +165,7 @@ PostOfficeSolver32::BuildPostOffice(Array<int> &arr, int num, int non_zeros_coun
       continue;
     }
     int sum = dp[i][num - 1];
-    for (int j = i + 1; j < arr.length(); j++) {
+    for (int j = i + 1; j < (int)arr.length(); j++) {
       sum += arr[j] * (j - i);
     }
     if (temp_total_app_cost > sum) {
@@ -18,6 +18,9 @@ class PostOfficeSolver32 {
 
   static Array<int> InitRoundAndRepresentation(Array<int> &distribution, Array<int> &representation, Array<int> &round);
 
+  // Positions only, for callers that keep their tables in another form (see serf_xor_tables.h)
+  static Array<int> SolvePositions(Array<int> &distribution);
+
   static int WritePositions(Array<int> &positions, OutputBitStream *out);
 
  private:
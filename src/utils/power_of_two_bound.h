@@ -0,0 +1,58 @@
+#ifndef SERF_POWER_OF_TWO_BOUND_H
+#define SERF_POWER_OF_TWO_BOUND_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include "double.h"
+
+/*
+ * 2的幂误差界：步长为2^e时，量化的除法和重建的乘法都只是调整float的指数域，8051上省去软件浮点乘除。
+ * 结果与按2^e做乘除逐位相同，因为乘以2的幂是精确的。
+ */
+class PowerOfTwoBound {
+ public:
+  // 不大于bound的最大2的幂；bound不是正的规格化数时原样返回
+  static inline float Floor(float bound) {
+    uint32_t bits = Double::FloatToLongBits(bound);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    if ((bits & 0x80000000UL) != 0 || exponent == 0 || exponent == 0xFF) {
+      return bound;
+    }
+    return Double::LongBitsToFloat(bits & 0x7F800000UL);
+  }
+
+  // 压缩器实际使用的误差界：max_diff本身是2的幂时原样使用，否则按margin留出舍入余量后向下取整。
+  // 先乘margin再判断会把恰好是2的幂的max_diff减半
+  static inline float Bound(float max_diff, float margin) {
+    return IsPowerOfTwo(max_diff) ? max_diff : Floor(max_diff * margin);
+  }
+
+  // value是正的规格化2的幂时为真
+  static inline bool IsPowerOfTwo(float value) {
+    uint32_t bits = Double::FloatToLongBits(value);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    return (bits & 0x807FFFFFUL) == 0 && exponent != 0 && exponent != 0xFF;
+  }
+
+  // 2的幂value的指数e，value = 2^e
+  static inline int16_t Exponent(float value) {
+    return (int16_t)((Double::FloatToLongBits(value) >> 23) & 0xFF) - 127;
+  }
+
+  // value * 2^exponent：结果仍为规格化数时直接改指数域，0原样返回，其余情况交给ldexpf
+  static inline float Scale(float value, int16_t exponent) {
+    uint32_t bits = Double::FloatToLongBits(value);
+    int16_t biased = (int16_t)((bits >> 23) & 0xFF);
+    if (biased == 0 && (bits & 0x7FFFFFFFUL) == 0) {
+      return value;
+    }
+    int16_t scaled = biased + exponent;
+    if (biased == 0 || biased == 0xFF || scaled <= 0 || scaled >= 0xFF) {
+      return ldexpf(value, exponent);
+    }
+    return Double::LongBitsToFloat((bits & 0x807FFFFFUL) | ((uint32_t)scaled << 23));
+  }
+};
+
+#endif  // SERF_POWER_OF_TWO_BOUND_H
@@ -0,0 +1,35 @@
+#ifndef SERF_QT_PREDICTOR_H
+#define SERF_QT_PREDICTOR_H
+
+#include <stdint.h>
+
+/*
+ * SERF-QT的网格位置预测：q_i为相邻两个网格位置之差（差分），预测器由前一个差分预测当前差分，编码两者之残差。
+ * 压缩端和解压端共用这里的整数运算，预测不影响量化，max_diff的保证不变。
+ */
+class QtPredictor {
+ public:
+  // 线性预测系数c以1/8为单位，4位补码存储
+  static const uint8_t kCoefficientBits = 4;
+  static const int8_t kMinCoefficient = -8;
+  static const int8_t kMaxCoefficient = 7;
+
+  // round(c * previous_delta / 8)；|previous_delta|不小于2^27时乘法可能溢出，此时预测为0
+  static inline int32_t Linear(int8_t coefficient, int32_t previous_delta) {
+    if (previous_delta >= ((int32_t)1 << 27) || previous_delta <= -((int32_t)1 << 27)) {
+      return 0;
+    }
+    return (coefficient * previous_delta + 4) >> 3;
+  }
+
+  // 按无符号运算回绕，避免大差分时的有符号溢出
+  static inline int32_t Residual(int32_t delta, int32_t prediction) {
+    return (int32_t)((uint32_t)delta - (uint32_t)prediction);
+  }
+
+  static inline int32_t Restore(int32_t residual, int32_t prediction) {
+    return (int32_t)((uint32_t)residual + (uint32_t)prediction);
+  }
+};
+
+#endif  // SERF_QT_PREDICTOR_H
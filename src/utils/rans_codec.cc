@@ -0,0 +1,120 @@
+#include "rans_codec.h"
+#include <math.h>
+
+#include "array.h"
+#include "elias_gamma_codec.h"
+
+// Probabilities implied by Elias gamma code lengths (2 * floor(log2(z + 1)) + 1 bits), the rest to escape
+const uint16_t RansCodec::kStaticFrequencies[kAlphabetSize] = {
+    256, 64, 64, 16, 16, 16, 16, 4, 4, 4, 4, 4, 4, 4, 4, 32
+};
+
+void RansCodec::CumulativeFrequencies(const uint16_t *freq, uint16_t *out_cum_freq) {
+  out_cum_freq[0] = 0;
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    out_cum_freq[s + 1] = out_cum_freq[s] + freq[s];
+  }
+}
+
+void RansCodec::NormalizeFrequencies(const uint16_t *histogram, uint16_t *out_freq) {
+  uint32_t total = 0;
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    total += histogram[s];
+  }
+  if (total == 0) {
+    for (uint8_t s = 0; s < kAlphabetSize; s++) {
+      out_freq[s] = kStaticFrequencies[s];
+    }
+    return;
+  }
+
+  uint16_t sum = 0;
+  uint8_t largest = 0;
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    uint32_t scaled = (uint32_t)histogram[s] * kTotalFreq / total;
+    out_freq[s] = (histogram[s] > 0 && scaled == 0) ? 1 : (uint16_t)scaled;
+    sum += out_freq[s];
+    if (histogram[s] > histogram[largest]) {
+      largest = s;
+    }
+  }
+  // Rounding error goes to the most frequent symbol, which always has room for it (at most kAlphabetSize)
+  out_freq[largest] = (uint16_t)(out_freq[largest] + kTotalFreq - sum);
+}
+
+uint32_t RansCodec::EstimateBits(const uint16_t *histogram, const uint16_t *freq) {
+  float bits = 0.0f;
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    if (histogram[s] == 0) continue;
+    if (freq[s] == 0) return 0xFFFFFFFFUL;
+    bits += (float)histogram[s] * ((float)kScaleBits - log2f((float)freq[s]));
+  }
+  // final state
+  return (uint32_t)ceilf(bits) + 32;
+}
+
+int RansCodec::WriteFrequencies(const uint16_t *freq, OutputBitStream *output_bit_stream_ptr) {
+  int this_size = 0;
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    this_size += EliasGammaCodec::Encode(freq[s] + 1, output_bit_stream_ptr);
+  }
+  return this_size;
+}
+
+void RansCodec::ReadFrequencies(InputBitStream *input_bit_stream_ptr, uint16_t *out_freq) {
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    out_freq[s] = (uint16_t)(EliasGammaCodec::Decode(input_bit_stream_ptr) - 1);
+  }
+}
+
+int RansCodec::Encode(const uint8_t *symbols, uint16_t count, const uint16_t *freq,
+                      OutputBitStream *output_bit_stream_ptr) {
+  uint16_t cum_freq[kAlphabetSize + 1];
+  CumulativeFrequencies(freq, cum_freq);
+
+  // rANS encodes backwards, so words are collected first and emitted in reverse. Since kScaleBits < 16 each
+  // symbol renormalizes at most once.
+  Array<uint16_t> words(count + 1);
+  uint16_t word_count = 0;
+  uint32_t x = kStateLowerBound;
+  for (uint16_t i = count; i > 0; i--) {
+    uint8_t s = symbols[i - 1];
+    uint32_t f = freq[s];
+    // x_max = ((kStateLowerBound >> kScaleBits) << 16) * f, which only overflows when f == kTotalFreq
+    if (f < kTotalFreq && x >= (f << (32 - kScaleBits))) {
+      words[word_count++] = (uint16_t)(x & 0xFFFF);
+      x >>= 16;
+    }
+    x = ((x / f) << kScaleBits) + (x % f) + cum_freq[s];
+  }
+
+  int this_size = output_bit_stream_ptr->WriteLong(x, 32);
+  while (word_count > 0) {
+    this_size += output_bit_stream_ptr->WriteInt(words[--word_count], 16);
+  }
+  return this_size;
+}
+
+bool RansCodec::Decode(InputBitStream *input_bit_stream_ptr, const uint16_t *freq, uint8_t *slot_to_symbol,
+                       uint8_t *out_symbols, uint16_t count) {
+  uint16_t cum_freq[kAlphabetSize + 1];
+  CumulativeFrequencies(freq, cum_freq);
+  if (cum_freq[kAlphabetSize] != kTotalFreq) {
+    return false;
+  }
+  for (uint8_t s = 0; s < kAlphabetSize; s++) {
+    memset(slot_to_symbol + cum_freq[s], s, freq[s]);
+  }
+
+  uint32_t x = input_bit_stream_ptr->ReadLong(32);
+  for (uint16_t i = 0; i < count; i++) {
+    uint16_t slot = (uint16_t)(x & (kTotalFreq - 1));
+    uint8_t s = slot_to_symbol[slot];
+    out_symbols[i] = s;
+    x = freq[s] * (x >> kScaleBits) + slot - cum_freq[s];
+    if (x < kStateLowerBound) {
+      x = (x << 16) | input_bit_stream_ptr->ReadInt(16);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+#ifndef SERF_RANS_CODEC_H
+#define SERF_RANS_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "output_bit_stream.h"
+#include "input_bit_stream.h"
+
+/*
+ * Range-variant ANS over a small alphabet, used as the second-stage entropy coder of SERF-QT.
+ *
+ * Symbols 0..kEscapeSymbol-1 are zigzag values themselves, kEscapeSymbol marks a value that the caller
+ * stores out of band. The state is 32 bits and is renormalized 16 bits at a time, so the 8051 build only
+ * needs 32-bit arithmetic and one refill serves several symbols. The frequency table sums to kTotalFreq, so
+ * decoding is one lookup in a kTotalFreq-entry slot table plus one multiply-add per symbol.
+ *
+ * +-----------------+----------------+---------------------+
+ * |32bits - state   |16bits * n words|                     |
+ * +-----------------+----------------+---------------------+
+ */
+
+class RansCodec {
+ public:
+  static const uint8_t kAlphabetSize = 16;
+  static const uint8_t kEscapeSymbol = kAlphabetSize - 1;
+  static const uint8_t kScaleBits = 9;
+  static const uint16_t kTotalFreq = 1 << kScaleBits;
+  static const uint32_t kStateLowerBound = 1UL << 16;
+
+  // Fixed table used when sending a per-block table costs more than it saves
+  static const uint16_t kStaticFrequencies[kAlphabetSize];
+
+  // Scale a histogram to sum to kTotalFreq, every symbol that occurs keeps a frequency of at least 1
+  static void NormalizeFrequencies(const uint16_t *histogram, uint16_t *out_freq);
+
+  // Estimated payload size in bits of the symbols counted in histogram when coded with freq
+  static uint32_t EstimateBits(const uint16_t *histogram, const uint16_t *freq);
+
+  static int WriteFrequencies(const uint16_t *freq, OutputBitStream *output_bit_stream_ptr);
+
+  static void ReadFrequencies(InputBitStream *input_bit_stream_ptr, uint16_t *out_freq);
+
+  // Encode count symbols, returns the number of bits written
+  static int Encode(const uint8_t *symbols, uint16_t count, const uint16_t *freq,
+                    OutputBitStream *output_bit_stream_ptr);
+
+  // slot_to_symbol is caller-provided scratch of kTotalFreq bytes
+  static bool Decode(InputBitStream *input_bit_stream_ptr, const uint16_t *freq, uint8_t *slot_to_symbol,
+                     uint8_t *out_symbols, uint16_t count);
+
+ private:
+  static void CumulativeFrequencies(const uint16_t *freq, uint16_t *out_cum_freq);
+};
+
+#endif  // SERF_RANS_CODEC_H
@@ -0,0 +1,108 @@
+#ifndef SERF_CONFIG_H
+#define SERF_CONFIG_H
+
+#include <stdint.h>
+
+/*
+ * 平台配置：容量、整数位宽和SIMD开关都由这里的profile决定，其余代码不再自行判断平台。
+ *   SERF_PROFILE_CC2530     IAR EW8051/CC2530：32位double，缓冲区按XDATA限制
+ *   SERF_PROFILE_HOST       宿主机：64位double，缓冲区只受数据结构本身的位宽限制
+ *   SERF_PROFILE_HOST_SIMD  同SERF_PROFILE_HOST，另外启用x86的AVX2代码路径
+ * 未指定时自动选择；本文件中的每个宏仍可用-D单独覆盖。C源文件（file_reader.c）也包含本文件。
+ */
+#if !defined(SERF_PROFILE_CC2530) && !defined(SERF_PROFILE_HOST) && !defined(SERF_PROFILE_HOST_SIMD)
+#if defined(__ICC8051__) || (defined(__DOUBLE__) && __DOUBLE__ == 32)
+#define SERF_PROFILE_CC2530
+#elif defined(SERF_DOUBLE_WIDTH) && SERF_DOUBLE_WIDTH == 32
+// 在宿主机上模拟8051构建
+#define SERF_PROFILE_CC2530
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SERF_PROFILE_HOST_SIMD
+#else
+#define SERF_PROFILE_HOST
+#endif
+#endif
+
+#ifdef SERF_PROFILE_CC2530
+
+// IAR EW8051下double为32位
+#ifndef SERF_DOUBLE_WIDTH
+#define SERF_DOUBLE_WIDTH 32
+#endif
+
+// Array的长度类型：XDATA中的数组远小于64K，16位计数省去8051上的多字节运算
+typedef uint16_t serf_size_t;
+#define SERF_SIZE_MAX 0xFFFFu
+
+// Array的最大长度
+#ifndef MAX_ARRAY_SIZE
+#define MAX_ARRAY_SIZE 512
+#endif
+
+// file_reader的静态轨迹缓冲区（点数）
+#ifndef MAX_TRAJECTORY_POINTS
+#define MAX_TRAJECTORY_POINTS 200
+#endif
+
+// SERF-QT一个block的位流缓冲区（字节）：按平均每点约12位估计，最大128字节以节省XDATA；
+// max_diff过小、block超出该大小时AddValue()拒绝写不下的值，由调用者提前Close()
+#ifndef SERF_QT_BLOCK_BUFFER_BYTES
+#define SERF_QT_BLOCK_BUFFER_BYTES(block_size) ((uint32_t)(block_size) * 2 < 128 ? (uint32_t)(block_size) * 2 : 128)
+#endif
+
+// Chimp基线的位流缓冲区（字节），从1000 * 8减少到200 * 8
+#ifndef SERF_CHIMP_BUFFER_BYTES
+#define SERF_CHIMP_BUFFER_BYTES (200 * 8)
+#endif
+
+#else  // SERF_PROFILE_HOST / SERF_PROFILE_HOST_SIMD
+
+#ifndef SERF_DOUBLE_WIDTH
+#define SERF_DOUBLE_WIDTH 64
+#endif
+
+// Array的长度类型：32位，位流和块不受64K的限制
+typedef uint32_t serf_size_t;
+#define SERF_SIZE_MAX 0xFFFFFFFFu
+
+// 不限制，只受serf_size_t的位宽和可分配内存限制
+#ifndef MAX_ARRAY_SIZE
+#define MAX_ARRAY_SIZE SERF_SIZE_MAX
+#endif
+
+// file_reader的点数计数为uint16_t
+#ifndef MAX_TRAJECTORY_POINTS
+#define MAX_TRAJECTORY_POINTS 65535
+#endif
+
+// 最坏情况：每个差分为32位整数的Elias Gamma码（65位），另加不超过60位的header
+#ifndef SERF_QT_BLOCK_BUFFER_BYTES
+#define SERF_QT_BLOCK_BUFFER_BYTES(block_size) (((uint32_t)(block_size) * 65 + 7) / 8 + 8)
+#endif
+
+// 不限制，取OutputBitStream能分配的最大值
+#ifndef SERF_CHIMP_BUFFER_BYTES
+#define SERF_CHIMP_BUFFER_BYTES SERF_BIT_STREAM_MAX_BYTES
+#endif
+
+#endif  // SERF_PROFILE_CC2530
+
+// 位流的字节须能放入一个Array<uint8_t>取出，连同OutputBitStream多分配的一个uint32_t不超过MAX_ARRAY_SIZE；
+// 更大的缓冲区在OutputBitStream构造时截断到该值
+#define SERF_BIT_STREAM_MAX_BYTES ((uint32_t)(MAX_ARRAY_SIZE / 4 - 1) * 4)
+
+// 宿主机x86上可用AVX2的代码路径：按函数target("avx2")属性编译，运行时用__builtin_cpu_supports检测CPU，
+// 整个项目无需-mavx2
+#if defined(SERF_PROFILE_HOST_SIMD) && SERF_DOUBLE_WIDTH == 64 && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SERF_AVX2_DISPATCH
+#endif
+
+// 位流WriteLong/ReadLong一次处理的最大整数：宿主机为64位，8051为32位
+#if SERF_DOUBLE_WIDTH == 64
+typedef uint64_t serf_long_t;
+#else
+typedef uint32_t serf_long_t;
+#endif
+
+#endif  // SERF_CONFIG_H
@@ -0,0 +1,38 @@
+#ifndef SERF_STATS_H
+#define SERF_STATS_H
+
+#include <stdint.h>
+
+/*
+ * Compile-time optional hot-path counters of the XOR compressors.
+ *
+ * Build with -DSERF_ENABLE_STATS to make SERF_STATS(statement) execute its statement; without the flag it
+ * expands to nothing and the compressors carry no extra state.
+ */
+
+#ifdef SERF_ENABLE_STATS
+#define SERF_STATS(statement) statement
+#else
+#define SERF_STATS(statement) ((void) 0)
+#endif
+
+// FindAppLong tries at most 64 - leading_zeros + 1 prefixes, so depths are within [1, 65]
+#define SERF_SEARCH_DEPTH_BUCKETS 66
+
+typedef struct {
+  uint64_t values;
+  // AddValue reused stored_val_ because it was already within max_diff
+  uint64_t stored_val_reuses;
+  uint64_t find_app_long_calls;
+  // FindAppLong found no approximation and returned the original value
+  uint64_t find_app_long_fallbacks;
+  uint64_t find_app_long_iterations;
+  uint64_t search_depth_histogram[SERF_SEARCH_DEPTH_BUCKETS];
+  uint64_t case_01;
+  uint64_t case_1;
+  uint64_t case_00;
+  // the post-office positions were re-solved at a block boundary
+  uint64_t position_updates;
+} serf_xor_stats_t;
+
+#endif  // SERF_STATS_H
@@ -22,7 +22,8 @@ SerfUtils32::FindAppInt(float min_float, float max_float, uint32_t sign, float o
   // may be negative zero
   uint32_t min = Float::FloatToIntBits(min_float) & 0x7fffffff;
   uint32_t max = Float::FloatToIntBits(max_float);
-  int leading_zeros = __builtin_clz(min ^ max);
+  // min == max时__builtin_clz(0)未定义，此时整个区间只有一个值
+  int leading_zeros = min == max ? 32 : __builtin_clz(min ^ max);
   int32_t front_mask = 0xffffffff << (32 - leading_zeros);
   int shift = 32 - leading_zeros;
   uint32_t result_int;
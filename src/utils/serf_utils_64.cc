@@ -1,7 +1,13 @@
 #include "utils/serf_utils_64.h"
 
+#ifdef SERF_ENABLE_STATS
+thread_local int SerfUtils64::last_search_depth_ = 0;
+thread_local bool SerfUtils64::last_search_fell_back_ = false;
+#endif
+
 uint64_t SerfUtils64::FindAppLong(double min, double max, double v, uint64_t last_long, double max_diff,
                                   double adjust_digit) {
+  SERF_PERF_SCOPE(kPerfRegionFindAppLong);
   if (SERF_LIKELY(min >= 0)) {
     // both positive
     return FindAppLong(min, max, 0, v, last_long, max_diff, adjust_digit);
@@ -24,9 +30,11 @@ uint64_t SerfUtils64::FindAppLong(double min_double, double max_double, uint64_t
   // may be negative zero
   uint64_t min = Double::DoubleToLongBits(min_double) & 0x7fffffffffffffffULL;
   uint64_t max = Double::DoubleToLongBits(max_double);
-  int leading_zeros = __builtin_clzll(min ^ max);
+  // min == max时__builtin_clzll(0)未定义，此时整个区间只有一个值
+  int leading_zeros = min == max ? 64 : __builtin_clzll(min ^ max);
   int64_t front_mask = 0xffffffffffffffff << (64 - leading_zeros);
   int shift = 64 - leading_zeros;
+  SERF_STATS(last_search_fell_back_ = false);
   uint64_t result_long;
   double diff;
   uint64_t append;
@@ -47,6 +55,7 @@ uint64_t SerfUtils64::FindAppLong(double min_double, double max_double, uint64_t
 
     // 如果满足条件，直接返回
     if (condition1 && diff_satisfied) {
+      SERF_STATS(last_search_depth_ = 64 - leading_zeros - shift + 1);
       return result_long;
     }
 
@@ -61,6 +70,7 @@ uint64_t SerfUtils64::FindAppLong(double min_double, double max_double, uint64_t
     diff_satisfied = (diff >= -max_diff && diff <= max_diff);
 
     if (condition2 && diff_satisfied) {
+      SERF_STATS(last_search_depth_ = 64 - leading_zeros - shift + 1);
       return result_long;
     }
 
@@ -69,6 +79,8 @@ uint64_t SerfUtils64::FindAppLong(double min_double, double max_double, uint64_t
   }
 
   // we do not find a satisfied value, so we return the original value
+  SERF_STATS(last_search_depth_ = 64 - leading_zeros + 1);
+  SERF_STATS(last_search_fell_back_ = true);
   return Double::DoubleToLongBits(original + adjust_digit);
 }
 
@@ -96,7 +108,8 @@ uint64_t SerfUtils64::FindAppLongNoPlus(double min_double, double max_double, ui
   // may be negative zero
   uint64_t min = Double::DoubleToLongBits(min_double) & 0x7fffffffffffffffULL;
   uint64_t max = Double::DoubleToLongBits(max_double);
-  int leading_zeros = __builtin_clzll(min ^ max);
+  // min == max时__builtin_clzll(0)未定义，此时整个区间只有一个值
+  int leading_zeros = min == max ? 64 : __builtin_clzll(min ^ max);
   int64_t front_mask = 0xffffffffffffffff << (64 - leading_zeros);
   int shift = 64 - leading_zeros;
   uint64_t result_long;
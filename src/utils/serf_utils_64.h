@@ -15,6 +15,8 @@
 #include <cstdint>
 
 #include "double.h"
+#include "perf_counters.h"
+#include "serf_stats.h"
 
 class SerfUtils64 {
  public:
@@ -27,7 +29,20 @@ class SerfUtils64 {
   static uint64_t FindAppLongNoFast(double min, double max, double v, uint64_t last_long, double max_diff,
                                     double adjust_digit);
 
+#ifdef SERF_ENABLE_STATS
+  // Loop iterations spent by the last FindAppLong call of this thread
+  static int last_search_depth() { return last_search_depth_; }
+
+  // Whether the last FindAppLong call of this thread returned the unapproximated value
+  static bool last_search_fell_back() { return last_search_fell_back_; }
+#endif
+
  private:
+#ifdef SERF_ENABLE_STATS
+  static thread_local int last_search_depth_;
+  static thread_local bool last_search_fell_back_;
+#endif
+
   static constexpr uint64_t kBitWeight[64] = {
       1ULL, 2ULL, 4ULL, 8ULL, 16ULL, 32ULL, 64ULL, 128ULL,
       256ULL, 512ULL, 1024ULL, 2048ULL, 4096ULL, 8192ULL, 16384ULL,
@@ -0,0 +1,144 @@
+#ifndef SERF_XOR_TABLES_H
+#define SERF_XOR_TABLES_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "utils/array.h"
+
+/*
+ * Leading/trailing representation and round tables of one post-office solution, with the bits per value it
+ * implies. Entries are at most 64, so a set takes 258 contiguous bytes instead of four 64-int heap arrays.
+ */
+typedef struct {
+  uint8_t leading_representation[64];
+  uint8_t leading_round[64];
+  uint8_t trailing_representation[64];
+  uint8_t trailing_round[64];
+  uint8_t leading_bits_per_value;
+  uint8_t trailing_bits_per_value;
+} serf_xor_table_set_t;
+
+// Same for the 32-bit variant, whose positions index a 32-bit XOR
+typedef struct {
+  uint8_t leading_representation[32];
+  uint8_t leading_round[32];
+  uint8_t trailing_representation[32];
+  uint8_t trailing_round[32];
+  uint8_t leading_bits_per_value;
+  uint8_t trailing_bits_per_value;
+} serf_xor_table_set_32_t;
+
+/*
+ * Tables every SERF-XOR stream starts from, positions {0, 8, 12, 16, 18, 20, 22, 24} and {0, 22, 28, 32, 36, 40,
+ * 42, 46}. constexpr, so they sit in .rodata and all compressors share them until their positions diverge.
+ */
+constexpr serf_xor_table_set_t kSerfXORDefaultTableSet = {
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        8, 8, 8, 8, 12, 12, 12, 12,
+        16, 16, 18, 18, 20, 20, 22, 22,
+        24, 24, 24, 24, 24, 24, 24, 24,
+        24, 24, 24, 24, 24, 24, 24, 24,
+        24, 24, 24, 24, 24, 24, 24, 24,
+        24, 24, 24, 24, 24, 24, 24, 24,
+        24, 24, 24, 24, 24, 24, 24, 24
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 1, 1,
+        1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4,
+        5, 5, 6, 6, 6, 6, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 22, 22,
+        22, 22, 22, 22, 28, 28, 28, 28,
+        32, 32, 32, 32, 36, 36, 36, 36,
+        40, 40, 42, 42, 42, 42, 46, 46,
+        46, 46, 46, 46, 46, 46, 46, 46,
+        46, 46, 46, 46, 46, 46, 46, 46
+    },
+    3,
+    3
+};
+
+// Positions {0, 8, 12, 16} and {0, 16}
+constexpr serf_xor_table_set_32_t kSerfXOR32DefaultTableSet = {
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 3, 3, 3, 3,
+        3, 3, 3, 3, 3, 3, 3, 3
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        8, 8, 8, 8, 12, 12, 12, 12,
+        16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,
+        16, 16, 16, 16, 16, 16, 16, 16,
+        16, 16, 16, 16, 16, 16, 16, 16
+    },
+    2,
+    1
+};
+
+class SerfXORTables {
+ public:
+  // Same construction as PostOfficeSolver::InitRoundAndRepresentation, positions[0] is always position 0
+  static void Fill(const Array<int> &positions, int length, uint8_t *representation, uint8_t *round) {
+    representation[0] = 0;
+    round[0] = 0;
+    int i = 1;
+    for (int j = 1; j < length; ++j) {
+      int magic_code = (i < (int)positions.length() && j == positions[i]);
+      representation[j] = representation[j - 1] + magic_code;
+      round[j] = magic_code ? j : round[j - 1];
+      i += magic_code;
+    }
+  }
+
+  /*
+   * Copy-on-write switch to new tables: back to the shared defaults if the solution matches them, otherwise into
+   * the instance's own set, which is allocated the first time the instance diverges and reused after that.
+   */
+  template<typename TableSet, typename OwnedPtr>
+  static const TableSet *Assign(const TableSet &tables, const TableSet &defaults, OwnedPtr &owned) {
+    if (std::memcmp(&tables, &defaults, sizeof(TableSet)) == 0) {
+      return &defaults;
+    }
+    if (owned == nullptr) {
+      owned.reset(new TableSet(tables));
+    } else {
+      *owned = tables;
+    }
+    return owned.get();
+  }
+};
+
+#endif  // SERF_XOR_TABLES_H
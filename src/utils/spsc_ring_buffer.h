@@ -0,0 +1,170 @@
+#ifndef SERF_SPSC_RING_BUFFER_H
+#define SERF_SPSC_RING_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "serf_config.h"
+
+#ifndef SERF_PROFILE_CC2530
+#include <atomic>
+#endif
+
+/*
+ * Bounded single-producer/single-consumer ring buffer in front of a compressor. The producer (an acquisition
+ * thread, or the ADC ISR on the node) only calls Push, so it never waits for FindAppLong, a post-office update or
+ * a block Close; the consumer drains batches into AddValue or AddValues at its own pace. Push on a full buffer
+ * returns false and counts the sample in dropped() instead of blocking. A value the compressor refuses (its block
+ * is full) stays in the buffer, so the consumer can Close() the block and drain again without losing it.
+ *
+ * head_ is written only by the producer and tail_ only by the consumer, both as free-running counters. On the
+ * host they are atomics published with release/acquire and kept on separate cache lines; the 8051 is single-core
+ * and reads and writes an 8-bit volatile index in one instruction, so the capacity there is limited to 128.
+ */
+
+#ifdef SERF_PROFILE_CC2530
+#define SERF_RING_CACHE_ALIGN
+#else
+#define SERF_RING_CACHE_ALIGN alignas(64)
+#endif
+
+template<typename T, uint16_t kCapacity>
+class SpscRingBuffer {
+ public:
+  SpscRingBuffer() : head_(0), dropped_(0), tail_(0) {
+  }
+
+  // 生产者调用；缓冲区满时丢弃value并返回false
+  bool Push(const T &value) {
+    index_t head = LoadOwn(head_);
+    if ((index_t)(head - LoadAcquire(tail_)) == kCapacity) {
+      StoreRelease(dropped_, LoadOwn(dropped_) + 1);
+      return false;
+    }
+    buffer_[head & kMask] = value;
+    StoreRelease(head_, (index_t)(head + 1));
+    return true;
+  }
+
+  // 以下由消费者调用
+
+  uint16_t size() const {
+    return (uint16_t)(index_t)(LoadAcquire(head_) - LoadOwn(tail_));
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // 因缓冲区满而丢弃的值的个数，宿主机上为32位计数；8051上为16位，与中断并发读取时可能读到不一致的值，只作统计
+  uint32_t dropped() const {
+    return (uint32_t)LoadAcquire(dropped_);
+  }
+
+  bool Pop(T *value) {
+    index_t tail = LoadOwn(tail_);
+    if (LoadAcquire(head_) == tail) {
+      return false;
+    }
+    *value = buffer_[tail & kMask];
+    StoreRelease(tail_, (index_t)(tail + 1));
+    return true;
+  }
+
+  // 取出至多max_count个值，逐个交给bool sink->AddValue(T)，返回被接受的个数；
+  // 遇到第一个被拒绝的值即停止，该值及其后的值留在缓冲区中
+  template<typename Sink>
+  uint16_t DrainTo(Sink *sink, uint16_t max_count) {
+    index_t tail = LoadOwn(tail_);
+    uint16_t count = Available(tail, max_count);
+    uint16_t accepted = 0;
+    while (accepted < count && sink->AddValue(buffer_[(index_t)(tail + accepted) & kMask])) {
+      accepted++;
+    }
+    StoreRelease(tail_, (index_t)(tail + accepted));
+    return accepted;
+  }
+
+  // 同DrainTo，但按连续段交给uint16_t sink->AddValues(const T *, uint16_t)，在回绕处分为两次调用；
+  // AddValues返回接受的个数，少于段长时停止
+  template<typename Sink>
+  uint16_t DrainBatchesTo(Sink *sink, uint16_t max_count) {
+    index_t tail = LoadOwn(tail_);
+    uint16_t count = Available(tail, max_count);
+    uint16_t start = (uint16_t)(tail & kMask);
+    uint16_t first = kCapacity - start < count ? kCapacity - start : count;
+    uint16_t accepted = 0;
+    if (first > 0) {
+      accepted = sink->AddValues(buffer_ + start, first);
+    }
+    if (accepted == first && count > first) {
+      accepted += sink->AddValues(buffer_, count - first);
+    }
+    // 段交给sink之后才释放，生产者不会覆盖正在压缩的值
+    StoreRelease(tail_, (index_t)(tail + accepted));
+    return accepted;
+  }
+
+ private:
+#ifdef SERF_PROFILE_CC2530
+  typedef uint8_t index_t;
+  typedef volatile index_t shared_index_t;
+  typedef volatile uint16_t shared_counter_t;
+
+  template<typename U>
+  static U LoadOwn(const volatile U &shared) {
+    return shared;
+  }
+
+  template<typename U>
+  static U LoadAcquire(const volatile U &shared) {
+    return shared;
+  }
+
+  template<typename U, typename V>
+  static void StoreRelease(volatile U &shared, V value) {
+    shared = (U)value;
+  }
+#else
+  typedef uint32_t index_t;
+  typedef std::atomic<index_t> shared_index_t;
+  typedef std::atomic<uint32_t> shared_counter_t;
+
+  // 本端写入的变量，只有本端修改，relaxed即可
+  template<typename U>
+  static U LoadOwn(const std::atomic<U> &shared) {
+    return shared.load(std::memory_order_relaxed);
+  }
+
+  template<typename U>
+  static U LoadAcquire(const std::atomic<U> &shared) {
+    return shared.load(std::memory_order_acquire);
+  }
+
+  template<typename U, typename V>
+  static void StoreRelease(std::atomic<U> &shared, V value) {
+    shared.store((U)value, std::memory_order_release);
+  }
+#endif
+
+  static const index_t kMask = (index_t)(kCapacity - 1);
+
+  // 容量须为2的幂；8051上还须不超过128，8位下标才能区分满和空
+#ifdef SERF_PROFILE_CC2530
+  typedef char CapacityCheck[(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0 && kCapacity <= 128) ? 1 : -1];
+#else
+  typedef char CapacityCheck[(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0) ? 1 : -1];
+#endif
+
+  uint16_t Available(index_t tail, uint16_t max_count) const {
+    uint16_t available = (uint16_t)(index_t)(LoadAcquire(head_) - tail);
+    return available < max_count ? available : max_count;
+  }
+
+  T buffer_[kCapacity];
+  SERF_RING_CACHE_ALIGN shared_index_t head_;
+  shared_counter_t dropped_;
+  SERF_RING_CACHE_ALIGN shared_index_t tail_;
+};
+
+#endif  // SERF_SPSC_RING_BUFFER_H
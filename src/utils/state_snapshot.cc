@@ -0,0 +1,138 @@
+#include "state_snapshot.h"
+
+StateWriter::StateWriter(serf_size_t initial_capacity) : buffer_(initial_capacity) {
+  length_ = 0;
+  ok_ = buffer_.is_valid();
+}
+
+bool StateWriter::Reserve(serf_size_t length) {
+  if (!ok_) {
+    return false;
+  }
+  uint32_t required = (uint32_t)length_ + length;
+  if (required < length_) {
+    ok_ = false;
+    return false;
+  }
+  if (required <= buffer_.length()) {
+    return true;
+  }
+  // 按两倍扩展，不超过MAX_ARRAY_SIZE
+  uint32_t capacity = (uint32_t)buffer_.length() * 2;
+  if (capacity < required) {
+    capacity = required;
+  }
+  if ((uint32_t)MAX_ARRAY_SIZE < capacity) {
+    capacity = MAX_ARRAY_SIZE;
+  }
+  if (capacity < required) {
+    ok_ = false;
+    return false;
+  }
+  Array<uint8_t> grown((serf_size_t)capacity);
+  if (!grown.is_valid()) {
+    ok_ = false;
+    return false;
+  }
+  if (length_ > 0) {
+    memcpy(grown.begin(), buffer_.begin(), length_);
+  }
+  buffer_.swap(grown);
+  return true;
+}
+
+void StateWriter::PutVarint(uint32_t value) {
+  do {
+    uint8_t group = value & 0x7F;
+    value >>= 7;
+    if (value != 0) {
+      group |= 0x80;
+    }
+    PutBytes(&group, 1);
+  } while (value != 0);
+}
+
+void StateWriter::PutBytes(const void *bytes, serf_size_t length) {
+  if (length == 0 || !Reserve(length)) {
+    return;
+  }
+  memcpy(buffer_.begin() + length_, bytes, length);
+  length_ += length;
+}
+
+void StateWriter::PutFloat(float value) {
+  PutBytes(&value, sizeof(value));
+}
+
+void StateWriter::PutDouble(double value) {
+  PutBytes(&value, sizeof(value));
+}
+
+bool StateWriter::ok() const {
+  return ok_;
+}
+
+Array<uint8_t> StateWriter::Finish() const {
+  Array<uint8_t> snapshot;
+  if (!ok_ || length_ == 0) {
+    return snapshot;
+  }
+  Array<uint8_t> temp_array(length_);
+  if (temp_array.is_valid()) {
+    memcpy(temp_array.begin(), buffer_.begin(), length_);
+    snapshot.swap(temp_array);
+  }
+  return snapshot;
+}
+
+StateReader::StateReader(const Array<uint8_t> &snapshot) : snapshot_(snapshot) {
+  position_ = 0;
+  ok_ = snapshot.is_valid();
+}
+
+uint32_t StateReader::GetVarint() {
+  uint32_t value = 0;
+  // 32位值最多5个varint字节
+  for (uint8_t shift = 0; ok_ && shift < 35; shift += 7) {
+    uint8_t group;
+    GetBytes(&group, 1);
+    value |= (uint32_t)(group & 0x7F) << shift;
+    if ((group & 0x80) == 0) {
+      return ok_ ? value : 0;
+    }
+  }
+  ok_ = false;
+  return 0;
+}
+
+void StateReader::GetBytes(void *bytes, serf_size_t length) {
+  if (!ok_ || length > snapshot_.length() - position_) {
+    ok_ = false;
+    memset(bytes, 0, length);
+    return;
+  }
+  if (length > 0) {
+    memcpy(bytes, snapshot_.begin() + position_, length);
+    position_ += length;
+  }
+}
+
+float StateReader::GetFloat() {
+  float value;
+  GetBytes(&value, sizeof(value));
+  return value;
+}
+
+double StateReader::GetDouble() {
+  double value;
+  GetBytes(&value, sizeof(value));
+  return value;
+}
+
+bool StateReader::ok() const {
+  return ok_;
+}
+
+bool StateReader::finished() const {
+  return ok_ && position_ == snapshot_.length();
+}
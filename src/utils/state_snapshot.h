@@ -0,0 +1,69 @@
+#ifndef SERF_STATE_SNAPSHOT_H
+#define SERF_STATE_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "array.h"
+
+/*
+ * Byte-level writer and reader of compressor state snapshots (SaveState/LoadState). Integers are varints, 7 data
+ * bits plus a continuation bit per byte, lowest group first, as in NetSeriesId, so the mostly small counters and
+ * the 64-entry tables take about a byte each. Floats and doubles are copied as their native bytes: a snapshot is
+ * restored by the same build on the same platform, e.g. a restarted collector or its standby.
+ *
+ * Every snapshot starts with a tag naming the compressor and the snapshot version, so a snapshot handed to the
+ * wrong class or an older build is rejected instead of misread.
+ */
+
+class StateWriter {
+ public:
+  explicit StateWriter(serf_size_t initial_capacity);
+
+  void PutVarint(uint32_t value);
+
+  void PutBytes(const void *bytes, serf_size_t length);
+
+  void PutFloat(float value);
+
+  void PutDouble(double value);
+
+  // 写入过程中缓冲区无法再扩展时为false
+  bool ok() const;
+
+  // 返回恰好为已写入长度的快照，失败时返回空Array
+  Array<uint8_t> Finish() const;
+
+ private:
+  Array<uint8_t> buffer_;
+  serf_size_t length_;
+  bool ok_;
+
+  bool Reserve(serf_size_t length);
+};
+
+class StateReader {
+ public:
+  explicit StateReader(const Array<uint8_t> &snapshot);
+
+  // 读取越界或varint过长时置失败，之后所有读取返回0
+  uint32_t GetVarint();
+
+  void GetBytes(void *bytes, serf_size_t length);
+
+  float GetFloat();
+
+  double GetDouble();
+
+  bool ok() const;
+
+  // 快照恰好读完且没有失败
+  bool finished() const;
+
+ private:
+  const Array<uint8_t> &snapshot_;
+  serf_size_t position_;
+  bool ok_;
+};
+
+#endif  // SERF_STATE_SNAPSHOT_H
@@ -7,7 +7,8 @@
 class ZigZagCodec {
  public:
   static inline int32_t Encode(int32_t value) {
-    return (value << 1) ^ (value >> 31);
+    // 按无符号左移：有符号负数左移是未定义行为
+    return (int32_t)(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
   }
 
   static inline int32_t Decode(int32_t value) {
@@ -0,0 +1,63 @@
+#ifndef SERF_PERF_EXPR_CONFIG_HPP
+#define SERF_PERF_EXPR_CONFIG_HPP
+
+#include <string>
+#include <unordered_map>
+
+/*
+ * Shared experiment configuration of the unit tests and the benchmark suite.
+ */
+
+const static int kBlockSizeOverall = 50;
+const static int kWindowSizeOverall = 1000;
+const static std::string kDataSetDirPrefix = "../../test/data_set/";
+
+const static std::string kDataSetList[] = {
+    "Air-pressure.csv",
+    "Basel-temp.csv",
+    "Basel-wind.csv",
+    "Chengdu-traj.csv",
+    "City-temp.csv",
+    "Dew-point-temp.csv",
+    "IR-bio-temp.csv",
+    "Motor-temp.csv",
+    "PM10-dust.csv",
+    "Smart-grid.csv",
+    "Stocks-USA.csv",
+    "T-drive.csv",
+    "Tsbs-iot-latitude.csv",
+    "Tsbs-iot-longitude.csv",
+    "Wind-Speed.csv"
+};
+
+// Computed by test/adjust_digit_calculator.cpp from the global min/max of each data set
+const static std::unordered_map<std::string, int> kFileNameToAdjustDigit = {
+    {"Air-pressure.csv", 0},
+    {"Basel-temp.csv", 80},
+    {"Basel-wind.csv", 126},
+    {"Chengdu-traj.csv", 0},
+    {"City-temp.csv", 355},
+    {"Dew-point-temp.csv", 109},
+    {"IR-bio-temp.csv", 39},
+    {"Motor-temp.csv", 109},
+    {"PM10-dust.csv", 256},
+    {"Smart-grid.csv", 4},
+    {"Stocks-USA.csv", 245},
+    {"T-drive.csv", 0},
+    {"Tsbs-iot-latitude.csv", 0},
+    {"Tsbs-iot-longitude.csv", 0},
+    {"Wind-Speed.csv", 8}
+};
+
+constexpr static double kMaxDiffList[] = {1.0E-1, 1.0E-2, 1.0E-3, 1.0E-4, 1.0E-5, 1.0E-6};
+
+// Data sets whose precision is representable by float
+const static int kBlockSize32 = 50;
+constexpr static float kMaxDiff32 = 1.0E-3f;
+const static std::string kDataSetList32[] = {
+    "City-temp.csv",
+    "Dew-point-temp.csv",
+    "Stocks-USA.csv"
+};
+
+#endif  // SERF_PERF_EXPR_CONFIG_HPP
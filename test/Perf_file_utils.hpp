@@ -0,0 +1,64 @@
+#ifndef SERF_PERF_FILE_UTILS_HPP
+#define SERF_PERF_FILE_UTILS_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read a block of double from file input stream, whose size is equal to block_size
+ * @param file_input_stream_ref Input steam where this function reads
+ * @param block_size Max number of values to read
+ * @return A vector of doubles, whose size may be less than block_size
+ */
+inline std::vector<double> ReadBlock(std::ifstream &file_input_stream_ref, int block_size) {
+  std::vector<double> ret;
+  ret.reserve(block_size);
+  int entry_count = 0;
+  double buffer;
+  while (entry_count < block_size && file_input_stream_ref >> buffer) {
+    ret.emplace_back(buffer);
+    ++entry_count;
+  }
+  return ret;
+}
+
+/**
+ * @brief Read a block of float from file input stream, whose size is equal to block_size
+ * @param file_input_stream_ref Input steam where this function reads
+ * @param block_size Max number of values to read
+ * @return A vector of floats, whose size may be less than block_size
+ */
+inline std::vector<float> ReadBlock32(std::ifstream &file_input_stream_ref, int block_size) {
+  std::vector<float> ret;
+  ret.reserve(block_size);
+  int entry_count = 0;
+  float buffer;
+  while (entry_count < block_size && file_input_stream_ref >> buffer) {
+    ret.emplace_back(buffer);
+    ++entry_count;
+  }
+  return ret;
+}
+
+/**
+ * @brief Read a whole data set into memory, so that timed loops do not include parsing
+ * @param file_path Path of the data set
+ * @return All the doubles in the file, empty if the file cannot be opened
+ */
+inline std::vector<double> ReadDataSet(const std::string &file_path) {
+  std::ifstream data_set_input_stream(file_path);
+  std::vector<double> ret;
+  double buffer;
+  while (data_set_input_stream >> buffer) {
+    ret.emplace_back(buffer);
+  }
+  return ret;
+}
+
+inline void ResetFileStream(std::ifstream &data_set_input_stream_ref) {
+  data_set_input_stream_ref.clear();
+  data_set_input_stream_ref.seekg(0, std::ios::beg);
+}
+
+#endif  // SERF_PERF_FILE_UTILS_HPP
@@ -26,7 +26,7 @@ const uint16_t ChimpCompressor::leadingRnd_[64] = {
 
 ChimpCompressor::ChimpCompressor(uint16_t previousValues) {
     // IAR适配：使用new替代std::make_unique，减少内存使用
-    output_bit_stream_ = new OutputBitStream(200 * 8); // 从1000减少到200
+    output_bit_stream_ = new OutputBitStream(SERF_CHIMP_BUFFER_BYTES);
     size_ = 0;
     previousValues_ = previousValues;
     previousValuesLog2_ = (uint16_t)(logf((float)previousValues_) / logf(2.0f));
@@ -53,6 +53,9 @@ ChimpCompressor::ChimpCompressor(uint16_t previousValues) {
     storedLeadingZeros_ = 0x7FFF; // 使用最大int16_t值
     index_ = 0;
     current_ = 0;
+    number_of_values_ = 0;
+    // 16位值个数，get_compress_pack()时回填
+    size_ += output_bit_stream_->WriteInt(0, 16);
 }
 
 ChimpCompressor::~ChimpCompressor() {
@@ -130,10 +133,10 @@ void ChimpCompressor::addValue(float v) {
         index_++;
         indices_[key] = index_;
     }
+    number_of_values_++;
 }
 
 void ChimpCompressor::close() {
-    addValue(0.0f / 0.0f); // 使用NaN替代std::numeric_limits
     output_bit_stream_->Flush();
 }
 
@@ -143,5 +146,8 @@ uint32_t ChimpCompressor::get_size() {
 
 Array<uint8_t> ChimpCompressor::get_compress_pack() {
     compress_pack_ = output_bit_stream_->GetBuffer((uint32_t)ceilf((float)size_ / 8.0f));
+    // LSB-first位流，值个数低字节在前
+    compress_pack_[0] = (uint8_t)(number_of_values_ & 0xFF);
+    compress_pack_[1] = (uint8_t)(number_of_values_ >> 8);
     return compress_pack_;
 }
\ No newline at end of file
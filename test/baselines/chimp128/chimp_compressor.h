@@ -59,6 +59,8 @@ private:
 
     bool first_;
 
+    uint16_t number_of_values_;
+
     Array<uint8_t> compress_pack_;
 };
 
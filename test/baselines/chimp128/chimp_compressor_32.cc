@@ -9,6 +9,8 @@ ChimpCompressor32::ChimpCompressor32(int previousValues) {
   setLsb_ = (int) std::pow(2, threshold_ + 1) - 1;
   indices_ = std::make_unique<int []>((int) std::pow(2, threshold_ + 1));
   storedValues_ = std::make_unique<uint32_t []>(previousValues_);
+  // 16-bit value count, patched in get_compress_pack() once the block is complete
+  size_ += output_bit_stream_->WriteInt(0, 16);
 }
 
 void ChimpCompressor32::addValue(float v) {
@@ -77,15 +79,18 @@ void ChimpCompressor32::addValue(float v) {
     index_++;
     indices_[key] = index_;
   }
+  ++number_of_values_;
 }
 
 void ChimpCompressor32::close() {
-  addValue(std::numeric_limits<double>::quiet_NaN());
   output_bit_stream_->Flush();
 }
 
 Array<uint8_t> ChimpCompressor32::get_compress_pack() {
   compress_pack_ = output_bit_stream_->GetBuffer(std::ceil(size_ / 8.0));
+  // the stream is MSB-first, so the value count is stored high byte first
+  compress_pack_[0] = static_cast<uint8_t>(number_of_values_ >> 8);
+  compress_pack_[1] = static_cast<uint8_t>(number_of_values_ & 0xFF);
   return compress_pack_;
 }
 
@@ -69,6 +69,8 @@ class ChimpCompressor32 {
 
   bool first_ = true;
 
+  uint16_t number_of_values_ = 0;
+
   Array<uint8_t> compress_pack_ = Array<uint8_t>(0);
 };
 
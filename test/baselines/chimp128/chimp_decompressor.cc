@@ -10,10 +10,10 @@ ChimpDecompressor::ChimpDecompressor(const Array<uint8_t> &bs, int previousValue
 }
 
 std::vector<double> ChimpDecompressor::decompress() {
-    std::vector<double> values;
-    double cur_value;
-    while (!std::isnan(cur_value = nextValue())) {
-        values.emplace_back(cur_value);
+    uint16_t count = static_cast<uint16_t>(input_bit_stream_->ReadInt(16));
+    std::vector<double> values(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        values[i] = nextValue();
     }
     return values;
 }
@@ -9,10 +9,10 @@ ChimpDecompressor32::ChimpDecompressor32(const Array<uint8_t> &bs, int previousV
 }
 
 std::vector<float> ChimpDecompressor32::decompress() {
-  std::vector<float> values;
-  float cur_value;
-  while (!std::isnan(cur_value = nextValue())) {
-    values.emplace_back(cur_value);
+  uint16_t count = static_cast<uint16_t>(input_bit_stream_->ReadInt(16));
+  std::vector<float> values(count);
+  for (uint16_t i = 0; i < count; ++i) {
+    values[i] = nextValue();
   }
   return values;
 }
@@ -2,6 +2,8 @@
 
 GorillaCompressor::GorillaCompressor(int capacity) {
     output_bit_stream_ = std::make_unique<OutputBitStream>(2 * capacity * sizeof(double));
+    // 16-bit value count, patched in get_compress_pack() once the block is complete
+    compress_size_in_bits_ += output_bit_stream_->WriteInt(0, 16);
 }
 
 void GorillaCompressor::addValue(double v) {
@@ -42,16 +44,19 @@ void GorillaCompressor::addValue(double v) {
     }
 
     pr_value_ = raw_binary;
+    ++number_of_values_;
 }
 
 void GorillaCompressor::close() {
-    addValue(std::numeric_limits<double>::quiet_NaN());
     output_bit_stream_->Flush();
 }
 
 Array<uint8_t> GorillaCompressor::get_compress_pack() {
     compress_pack_ = output_bit_stream_->GetBuffer(std::ceil
             (compress_size_in_bits_ / 8.0));
+    // the stream is MSB-first, so the value count is stored high byte first
+    compress_pack_[0] = static_cast<uint8_t>(number_of_values_ >> 8);
+    compress_pack_[1] = static_cast<uint8_t>(number_of_values_ & 0xFF);
     return compress_pack_;
 }
 
@@ -28,6 +28,8 @@ private:
 
     long compress_size_in_bits_ = 0;
 
+    uint16_t number_of_values_ = 0;
+
     bool first_ = true;
 
     uint64_t pr_value_ = 0;
@@ -0,0 +1,280 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Perf_expr_config.hpp"
+#include "Perf_file_utils.hpp"
+
+#include "compressor/net_serf_xor_compressor.h"
+#include "decompressor/net_serf_xor_decompressor.h"
+#include "compressor/net_serf_qt_compressor.h"
+#include "decompressor/net_serf_qt_decompressor.h"
+
+/*
+ * End-to-end loopback harness of the Net compressors, the local stand-in for the sensor-to-gateway link. A data
+ * set is replayed value by value at a fixed rate: each value is compressed into one packet, sent over a localhost
+ * UDP socket pair and decompressed by a receiver thread. Loss is simulated on the sender side, in which case
+ * both ends run in resync mode (see NetResyncEncoder) so the receiver keeps decoding after gaps.
+ *
+ * Every datagram carries an 8-byte send timestamp trailer used only for measurement; it is not counted in the
+ * payload. Reported per run:
+ *   p50/p99/max latency - from before Compress() to after Decompress(), per decoded value
+ *   pps                 - packets received per second of wall time
+ *   payload bytes       - compressed bytes, and with 28 bytes of IPv4/UDP header per packet
+ *
+ * Usage: net_loopback [--algo xor|qt] [--data-set Air-pressure.csv] [--max-diff 1e-3] [--rate 1000]
+ *                     [--loss 0.01] [--values 10000] [--keyframe 32] [--seed 1]
+ * A rate of 0 sends as fast as possible.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t kTrailerBytes = sizeof(int64_t);
+const size_t kIpUdpHeaderBytes = 28;
+const size_t kMaxDatagramBytes = 2048;
+
+struct LoopbackOptions {
+  std::string algo = "qt";
+  std::string data_set = "Air-pressure.csv";
+  double max_diff = 1.0E-3;
+  double rate = 1000;
+  double loss = 0;
+  size_t values = 10000;
+  uint16_t keyframe_interval = 32;
+  uint32_t seed = 1;
+};
+
+struct LoopbackResult {
+  size_t packets_sent = 0;
+  size_t packets_dropped = 0;
+  size_t packets_received = 0;
+  size_t values_decoded = 0;
+  size_t values_lost = 0;
+  size_t payload_bytes = 0;
+  double seconds = 0;
+  std::vector<int64_t> latencies_ns;
+};
+
+// Encoder/decoder pair behind a common interface, so the harness does not depend on the algorithm
+struct NetCodec {
+  std::function<Array<uint8_t>(double, uint32_t)> compress;
+  std::function<NetResyncStatus(Array<uint8_t> &, double *)> decompress;
+};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+NetCodec MakeCodec(const LoopbackOptions &options) {
+  net_resync_config_t resync_config = {options.keyframe_interval, 0};
+  NetCodec codec;
+  if (options.algo == "xor") {
+    int adjust_digit = kFileNameToAdjustDigit.find(options.data_set)->second;
+    auto compressor = std::make_shared<NetSerfXORCompressor>(kWindowSizeOverall, options.max_diff, adjust_digit);
+    auto decompressor = std::make_shared<NetSerfXORDecompressor>(kWindowSizeOverall, adjust_digit);
+    if (options.loss > 0) {
+      compressor->EnableResync(resync_config);
+      decompressor->EnableResync();
+    }
+    codec.compress = [compressor](double v, uint32_t now_ms) { return compressor->Compress(v, 0, now_ms); };
+    codec.decompress = [decompressor](Array<uint8_t> &bs, double *v) { return decompressor->Decompress(bs, v); };
+  } else {
+    auto compressor = std::make_shared<NetSerfQtCompressor>(options.max_diff);
+    auto decompressor = std::make_shared<NetSerfQtDecompressor>(options.max_diff);
+    if (options.loss > 0) {
+      compressor->EnableResync(resync_config);
+      decompressor->EnableResync();
+    }
+    codec.compress = [compressor](double v, uint32_t now_ms) { return compressor->Compress(v, 0, now_ms); };
+    codec.decompress = [decompressor](Array<uint8_t> &bs, double *v) { return decompressor->Decompress(bs, v); };
+  }
+  return codec;
+}
+
+/**
+ * @brief Open the receiving socket on an ephemeral localhost port and a sending socket connected to it
+ * @return false if any socket call fails
+ */
+bool OpenSocketPair(int *send_fd, int *receive_fd) {
+  *receive_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  *send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (*receive_fd < 0 || *send_fd < 0) {
+    std::perror("socket");
+    return false;
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t address_length = sizeof(address);
+  if (bind(*receive_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      getsockname(*receive_fd, reinterpret_cast<sockaddr *>(&address), &address_length) != 0 ||
+      connect(*send_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    std::perror("bind/connect");
+    return false;
+  }
+  // Lets the receiver give up if the end marker is lost
+  timeval timeout{0, 500000};
+  setsockopt(*receive_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int buffer_size = 4 << 20;
+  setsockopt(*receive_fd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+  return true;
+}
+
+void Receive(int receive_fd, NetCodec *codec, LoopbackResult *result) {
+  uint8_t datagram[kMaxDatagramBytes];
+  while (true) {
+    ssize_t length = recv(receive_fd, datagram, sizeof(datagram), 0);
+    if (length <= 0 || static_cast<size_t>(length) < kTrailerBytes) {
+      // end marker or timeout
+      break;
+    }
+    ++result->packets_received;
+    size_t payload_length = length - kTrailerBytes;
+    int64_t sent_ns;
+    std::memcpy(&sent_ns, datagram + payload_length, sizeof(sent_ns));
+
+    Array<uint8_t> packet(payload_length);
+    std::memcpy(packet.begin(), datagram, payload_length);
+    double value;
+    if (codec->decompress(packet, &value) == kNetResyncLost) {
+      ++result->values_lost;
+      continue;
+    }
+    result->latencies_ns.push_back(NowNs() - sent_ns);
+    ++result->values_decoded;
+  }
+}
+
+LoopbackResult RunLoopback(const LoopbackOptions &options, const std::vector<double> &data) {
+  LoopbackResult result;
+  int send_fd;
+  int receive_fd;
+  if (!OpenSocketPair(&send_fd, &receive_fd)) {
+    std::exit(1);
+  }
+  NetCodec codec = MakeCodec(options);
+  std::mt19937 random_engine(options.seed);
+  std::bernoulli_distribution drop(options.loss);
+
+  std::thread receiver(Receive, receive_fd, &codec, &result);
+  uint8_t datagram[kMaxDatagramBytes];
+  Clock::time_point start = Clock::now();
+  std::chrono::duration<double> period(options.rate > 0 ? 1.0 / options.rate : 0);
+  for (size_t i = 0; i < options.values; ++i) {
+    if (options.rate > 0) {
+      std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(period * i));
+    }
+    int64_t sent_ns = NowNs();
+    uint32_t now_ms = static_cast<uint32_t>(sent_ns / 1000000);
+    Array<uint8_t> packet = codec.compress(data[i % data.size()], now_ms);
+    ++result.packets_sent;
+    result.payload_bytes += packet.length();
+    if (drop(random_engine)) {
+      ++result.packets_dropped;
+      continue;
+    }
+    std::memcpy(datagram, packet.begin(), packet.length());
+    std::memcpy(datagram + packet.length(), &sent_ns, sizeof(sent_ns));
+    if (send(send_fd, datagram, packet.length() + kTrailerBytes, 0) < 0) {
+      std::perror("send");
+    }
+  }
+  send(send_fd, datagram, 0, 0);
+  receiver.join();
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  close(send_fd);
+  close(receive_fd);
+  return result;
+}
+
+double PercentileUs(std::vector<int64_t> &latencies_ns, double percentile) {
+  if (latencies_ns.empty()) {
+    return 0;
+  }
+  size_t rank = std::min(latencies_ns.size() - 1, static_cast<size_t>(percentile * latencies_ns.size()));
+  std::nth_element(latencies_ns.begin(), latencies_ns.begin() + rank, latencies_ns.end());
+  return latencies_ns[rank] / 1000.0;
+}
+
+void Report(const LoopbackOptions &options, LoopbackResult &result) {
+  std::printf("%s %s max_diff=%g rate=%g/s loss=%g\n", options.algo.c_str(), options.data_set.c_str(),
+              options.max_diff, options.rate, options.loss);
+  std::printf("  packets   sent %zu, dropped %zu, received %zu\n", result.packets_sent, result.packets_dropped,
+              result.packets_received);
+  std::printf("  values    decoded %zu, lost to resync %zu\n", result.values_decoded, result.values_lost);
+  std::printf("  latency   p50 %.1f us, p99 %.1f us, max %.1f us\n", PercentileUs(result.latencies_ns, 0.5),
+              PercentileUs(result.latencies_ns, 0.99), PercentileUs(result.latencies_ns, 1.0));
+  std::printf("  rate      %.0f pps over %.3f s\n", result.packets_received / result.seconds, result.seconds);
+  std::printf("  bytes     payload %zu (%.2f bits/value), on the wire %zu\n", result.payload_bytes,
+              result.payload_bytes * 8.0 / result.packets_sent,
+              result.payload_bytes + result.packets_sent * kIpUdpHeaderBytes);
+}
+
+bool ParseOptions(int argc, char **argv, LoopbackOptions *options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string flag = argv[i];
+    const char *value = argv[i + 1];
+    if (flag == "--algo") {
+      options->algo = value;
+    } else if (flag == "--data-set") {
+      options->data_set = value;
+    } else if (flag == "--max-diff") {
+      options->max_diff = std::atof(value);
+    } else if (flag == "--rate") {
+      options->rate = std::atof(value);
+    } else if (flag == "--loss") {
+      options->loss = std::atof(value);
+    } else if (flag == "--values") {
+      options->values = std::strtoul(value, nullptr, 10);
+    } else if (flag == "--keyframe") {
+      options->keyframe_interval = static_cast<uint16_t>(std::atoi(value));
+    } else if (flag == "--seed") {
+      options->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    } else {
+      return false;
+    }
+  }
+  if (argc % 2 == 0) {
+    return false;
+  }
+  return (options->algo == "xor" || options->algo == "qt") &&
+      kFileNameToAdjustDigit.find(options->data_set) != kFileNameToAdjustDigit.end() &&
+      options->loss >= 0 && options->loss < 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  LoopbackOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    std::fprintf(stderr, "usage: %s [--algo xor|qt] [--data-set NAME] [--max-diff D] [--rate VALUES_PER_S] "
+                         "[--loss P] [--values N] [--keyframe N] [--seed S]\n", argv[0]);
+    return 1;
+  }
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + options.data_set);
+  if (data.empty()) {
+    std::fprintf(stderr, "Failed to open the file [%s]\n", options.data_set.c_str());
+    return 1;
+  }
+  LoopbackResult result = RunLoopback(options, data);
+  Report(options, result);
+  return 0;
+}
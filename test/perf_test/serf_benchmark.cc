@@ -0,0 +1,579 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Perf_expr_config.hpp"
+#include "Perf_file_utils.hpp"
+
+#include "compressor/serf_xor_compressor.h"
+#include "decompressor/serf_xor_decompressor.h"
+#include "compressor/serf_qt_compressor.h"
+#include "decompressor/serf_qt_decompressor.h"
+#include "compressor_32/serf_xor_compressor_32.h"
+#include "decompressor_32/serf_xor_decompressor_32.h"
+#include "compressor_32/serf_qt_compressor_32.h"
+#include "decompressor_32/serf_qt_decompressor_32.h"
+#include "compressor/net_serf_xor_compressor.h"
+#include "decompressor/net_serf_xor_decompressor.h"
+#include "compressor/net_serf_qt_compressor.h"
+#include "decompressor/net_serf_qt_decompressor.h"
+#include "baselines/chimp128/chimp_compressor.h"
+#include "baselines/chimp128/chimp_decompressor.h"
+#include "baselines/chimp128/chimp_compressor_32.h"
+#include "baselines/chimp128/chimp_decompressor_32.h"
+#include "baselines/gorilla/gorilla_compressor.h"
+#include "baselines/gorilla/gorilla_decompressor.h"
+#include "baselines/fpc/fpc_compressor.h"
+#include "baselines/fpc/fpc_decompressor.h"
+#include "baselines/lz4/lz4_compressor.h"
+#include "baselines/lz4/lz4_decompressor.h"
+#include "baselines/deflate/deflate_compressor.h"
+#include "baselines/deflate/deflate_decompressor.h"
+#include "utils/perf_counters.h"
+
+/*
+ * Compress and decompress throughput and ratio of every compressor over every data set, and of the lossy ones over
+ * the whole kMaxDiffList sweep. The 32-bit variants run only on kDataSetList32 at kMaxDiff32, the data sets and
+ * bound float can meet, as in the correctness tests. Each benchmark iteration processes a whole data set in blocks
+ * of kBlockSizeOverall (one packet per value for the Net variants), exactly as the correctness tests do, and
+ * reports:
+ *   bytes_per_second  - MB/s of uncompressed input
+ *   items_per_second  - values/s
+ *   ns/value          - average time spent on one value
+ *   ratio             - compressed size / uncompressed size
+ */
+
+/**
+ * @brief Load a data set once and cache it, so that timed loops never touch the disk
+ * @param data_set File name of the data set in kDataSetDirPrefix
+ * @return All values of the data set, empty if it cannot be opened
+ */
+static const std::vector<double> &LoadDataSet(const std::string &data_set) {
+  static std::unordered_map<std::string, std::vector<double>> cache;
+  auto it = cache.find(data_set);
+  if (it == cache.end()) {
+    it = cache.emplace(data_set, ReadDataSet(kDataSetDirPrefix + data_set)).first;
+  }
+  return it->second;
+}
+
+static void ReportCounters(benchmark::State &state, int64_t values, int value_bits, long compressed_bits) {
+  int64_t processed = static_cast<int64_t>(state.iterations()) * values;
+  state.SetItemsProcessed(processed);
+  state.SetBytesProcessed(processed * value_bits / 8);
+  // A rate of "values * 1e-9 per second" inverted is exactly ns per value
+  state.counters["ns/value"] = benchmark::Counter(static_cast<double>(processed) * 1e-9,
+                                                  benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  state.counters["ratio"] = static_cast<double>(compressed_bits) / (static_cast<double>(values) * value_bits);
+}
+
+/**
+ * @brief Time compress_fn over the largest prefix of a data set made of whole blocks
+ * @param compress_fn Callable (data, values) -> compressed size in bits
+ */
+template<typename CompressFn>
+static void BM_Compress(benchmark::State &state, const std::string &data_set, int value_bits,
+                        CompressFn compress_fn) {
+  const std::vector<double> &data = LoadDataSet(data_set);
+  int64_t values = static_cast<int64_t>(data.size()) / kBlockSizeOverall * kBlockSizeOverall;
+  if (values == 0) {
+    state.SkipWithError(("Failed to open the file [" + data_set + "]").c_str());
+    return;
+  }
+  long compressed_bits = 0;
+  for (auto _ : state) {
+    // Only the const overload of DoNotOptimize, GCC may clobber the value through the "+m,r" one
+    const long bits = compress_fn(data, values);
+    benchmark::DoNotOptimize(bits);
+    compressed_bits = bits;
+  }
+  ReportCounters(state, values, value_bits, compressed_bits);
+}
+
+/**
+ * @brief Compress a data set once, then time decompress_fn over the resulting blocks
+ * @tparam Block Compressed block type of the compressor, the baselines each have their own
+ * @param prepare_fn Callable (data, values, out_blocks) -> compressed size in bits
+ * @param decompress_fn Callable (blocks) -> number of decompressed values
+ */
+template<typename Block = Array<uint8_t>, typename PrepareFn, typename DecompressFn>
+static void BM_Decompress(benchmark::State &state, const std::string &data_set, int value_bits,
+                          PrepareFn prepare_fn, DecompressFn decompress_fn) {
+  const std::vector<double> &data = LoadDataSet(data_set);
+  int64_t values = static_cast<int64_t>(data.size()) / kBlockSizeOverall * kBlockSizeOverall;
+  if (values == 0) {
+    state.SkipWithError(("Failed to open the file [" + data_set + "]").c_str());
+    return;
+  }
+  std::vector<Block> blocks;
+  long compressed_bits = prepare_fn(data, values, blocks);
+  for (auto _ : state) {
+    int64_t decompressed = decompress_fn(blocks);
+    benchmark::DoNotOptimize(decompressed);
+  }
+  ReportCounters(state, values, value_bits, compressed_bits);
+}
+
+static long CompressSerfXOR(const std::vector<double> &data, int64_t values, double max_diff, int adjust_digit,
+                            std::vector<Array<uint8_t>> *out_blocks) {
+  SerfXORCompressor compressor(kWindowSizeOverall, max_diff, adjust_digit);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    for (int j = 0; j < kBlockSizeOverall; ++j) {
+      compressor.AddValue(data[i + j]);
+    }
+    compressor.Close();
+    compressed_bits += compressor.compressed_size_last_block();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.compressed_bytes_last_block());
+  }
+  return compressed_bits;
+}
+
+static long CompressSerfQt(const std::vector<double> &data, int64_t values, double max_diff,
+                           std::vector<Array<uint8_t>> *out_blocks) {
+  SerfQtCompressor compressor(kBlockSizeOverall, max_diff);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    for (int j = 0; j < kBlockSizeOverall; ++j) {
+      compressor.AddValue(data[i + j]);
+    }
+    compressor.Close();
+    compressed_bits += compressor.get_compressed_size_in_bits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.compressed_bytes());
+  }
+  return compressed_bits;
+}
+
+static long CompressSerfXOR32(const std::vector<double> &data, int64_t values, float max_diff,
+                              std::vector<Array<uint8_t>> *out_blocks) {
+  SerfXORCompressor32 compressor(kWindowSizeOverall, max_diff);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    for (int j = 0; j < kBlockSizeOverall; ++j) {
+      compressor.AddValue(static_cast<float>(data[i + j]));
+    }
+    compressor.Close();
+    compressed_bits += compressor.compressed_size_last_block();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.compressed_bytes_last_block());
+  }
+  return compressed_bits;
+}
+
+static long CompressSerfQt32(const std::vector<double> &data, int64_t values, float max_diff,
+                             std::vector<Array<uint8_t>> *out_blocks) {
+  SerfQtCompressor32 compressor(kBlockSizeOverall, max_diff);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    for (int j = 0; j < kBlockSizeOverall; ++j) {
+      compressor.AddValue(static_cast<float>(data[i + j]));
+    }
+    compressor.Close();
+    compressed_bits += compressor.stored_compressed_size_in_bits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.compressed_bytes());
+  }
+  return compressed_bits;
+}
+
+// Net variants send one packet per value, each packet is kept as a block
+static long CompressNetSerfXOR(const std::vector<double> &data, int64_t values, double max_diff, int adjust_digit,
+                               std::vector<Array<uint8_t>> *out_packets) {
+  NetSerfXORCompressor compressor(kWindowSizeOverall, max_diff, adjust_digit);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; ++i) {
+    Array<uint8_t> packet = compressor.Compress(data[i]);
+    compressed_bits += packet.length() * 8;
+    if (out_packets != nullptr) out_packets->emplace_back(packet);
+  }
+  return compressed_bits;
+}
+
+static long CompressNetSerfQt(const std::vector<double> &data, int64_t values, double max_diff,
+                              std::vector<Array<uint8_t>> *out_packets) {
+  NetSerfQtCompressor compressor(max_diff);
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; ++i) {
+    Array<uint8_t> packet = compressor.Compress(data[i]);
+    compressed_bits += packet.length() * 8;
+    if (out_packets != nullptr) out_packets->emplace_back(packet);
+  }
+  return compressed_bits;
+}
+
+static long CompressChimp128(const std::vector<double> &data, int64_t values,
+                             std::vector<Array<uint8_t>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    ChimpCompressor compressor(128);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(data[i + j]);
+    compressor.close();
+    compressed_bits += compressor.get_size();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.get_compress_pack());
+  }
+  return compressed_bits;
+}
+
+static long CompressChimp128_32(const std::vector<double> &data, int64_t values,
+                                std::vector<Array<uint8_t>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    ChimpCompressor32 compressor(128);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(static_cast<float>(data[i + j]));
+    compressor.close();
+    compressed_bits += compressor.get_size();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.get_compress_pack());
+  }
+  return compressed_bits;
+}
+
+static long CompressGorilla(const std::vector<double> &data, int64_t values,
+                            std::vector<Array<uint8_t>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    GorillaCompressor compressor(kBlockSizeOverall);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(data[i + j]);
+    compressor.close();
+    compressed_bits += compressor.get_compress_size_in_bits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.get_compress_pack());
+  }
+  return compressed_bits;
+}
+
+static long CompressFPC(const std::vector<double> &data, int64_t values, std::vector<std::vector<char>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    FpcCompressor compressor(5, kBlockSizeOverall);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(data[i + j]);
+    compressor.close();
+    compressed_bits += compressor.getCompressedSizeInBits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.getBytes());
+  }
+  return compressed_bits;
+}
+
+static long CompressLZ4(const std::vector<double> &data, int64_t values, std::vector<Array<char>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    LZ4Compressor compressor(kBlockSizeOverall);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(data[i + j]);
+    compressor.close();
+    compressed_bits += compressor.getCompressedSizeInBits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.getBytes());
+  }
+  return compressed_bits;
+}
+
+static long CompressDeflate(const std::vector<double> &data, int64_t values,
+                            std::vector<Array<unsigned char>> *out_blocks) {
+  long compressed_bits = 0;
+  for (int64_t i = 0; i < values; i += kBlockSizeOverall) {
+    DeflateCompressor compressor(kBlockSizeOverall);
+    for (int j = 0; j < kBlockSizeOverall; ++j) compressor.addValue(data[i + j]);
+    compressor.close();
+    compressed_bits += compressor.getCompressedSizeInBits();
+    if (out_blocks != nullptr) out_blocks->emplace_back(compressor.getBytes());
+  }
+  return compressed_bits;
+}
+
+static std::string BenchmarkName(const char *algorithm, const char *direction, const std::string &data_set,
+                                 double max_diff) {
+  char max_diff_str[16];
+  std::snprintf(max_diff_str, sizeof(max_diff_str), "%.0e", max_diff);
+  return std::string(algorithm) + "/" + direction + "/" + data_set + "/" + max_diff_str;
+}
+
+static std::string BenchmarkName(const char *algorithm, const char *direction, const std::string &data_set) {
+  return std::string(algorithm) + "/" + direction + "/" + data_set;
+}
+
+static void RegisterLossyBenchmarks(const std::string &data_set) {
+  int adjust_digit = kFileNameToAdjustDigit.find(data_set)->second;
+  for (const auto &max_diff : kMaxDiffList) {
+    benchmark::RegisterBenchmark(BenchmarkName("SerfXOR", "compress", data_set, max_diff).c_str(),
+                                 [=](benchmark::State &state) {
+                                   BM_Compress(state, data_set, 64,
+                                               [=](const std::vector<double> &data, int64_t values) {
+                                                 return CompressSerfXOR(data, values, max_diff, adjust_digit,
+                                                                        nullptr);
+                                               });
+                                 });
+    benchmark::RegisterBenchmark(
+        BenchmarkName("SerfXOR", "decompress", data_set, max_diff).c_str(),
+        [=](benchmark::State &state) {
+          BM_Decompress(state, data_set, 64,
+                        [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                          return CompressSerfXOR(data, values, max_diff, adjust_digit, &blocks);
+                        },
+                        [=](const std::vector<Array<uint8_t>> &blocks) {
+                          SerfXORDecompressor decompressor(adjust_digit);
+                          int64_t count = 0;
+                          for (const auto &block : blocks) count += decompressor.Decompress(block).size();
+                          return count;
+                        });
+        });
+
+    benchmark::RegisterBenchmark(BenchmarkName("SerfQt", "compress", data_set, max_diff).c_str(),
+                                 [=](benchmark::State &state) {
+                                   BM_Compress(state, data_set, 64,
+                                               [=](const std::vector<double> &data, int64_t values) {
+                                                 return CompressSerfQt(data, values, max_diff, nullptr);
+                                               });
+                                 });
+    benchmark::RegisterBenchmark(
+        BenchmarkName("SerfQt", "decompress", data_set, max_diff).c_str(),
+        [=](benchmark::State &state) {
+          BM_Decompress(state, data_set, 64,
+                        [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                          return CompressSerfQt(data, values, max_diff, &blocks);
+                        },
+                        [](const std::vector<Array<uint8_t>> &blocks) {
+                          SerfQtDecompressor decompressor;
+                          int64_t count = 0;
+                          for (const auto &block : blocks) count += decompressor.Decompress(block).length();
+                          return count;
+                        });
+        });
+
+    benchmark::RegisterBenchmark(BenchmarkName("NetSerfXOR", "compress", data_set, max_diff).c_str(),
+                                 [=](benchmark::State &state) {
+                                   BM_Compress(state, data_set, 64,
+                                               [=](const std::vector<double> &data, int64_t values) {
+                                                 return CompressNetSerfXOR(data, values, max_diff, adjust_digit,
+                                                                           nullptr);
+                                               });
+                                 });
+    benchmark::RegisterBenchmark(
+        BenchmarkName("NetSerfXOR", "decompress", data_set, max_diff).c_str(),
+        [=](benchmark::State &state) {
+          BM_Decompress(state, data_set, 64,
+                        [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &packets) {
+                          return CompressNetSerfXOR(data, values, max_diff, adjust_digit, &packets);
+                        },
+                        [=](std::vector<Array<uint8_t>> &packets) {
+                          NetSerfXORDecompressor decompressor(kWindowSizeOverall, adjust_digit);
+                          double sum = 0;
+                          for (auto &packet : packets) sum += decompressor.Decompress(packet);
+                          benchmark::DoNotOptimize(sum);
+                          return static_cast<int64_t>(packets.size());
+                        });
+        });
+
+    benchmark::RegisterBenchmark(BenchmarkName("NetSerfQt", "compress", data_set, max_diff).c_str(),
+                                 [=](benchmark::State &state) {
+                                   BM_Compress(state, data_set, 64,
+                                               [=](const std::vector<double> &data, int64_t values) {
+                                                 return CompressNetSerfQt(data, values, max_diff, nullptr);
+                                               });
+                                 });
+    benchmark::RegisterBenchmark(
+        BenchmarkName("NetSerfQt", "decompress", data_set, max_diff).c_str(),
+        [=](benchmark::State &state) {
+          BM_Decompress(state, data_set, 64,
+                        [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &packets) {
+                          return CompressNetSerfQt(data, values, max_diff, &packets);
+                        },
+                        [=](std::vector<Array<uint8_t>> &packets) {
+                          NetSerfQtDecompressor decompressor(max_diff);
+                          double sum = 0;
+                          for (auto &packet : packets) sum += decompressor.Decompress(packet);
+                          benchmark::DoNotOptimize(sum);
+                          return static_cast<int64_t>(packets.size());
+                        });
+        });
+  }
+}
+
+/**
+ * @brief 32-bit variants on the data sets whose precision float can represent, at kMaxDiff32
+ */
+static void RegisterFloatBenchmarks(const std::string &data_set) {
+  const float max_diff = kMaxDiff32;
+  benchmark::RegisterBenchmark(BenchmarkName("SerfXOR32", "compress", data_set, max_diff).c_str(),
+                               [=](benchmark::State &state) {
+                                 BM_Compress(state, data_set, 32,
+                                             [=](const std::vector<double> &data, int64_t values) {
+                                               return CompressSerfXOR32(data, values, max_diff, nullptr);
+                                             });
+                               });
+  benchmark::RegisterBenchmark(
+      BenchmarkName("SerfXOR32", "decompress", data_set, max_diff).c_str(),
+      [=](benchmark::State &state) {
+        BM_Decompress(state, data_set, 32,
+                      [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                        return CompressSerfXOR32(data, values, max_diff, &blocks);
+                      },
+                      [](const std::vector<Array<uint8_t>> &blocks) {
+                        SerfXORDecompressor32 decompressor;
+                        int64_t count = 0;
+                        for (const auto &block : blocks) count += decompressor.Decompress(block).size();
+                        return count;
+                      });
+      });
+
+  benchmark::RegisterBenchmark(BenchmarkName("SerfQt32", "compress", data_set, max_diff).c_str(),
+                               [=](benchmark::State &state) {
+                                 BM_Compress(state, data_set, 32,
+                                             [=](const std::vector<double> &data, int64_t values) {
+                                               return CompressSerfQt32(data, values, max_diff, nullptr);
+                                             });
+                               });
+  benchmark::RegisterBenchmark(
+      BenchmarkName("SerfQt32", "decompress", data_set, max_diff).c_str(),
+      [=](benchmark::State &state) {
+        BM_Decompress(state, data_set, 32,
+                      [=](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                        return CompressSerfQt32(data, values, max_diff, &blocks);
+                      },
+                      [](const std::vector<Array<uint8_t>> &blocks) {
+                        SerfQtDecompressor32 decompressor;
+                        int64_t count = 0;
+                        for (const auto &block : blocks) count += decompressor.Decompress(block).size();
+                        return count;
+                      });
+      });
+
+  benchmark::RegisterBenchmark(BenchmarkName("Chimp128_32", "compress", data_set).c_str(),
+                               [=](benchmark::State &state) {
+                                 BM_Compress(state, data_set, 32, [](const std::vector<double> &data, int64_t values) {
+                                   return CompressChimp128_32(data, values, nullptr);
+                                 });
+                               });
+  benchmark::RegisterBenchmark(
+      BenchmarkName("Chimp128_32", "decompress", data_set).c_str(),
+      [=](benchmark::State &state) {
+        BM_Decompress(state, data_set, 32,
+                      [](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                        return CompressChimp128_32(data, values, &blocks);
+                      },
+                      [](const std::vector<Array<uint8_t>> &blocks) {
+                        int64_t count = 0;
+                        for (const auto &block : blocks) count += ChimpDecompressor32(block, 128).decompress().size();
+                        return count;
+                      });
+      });
+}
+
+/**
+ * @brief Lossless baselines do not depend on max_diff, so they are registered once per data set
+ */
+static void RegisterLosslessBenchmarks(const std::string &data_set) {
+  benchmark::RegisterBenchmark(BenchmarkName("Chimp128", "compress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Compress(state, data_set, 64, [](const std::vector<double> &data, int64_t values) {
+      return CompressChimp128(data, values, nullptr);
+    });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("Chimp128", "decompress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Decompress(state, data_set, 64,
+                  [](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                    return CompressChimp128(data, values, &blocks);
+                  },
+                  [](const std::vector<Array<uint8_t>> &blocks) {
+                    int64_t count = 0;
+                    for (const auto &block : blocks) count += ChimpDecompressor(block, 128).decompress().size();
+                    return count;
+                  });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("Gorilla", "compress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Compress(state, data_set, 64, [](const std::vector<double> &data, int64_t values) {
+      return CompressGorilla(data, values, nullptr);
+    });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("Gorilla", "decompress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Decompress(state, data_set, 64,
+                  [](const std::vector<double> &data, int64_t values, std::vector<Array<uint8_t>> &blocks) {
+                    return CompressGorilla(data, values, &blocks);
+                  },
+                  [](const std::vector<Array<uint8_t>> &blocks) {
+                    int64_t count = 0;
+                    for (const auto &block : blocks) count += GorillaDecompressor().decompress(block).size();
+                    return count;
+                  });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("FPC", "compress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Compress(state, data_set, 64, [](const std::vector<double> &data, int64_t values) {
+      return CompressFPC(data, values, nullptr);
+    });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("FPC", "decompress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Decompress<std::vector<char>>(
+        state, data_set, 64,
+        [](const std::vector<double> &data, int64_t values, std::vector<std::vector<char>> &blocks) {
+          return CompressFPC(data, values, &blocks);
+        },
+        [](std::vector<std::vector<char>> &blocks) {
+          int64_t count = 0;
+          for (auto &block : blocks) {
+            // Predictor tables carry over in a decompressor, every block starts from a fresh one
+            FpcDecompressor decompressor(5, kBlockSizeOverall);
+            decompressor.setBytes(block.data(), block.size());
+            count += decompressor.decompress().size();
+          }
+          return count;
+        });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("LZ4", "compress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Compress(state, data_set, 64, [](const std::vector<double> &data, int64_t values) {
+      return CompressLZ4(data, values, nullptr);
+    });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("LZ4", "decompress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Decompress<Array<char>>(
+        state, data_set, 64,
+        [](const std::vector<double> &data, int64_t values, std::vector<Array<char>> &blocks) {
+          return CompressLZ4(data, values, &blocks);
+        },
+        [](const std::vector<Array<char>> &blocks) {
+          int64_t count = 0;
+          for (const auto &block : blocks) count += LZ4Decompressor().decompress(block).size();
+          return count;
+        });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("Deflate", "compress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Compress(state, data_set, 64, [](const std::vector<double> &data, int64_t values) {
+      return CompressDeflate(data, values, nullptr);
+    });
+  });
+  benchmark::RegisterBenchmark(BenchmarkName("Deflate", "decompress", data_set).c_str(), [=](benchmark::State &state) {
+    BM_Decompress<Array<unsigned char>>(
+        state, data_set, 64,
+        [](const std::vector<double> &data, int64_t values, std::vector<Array<unsigned char>> &blocks) {
+          return CompressDeflate(data, values, &blocks);
+        },
+        [](const std::vector<Array<unsigned char>> &blocks) {
+          int64_t count = 0;
+          for (const auto &block : blocks) count += DeflateDecompressor().decompress(block).size();
+          return count;
+        });
+  });
+}
+
+int main(int argc, char **argv) {
+  for (const auto &data_set : kDataSetList) {
+    RegisterLossyBenchmarks(data_set);
+    RegisterLosslessBenchmarks(data_set);
+  }
+  for (const auto &data_set : kDataSetList32) {
+    RegisterFloatBenchmarks(data_set);
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+#ifdef SERF_ENABLE_PERF_COUNTERS
+  // Hardware counters of all runs are attributed to the instrumented regions and printed at the end
+  bool perf_counters_opened = PerfCounters::Open();
+  if (!perf_counters_opened) {
+    std::fprintf(stderr, "perf_event_open failed, hardware counters are disabled\n");
+  }
+#endif
+  benchmark::RunSpecifiedBenchmarks();
+#ifdef SERF_ENABLE_PERF_COUNTERS
+  if (perf_counters_opened) {
+    PerfCounters::Report(stdout);
+    PerfCounters::Close();
+  }
+#endif
+  benchmark::Shutdown();
+  return 0;
+}
@@ -8,6 +8,8 @@
 #include "../../src/decompressor/serf_qt_decompressor.h"
 #include "../../src/compressor/net_serf_qt_compressor.h"
 #include "../../src/decompressor/net_serf_qt_decompressor.h"
+#include "../../src/compressor/serf_trajectory_compressor.h"
+#include "../../src/decompressor/serf_trajectory_decompressor.h"
 #include "../../src/utils/file_reader.h"
 
 // 调试输出宏
@@ -373,6 +375,61 @@ void test_net_serf_qt_streaming(void) {
     }
 }
 
+// 测试SERF轨迹压缩算法 - 经纬度共用一个header和一个位流
+void test_serf_trajectory_compression(void) {
+    printf("\n=== SERF trajectory compress test ===\n");
+    
+    if (test_data_count == 0) {
+        printf("error: no data\n");
+        return;
+    }
+    
+    uint32_t compressed_bits;
+    uint16_t decomp_count = 0;
+    uint16_t error_count = 0;
+    float max_lat_error = 0.0f;
+    float max_lon_error = 0.0f;
+    {
+        SerfTrajectoryCompressor compressor(test_data_count, MAX_DIFF_LATITUDE, MAX_DIFF_LONGITUDE);
+        for (uint16_t i = 0; i < test_data_count; i++) {
+            compressor.AddPoint(test_data[i]);
+        }
+        compressor.Close();
+        compressed_bits = compressor.get_compressed_size_in_bits();
+        
+        SerfTrajectoryDecompressor decompressor;
+        Array<trajectory_point_t> decompressed(test_data_count);
+        if (decompressed.is_valid() &&
+            decompressor.DecompressTo(compressor.compressed_bytes(), decompressed, compressed_bits)) {
+            decomp_count = decompressor.number_of_points();
+        }
+        
+        for (uint16_t i = 0; i < decomp_count; i++) {
+            float lat_error = fabsf(test_data[i].latitude - decompressed[i].latitude);
+            float lon_error = fabsf(test_data[i].longitude - decompressed[i].longitude);
+            if (lat_error > MAX_DIFF_LATITUDE || lon_error > MAX_DIFF_LONGITUDE) {
+                error_count++;
+            }
+            if (lat_error > max_lat_error) max_lat_error = lat_error;
+            if (lon_error > max_lon_error) max_lon_error = lon_error;
+        }
+    }
+    
+    uint32_t original_size_bytes = test_data_count * sizeof(float) * 2;
+    printf("original_size: %lu bytes\n", (unsigned long)original_size_bytes);
+    printf("compressed_bits: %lu\n", (unsigned long)compressed_bits);
+    printf("compression_ratio: %.2f%%\n", (float)compressed_bits / 8.0f / (float)original_size_bytes * 100.0f);
+    printf("error_count: %u / %u\n", error_count, test_data_count);
+    printf("max_lat_error: %.6f (limit: %.6f)\n", max_lat_error, MAX_DIFF_LATITUDE);
+    printf("max_lon_error: %.6f (limit: %.6f)\n", max_lon_error, MAX_DIFF_LONGITUDE);
+    
+    if (decomp_count == test_data_count && error_count == 0) {
+        printf("=== Trajectory test SUCCESS! ===\n");
+    } else {
+        printf("??? Trajectory test FAILED!\n");
+    }
+}
+
 // 主测试函数
 int main(void) {
     printf("=== IAR EW8051 Trajectory Compression Test ===\n");
@@ -385,6 +442,7 @@ int main(void) {
     
     // 运行流式测试（更适合嵌入式平台）
     test_net_serf_qt_streaming();
+    test_serf_trajectory_compression();
     
     printf("\n=== test finish ===\n");
     return 0;
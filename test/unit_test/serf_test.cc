@@ -1,20 +1,33 @@
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <random>
+#include <thread>
+
 #include "Perf_expr_config.hpp"
 #include "Perf_file_utils.hpp"
 
 #include "compressor/serf_xor_compressor.h"
+#include "compressor/serf_xor_batch_compressor.h"
 #include "decompressor/serf_xor_decompressor.h"
 #include "compressor/serf_qt_compressor.h"
+#include "compressor/serf_qt_fixed_compressor.h"
 #include "decompressor/serf_qt_decompressor.h"
+#include "compressor/serf_trajectory_compressor.h"
+#include "decompressor/serf_trajectory_decompressor.h"
 #include "compressor_32/serf_xor_compressor_32.h"
 #include "decompressor_32/serf_xor_decompressor_32.h"
 #include "compressor/net_serf_xor_compressor.h"
 #include "decompressor/net_serf_xor_decompressor.h"
 #include "compressor/net_serf_qt_compressor.h"
 #include "decompressor/net_serf_qt_decompressor.h"
+#include "compressor/net_serf_qt_multiplexer.h"
+#include "decompressor/net_serf_qt_demultiplexer.h"
+#include "compressor/net_serf_xor_multiplexer.h"
+#include "decompressor/net_serf_xor_demultiplexer.h"
 #include "compressor_32/serf_qt_compressor_32.h"
 #include "decompressor_32/serf_qt_decompressor_32.h"
+#include "utils/spsc_ring_buffer.h"
 
 TEST(Correctness, SerfXOR) {
   for (const auto &data_set : kDataSetList) {
@@ -49,14 +62,334 @@ TEST(Correctness, SerfXOR) {
   }
 }
 
-TEST(Correctness, SerfQt) {
+TEST(Correctness, SerfXORBlockCount) {
+  // the value count in the block header, not a sentinel, ends each block, so any block length decodes exactly
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  int adjust_digit = kFileNameToAdjustDigit.find(kDataSetList[0])->second;
+  SerfXORCompressor xor_compressor(1000, kMaxDiffList[0], adjust_digit);
+  SerfXORDecompressor xor_decompressor(adjust_digit);
+
+  size_t offset = 0;
+  for (size_t block_size : {0, 1, 7, 0, 50, 3, 1000, 2}) {
+    for (size_t i = 0; i < block_size; ++i) {
+      xor_compressor.AddValue(data[(offset + i) % data.size()]);
+    }
+    xor_compressor.Close();
+    Array<uint8_t> result = xor_compressor.compressed_bytes_last_block();
+    std::vector<double> decompressed = xor_decompressor.Decompress(result);
+    ASSERT_EQ(block_size, decompressed.size());
+    for (size_t i = 0; i < block_size; ++i) {
+      ASSERT_NEAR(data[(offset + i) % data.size()], decompressed[i], kMaxDiffList[0]);
+    }
+    offset += block_size;
+  }
+
+  // the bit stream is sized by the window, not the 65535-value block limit: once the longest encoding of another
+  // value would not fit, AddValue() refuses it and the caller starts a new block, so no block is ever cut short
+  std::mt19937 random_engine(5);
+  std::uniform_real_distribution<double> uniform(0, 1000);
+  std::vector<double> random_data(5000);
+  for (auto &datum : random_data) {
+    datum = uniform(random_engine);
+  }
+  const double small_max_diff = 1.0E-6;
+  for (bool online_adjust_digit : {false, true}) {
+    std::unique_ptr<SerfXORCompressor> compressor = online_adjust_digit ?
+        std::make_unique<SerfXORCompressor>(1000, small_max_diff) :
+        std::make_unique<SerfXORCompressor>(1000, small_max_diff, 0);
+    std::unique_ptr<SerfXORDecompressor> decompressor = online_adjust_digit ?
+        std::make_unique<SerfXORDecompressor>() : std::make_unique<SerfXORDecompressor>(0);
+    std::vector<double> decompressed;
+    size_t blocks = 0;
+    for (size_t i = 0; i <= random_data.size(); ++i) {
+      if (i < random_data.size() && compressor->AddValue(random_data[i])) {
+        continue;
+      }
+      ASSERT_TRUE(compressor->Close()) << online_adjust_digit << " " << i;
+      std::vector<double> block = decompressor->Decompress(compressor->compressed_bytes_last_block());
+      ASSERT_FALSE(block.empty()) << online_adjust_digit << " " << i;
+      decompressed.insert(decompressed.end(), block.begin(), block.end());
+      ++blocks;
+      if (i < random_data.size()) {
+        ASSERT_TRUE(compressor->AddValue(random_data[i])) << online_adjust_digit << " " << i;
+      }
+    }
+    EXPECT_LT(1u, blocks) << online_adjust_digit;
+    ASSERT_EQ(random_data.size(), decompressed.size()) << online_adjust_digit;
+    for (size_t i = 0; i < random_data.size(); ++i) {
+      ASSERT_NEAR(random_data[i], decompressed[i], small_max_diff) << online_adjust_digit << " " << i;
+    }
+  }
+
+  // the 16-bit count caps a block at 65535 values; further values are refused instead of wrapping the count.
+  // A window of 70000 gives the bit stream room for 65535 values at their longest encoding
+  for (bool online_adjust_digit : {false, true}) {
+    std::unique_ptr<SerfXORCompressor> full_compressor = online_adjust_digit ?
+        std::make_unique<SerfXORCompressor>(70000, kMaxDiffList[0]) :
+        std::make_unique<SerfXORCompressor>(70000, kMaxDiffList[0], adjust_digit);
+    for (size_t i = 0; i < OutputBitStream::kMaxBlockValues; ++i) {
+      ASSERT_TRUE(full_compressor->AddValue(data[i % data.size()]));
+    }
+    ASSERT_FALSE(full_compressor->AddValue(data[0]));
+    ASSERT_TRUE(full_compressor->Close());
+    std::unique_ptr<SerfXORDecompressor> full_decompressor = online_adjust_digit ?
+        std::make_unique<SerfXORDecompressor>() : std::make_unique<SerfXORDecompressor>(adjust_digit);
+    std::vector<double> decompressed = full_decompressor->Decompress(full_compressor->compressed_bytes_last_block());
+    ASSERT_EQ(OutputBitStream::kMaxBlockValues, decompressed.size());
+    for (size_t i = 0; i < decompressed.size(); ++i) {
+      ASSERT_NEAR(data[i % data.size()], decompressed[i], kMaxDiffList[0]) << online_adjust_digit << " " << i;
+    }
+  }
+}
+
+TEST(Correctness, SerfXOROnlineAdjustDigit) {
   for (const auto &data_set : kDataSetList) {
     std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
     if (!data_set_input_stream.is_open()) {
       std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
     }
 
+    int adjust_digit = kFileNameToAdjustDigit.find(data_set)->second;
+    for (const auto &max_diff : kMaxDiffList) {
+      SerfXORCompressor online_compressor(1000, max_diff);
+      SerfXORCompressor offline_compressor(1000, max_diff, adjust_digit);
+      SerfXORDecompressor xor_decompressor;
+      long online_size = 0;
+      long offline_size = 0;
+
+      std::vector<double> original_data;
+      while ((original_data = ReadBlock(data_set_input_stream, kBlockSizeOverall)).size() == kBlockSizeOverall) {
+        for (const auto &datum : original_data) {
+          online_compressor.AddValue(datum);
+          offline_compressor.AddValue(datum);
+        }
+        online_compressor.Close();
+        offline_compressor.Close();
+        online_size += online_compressor.compressed_size_last_block();
+        offline_size += offline_compressor.compressed_size_last_block();
+        std::vector<double> decompressed = xor_decompressor.Decompress(online_compressor.compressed_bytes());
+        ASSERT_EQ(original_data.size(), decompressed.size());
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          ASSERT_NEAR(original_data[i], decompressed[i], max_diff) << data_set << i;
+        }
+      }
+      // the digit learned from the running range stays close to the one computed offline from the whole data set
+      EXPECT_LE(online_size, offline_size * 1.1) << data_set << " " << max_diff;
+
+      ResetFileStream(data_set_input_stream);
+    }
+
+    data_set_input_stream.close();
+  }
+}
+
+TEST(Correctness, SerfXORAdaptiveWindow) {
+  // alternating calm and noisy bursts of 1500 values, the fixed window of 1000 keeps lagging behind them
+  std::mt19937 random_engine(7);
+  std::normal_distribution<double> calm(0, 0.01);
+  std::normal_distribution<double> noisy(0, 50);
+  std::vector<double> data;
+  double level = 100;
+  for (int burst = 0; burst < 40; ++burst) {
+    for (int i = 0; i < 1500; ++i) {
+      level += burst % 2 == 0 ? calm(random_engine) : noisy(random_engine);
+      data.push_back(level);
+    }
+  }
+
+  const double max_diff = 1.0E-3;
+  SerfXORCompressor fixed_compressor(1000, max_diff, 0);
+  SerfXORCompressor adaptive_compressor(1000, max_diff, 0);
+  adaptive_compressor.EnableAdaptiveWindow({500, 4000, 0.3});
+  SerfXORDecompressor xor_decompressor(0);
+  long fixed_size = 0;
+  long adaptive_size = 0;
+  for (size_t offset = 0; offset < data.size(); offset += kBlockSizeOverall) {
+    for (int i = 0; i < kBlockSizeOverall; ++i) {
+      fixed_compressor.AddValue(data[offset + i]);
+      adaptive_compressor.AddValue(data[offset + i]);
+    }
+    fixed_compressor.Close();
+    adaptive_compressor.Close();
+    fixed_size += fixed_compressor.compressed_size_last_block();
+    adaptive_size += adaptive_compressor.compressed_size_last_block();
+    std::vector<double> decompressed = xor_decompressor.Decompress(adaptive_compressor.compressed_bytes());
+    ASSERT_EQ(kBlockSizeOverall, decompressed.size());
+    for (int i = 0; i < kBlockSizeOverall; ++i) {
+      ASSERT_NEAR(data[offset + i], decompressed[i], max_diff) << offset + i;
+    }
+  }
+  EXPECT_LT(adaptive_size, fixed_size);
+}
+
+TEST(Correctness, SerfXORBatch) {
+  // every series of the batch produces the same blocks as its own SerfXORCompressor
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  int adjust_digit = kFileNameToAdjustDigit.find(kDataSetList[0])->second;
+  const uint32_t number_of_series = 40;
+  for (const auto &max_diff : kMaxDiffList) {
+    SerfXORBatchCompressor batch_compressor(number_of_series, kBlockSizeOverall, 1000, max_diff, adjust_digit);
+    std::vector<std::unique_ptr<SerfXORCompressor>> compressors;
+    for (uint32_t s = 0; s < number_of_series; ++s) {
+      compressors.push_back(std::make_unique<SerfXORCompressor>(1000, max_diff, adjust_digit));
+    }
+    SerfXORDecompressor xor_decompressor(adjust_digit);
+
+    std::vector<double> tick(number_of_series);
+    for (size_t block = 0; block < 100; ++block) {
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        for (uint32_t s = 0; s < number_of_series; ++s) {
+          // series s is the data set shifted by s * 397 values
+          tick[s] = data[(s * 397 + block * kBlockSizeOverall + i) % data.size()];
+          compressors[s]->AddValue(tick[s]);
+        }
+        ASSERT_TRUE(batch_compressor.AddValues(tick.data()));
+      }
+      // the block is full; the tick is refused rather than silently dropped
+      ASSERT_FALSE(batch_compressor.AddValues(tick.data()));
+      ASSERT_TRUE(batch_compressor.Close());
+      for (uint32_t s = 0; s < number_of_series; ++s) {
+        compressors[s]->Close();
+        const Array<uint8_t> &expected = compressors[s]->compressed_bytes();
+        const Array<uint8_t> &actual = batch_compressor.compressed_bytes(s);
+        ASSERT_EQ(compressors[s]->compressed_size_last_block(), batch_compressor.compressed_size_last_block(s));
+        ASSERT_EQ(expected.length(), actual.length()) << s << " " << block;
+        ASSERT_EQ(0, memcmp(expected.begin(), actual.begin(), expected.length())) << s << " " << block;
+      }
+      std::vector<double> decompressed = xor_decompressor.Decompress(batch_compressor.compressed_bytes(0));
+      ASSERT_EQ(kBlockSizeOverall, decompressed.size());
+    }
+    EXPECT_LE(batch_compressor.number_of_table_sets(), number_of_series);
+  }
+}
+
+TEST(Correctness, SerfXORStateSnapshot) {
+  // a compressor restored from a mid-block snapshot continues exactly where the uninterrupted one goes; in fixed
+  // mode the snapshot carries the open block's bits, in online mode its held-back values
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[1]);
+  int adjust_digit = kFileNameToAdjustDigit.find(kDataSetList[1])->second;
+  const double max_diff = 1.0E-3;
+  for (bool online : {false, true}) {
+    auto make_compressor = [&]() {
+      auto compressor = online ? std::make_unique<SerfXORCompressor>(1000, max_diff)
+                               : std::make_unique<SerfXORCompressor>(1000, max_diff, adjust_digit);
+      compressor->EnableAdaptiveWindow({500, 4000, 0.3});
+      return compressor;
+    };
+    auto reference_compressor = make_compressor();
+    auto restored_compressor = make_compressor();
+
+    for (size_t block = 0; (block + 1) * kBlockSizeOverall <= data.size(); ++block) {
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        double datum = data[block * kBlockSizeOverall + i];
+        reference_compressor->AddValue(datum);
+        restored_compressor->AddValue(datum);
+        if (block % 7 == 3 && i == 23) {
+          Array<uint8_t> snapshot = restored_compressor->SaveState();
+          ASSERT_TRUE(snapshot.is_valid());
+          restored_compressor = make_compressor();
+          ASSERT_TRUE(restored_compressor->LoadState(snapshot));
+          // a failed load leaves the compressor as it was, which the byte comparison below checks
+          for (int extra : {-1, 1}) {
+            Array<uint8_t> damaged(snapshot.length() + extra);
+            memcpy(damaged.begin(), snapshot.begin(), std::min(snapshot.length(), damaged.length()));
+            EXPECT_FALSE(restored_compressor->LoadState(damaged));
+          }
+        }
+      }
+      reference_compressor->Close();
+      restored_compressor->Close();
+      const Array<uint8_t> &expected = reference_compressor->compressed_bytes();
+      const Array<uint8_t> &actual = restored_compressor->compressed_bytes();
+      ASSERT_EQ(expected.length(), actual.length()) << online << " " << block;
+      ASSERT_EQ(0, memcmp(expected.begin(), actual.begin(), expected.length())) << online << " " << block;
+    }
+  }
+
+  SerfXORCompressor other_compressor(1000, max_diff * 2);
+  SerfXORCompressor compressor(1000, max_diff);
+  EXPECT_FALSE(other_compressor.LoadState(compressor.SaveState()));
+}
+
+#ifdef SERF_ENABLE_STATS
+// 仅在以-DSERF_ENABLE_STATS编译（包括src下的全部源文件）时运行
+TEST(Correctness, SerfXORStats) {
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    int adjust_digit = kFileNameToAdjustDigit.find(data_set)->second;
     for (const auto &max_diff : kMaxDiffList) {
+      SerfXORCompressor xor_compressor(kBlockSizeOverall, max_diff, adjust_digit);
+      NetSerfXORCompressor net_compressor(kBlockSizeOverall, max_diff, adjust_digit);
+      for (size_t i = 0; i < data.size(); ++i) {
+        ASSERT_TRUE(xor_compressor.AddValue(data[i]));
+        net_compressor.Compress(data[i]);
+        if ((i + 1) % kBlockSizeOverall == 0) {
+          ASSERT_TRUE(xor_compressor.Close());
+        }
+      }
+      ASSERT_TRUE(xor_compressor.Close());
+
+      // 每个值恰好属于一种case，且要么复用stored_val_要么调用一次FindAppLong
+      for (const serf_xor_stats_t *stats : {&xor_compressor.stats(), &net_compressor.stats()}) {
+        ASSERT_EQ(data.size(), stats->values) << data_set << " " << max_diff;
+        EXPECT_EQ(stats->values, stats->case_00 + stats->case_01 + stats->case_1) << data_set << " " << max_diff;
+        EXPECT_EQ(stats->values, stats->find_app_long_calls + stats->stored_val_reuses) << data_set << " " << max_diff;
+        uint64_t searches = 0;
+        for (uint64_t count : stats->search_depth_histogram) {
+          searches += count;
+        }
+        EXPECT_EQ(stats->find_app_long_calls, searches) << data_set << " " << max_diff;
+        EXPECT_LE(stats->find_app_long_fallbacks, stats->find_app_long_calls) << data_set << " " << max_diff;
+      }
+
+      xor_compressor.ResetStats();
+      EXPECT_EQ(0u, xor_compressor.stats().values);
+    }
+  }
+}
+#endif
+
+TEST(Correctness, SerfQtStateSnapshot) {
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  const float max_diff = 1.0E-2f;
+  for (SerfQtCoder coder : {kSerfQtCoderEliasGamma, kSerfQtCoderRans}) {
+    SerfQtCompressor reference_compressor(kBlockSizeOverall, max_diff, coder);
+    auto restored_compressor = std::make_unique<SerfQtCompressor>(kBlockSizeOverall, max_diff, coder);
+    for (size_t block = 0; block < 200; ++block) {
+      for (size_t i = 0; i < kBlockSizeOverall; ++i) {
+        float datum = (float) data[block * kBlockSizeOverall + i];
+        reference_compressor.AddValue(datum);
+        restored_compressor->AddValue(datum);
+        if (i == block % kBlockSizeOverall) {
+          Array<uint8_t> snapshot = restored_compressor->SaveState();
+          restored_compressor = std::make_unique<SerfQtCompressor>(kBlockSizeOverall, max_diff, coder);
+          ASSERT_TRUE(restored_compressor->LoadState(snapshot));
+          for (int extra : {-1, 1}) {
+            Array<uint8_t> damaged(snapshot.length() + extra);
+            memcpy(damaged.begin(), snapshot.begin(), std::min(snapshot.length(), damaged.length()));
+            EXPECT_FALSE(restored_compressor->LoadState(damaged));
+          }
+        }
+      }
+      reference_compressor.Close();
+      restored_compressor->Close();
+      const Array<uint8_t> &expected = reference_compressor.compressed_bytes();
+      const Array<uint8_t> &actual = restored_compressor->compressed_bytes();
+      ASSERT_EQ(expected.length(), actual.length()) << coder << " " << block;
+      ASSERT_EQ(0, memcmp(expected.begin(), actual.begin(), expected.length())) << coder << " " << block;
+    }
+  }
+}
+
+TEST(Correctness, SerfQt) {
+  for (const auto &data_set : kDataSetList) {
+    std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
+    if (!data_set_input_stream.is_open()) {
+      std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
+    }
+
+    // 值以float重建，更小的误差下max_diff * 0.001的余量小于部分数据集的float舍入误差，见SerfQtBlockMode
+    for (const double max_diff : {1.0E-1, 1.0E-2}) {
       std::vector<double> original_data;
       while ((original_data = ReadBlock(data_set_input_stream, kBlockSizeOverall)).size() == kBlockSizeOverall) {
         SerfQtCompressor qt_compressor(kBlockSizeOverall, max_diff);
@@ -66,8 +399,8 @@ TEST(Correctness, SerfQt) {
         }
         qt_compressor.Close();
         Array<uint8_t> result = qt_compressor.compressed_bytes();
-        std::vector<double> decompressed = qt_decompressor.Decompress(result);
-        ASSERT_EQ(original_data.size(), decompressed.size());
+        Array<float> decompressed = qt_decompressor.Decompress(result);
+        ASSERT_EQ(original_data.size(), decompressed.length());
         for (int i = 0; i < kBlockSizeOverall; ++i) {
           ASSERT_NEAR(original_data[i], decompressed[i], max_diff) << data_set << i;
         }
@@ -80,6 +413,590 @@ TEST(Correctness, SerfQt) {
   }
 }
 
+TEST(Correctness, EliasGammaCodec) {
+  // 6 = 0b110：两个0，最高位的1，再是低两位（LSB优先）0、1，即位流00101
+  OutputBitStream six_stream(8);
+  ASSERT_EQ(5, EliasGammaCodec::Encode(6, &six_stream));
+  Array<uint8_t> six = six_stream.GetBuffer(1);
+  ASSERT_EQ(0x14, six[0]);
+
+  // 偶数和奇数、2的幂及其两侧
+  std::vector<int32_t> numbers;
+  for (int32_t number = 1; number <= 64; ++number) {
+    numbers.push_back(number);
+  }
+  for (int shift = 7; shift < 31; ++shift) {
+    numbers.push_back((1 << shift) - 1);
+    numbers.push_back(1 << shift);
+    numbers.push_back((1 << shift) + 1);
+  }
+  OutputBitStream output_bit_stream(static_cast<uint32_t>(numbers.size()) * 8);
+  uint32_t bits = 0;
+  for (int32_t number : numbers) {
+    int length = EliasGammaCodec::Encode(number, &output_bit_stream);
+    ASSERT_EQ(EliasGammaCodec::Length(number), length) << number;
+    bits += length;
+  }
+  Array<uint8_t> bytes = output_bit_stream.GetBuffer((bits + 7) / 8);
+  InputBitStream input_bit_stream;
+  input_bit_stream.SetBuffer(bytes);
+  for (int32_t number : numbers) {
+    ASSERT_EQ(number, EliasGammaCodec::Decode(&input_bit_stream));
+  }
+}
+
+TEST(Correctness, OutputBitStreamOverflow) {
+  // 容量8字节（两个uint32_t）：写满后多余的位被丢弃并记录溢出，取出时截断到容量
+  OutputBitStream output_bit_stream(4);
+  for (int i = 0; i < 3; ++i) {
+    output_bit_stream.WriteInt(0xA5A5A5A5, 32);
+  }
+  EXPECT_TRUE(output_bit_stream.overflowed());
+  Array<uint8_t> bytes = output_bit_stream.GetBuffer(12);
+  ASSERT_EQ(8, bytes.length());
+  EXPECT_EQ(0xA5, bytes[7]);
+  uint8_t dest[16] = {0};
+  ASSERT_TRUE(output_bit_stream.CopyBufferTo(dest, sizeof(dest)));
+  EXPECT_EQ(0, dest[8]);
+
+  // 溢出标记随快照保存，恢复后的位流仍然报告溢出
+  StateWriter writer(16);
+  output_bit_stream.SaveState(&writer);
+  Array<uint8_t> snapshot = writer.Finish();
+  OutputBitStream restored(4);
+  StateReader reader(snapshot);
+  ASSERT_TRUE(restored.LoadState(&reader));
+  EXPECT_TRUE(restored.overflowed());
+
+  output_bit_stream.Refresh();
+  EXPECT_FALSE(output_bit_stream.overflowed());
+}
+
+TEST(Correctness, SerfQtRans) {
+  for (const auto &data_set : kDataSetList) {
+    std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
+    if (!data_set_input_stream.is_open()) {
+      std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
+    }
+
+    for (const auto &max_diff : kMaxDiffList) {
+      std::vector<double> original_data;
+      while ((original_data = ReadBlock(data_set_input_stream, kBlockSizeOverall)).size() == kBlockSizeOverall) {
+        // 熵编码只改变残差的表示，解压结果须与Elias Gamma逐位一致，且块不会更大
+        SerfQtCompressor gamma_compressor(kBlockSizeOverall, max_diff);
+        SerfQtCompressor rans_compressor(kBlockSizeOverall, max_diff, kSerfQtCoderRans);
+        SerfQtDecompressor qt_decompressor;
+        for (const auto &datum : original_data) {
+          gamma_compressor.AddValue(datum);
+          rans_compressor.AddValue(datum);
+        }
+        gamma_compressor.Close();
+        rans_compressor.Close();
+        ASSERT_LE(rans_compressor.get_compressed_size_in_bits(), gamma_compressor.get_compressed_size_in_bits());
+        Array<float> gamma_decompressed = qt_decompressor.Decompress(gamma_compressor.compressed_bytes());
+        Array<float> rans_decompressed = qt_decompressor.Decompress(rans_compressor.compressed_bytes());
+        ASSERT_EQ(original_data.size(), rans_decompressed.length());
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          ASSERT_EQ(gamma_decompressed[i], rans_decompressed[i]) << data_set << i;
+        }
+      }
+
+      ResetFileStream(data_set_input_stream);
+    }
+
+    data_set_input_stream.close();
+  }
+}
+
+TEST(Correctness, SerfQtBlockMode) {
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    // 值以float重建，更小的误差下max_diff * 0.001的余量小于部分数据集的float舍入误差
+    for (const double max_diff : {1.0E-1, 1.0E-2}) {
+      for (SerfQtCoder coder : {kSerfQtCoderEliasGamma, kSerfQtCoderRans, kSerfQtCoderPacked}) {
+        SerfQtCompressor value_compressor(kBlockSizeOverall, max_diff, coder);
+        SerfQtCompressor block_compressor(kBlockSizeOverall, max_diff, coder);
+        SerfQtDecompressor qt_decompressor;
+        long value_bits = 0;
+        long block_bits = 0;
+        std::vector<float> block(kBlockSizeOverall);
+        for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+          for (int i = 0; i < kBlockSizeOverall; ++i) {
+            block[i] = (float) data[offset + i];
+            value_compressor.AddValue(block[i]);
+          }
+          // 分两次加入，覆盖块中间调用的情况
+          block_compressor.AddValues(block.data(), 7);
+          block_compressor.AddValues(block.data() + 7, kBlockSizeOverall - 7);
+          value_compressor.Close();
+          block_compressor.Close();
+          value_bits += value_compressor.get_compressed_size_in_bits();
+          block_bits += block_compressor.get_compressed_size_in_bits();
+          Array<float> decompressed = qt_decompressor.Decompress(block_compressor.compressed_bytes());
+          ASSERT_EQ(kBlockSizeOverall, decompressed.length());
+          for (int i = 0; i < kBlockSizeOverall; ++i) {
+            ASSERT_NEAR(block[i], decompressed[i], max_diff) << data_set << offset + i;
+          }
+        }
+        // 只有恰好位于网格中点的值可能选到另一侧，大小几乎不变
+        EXPECT_LE(block_bits, value_bits * 1.01) << data_set << " " << max_diff;
+      }
+    }
+  }
+}
+
+TEST(Correctness, SerfQtBlockModeSmallBound) {
+  // 小误差下每个值的码长远超8051的平均估计，块模式不能写出位流缓冲区，整个block须完整取出；
+  // 此时float重建不保证误差，也可能与逐值模式选到不同的网格位置，只检查块的完整性
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    for (const double max_diff : {1.0E-4, 1.0E-6}) {
+      SerfQtCompressor block_compressor(kBlockSizeOverall, max_diff);
+      SerfQtDecompressor qt_decompressor;
+      std::vector<float> block(kBlockSizeOverall);
+      for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          block[i] = (float) data[offset + i];
+        }
+        block_compressor.AddValues(block.data(), kBlockSizeOverall);
+        block_compressor.Close();
+        uint32_t block_bytes = (block_compressor.get_compressed_size_in_bits() + 7) / 8;
+        ASSERT_EQ(block_bytes, block_compressor.compressed_bytes().length()) << data_set << " " << offset;
+        Array<float> decompressed = qt_decompressor.Decompress(block_compressor.compressed_bytes());
+        ASSERT_EQ(kBlockSizeOverall, decompressed.length()) << data_set << " " << offset;
+      }
+    }
+  }
+}
+
+TEST(Correctness, SerfQtLongBlock) {
+  // 长block（非8的倍数）覆盖解压端前缀和的跨组进位和尾部；缓慢的随机游走使rANS的块足够小
+  std::mt19937 random_engine(11);
+  std::normal_distribution<float> noise(0, 1.0E-4f);
+  const uint16_t block_size = 1003;
+  const float max_diff = 1.0E-3f;
+  std::vector<float> data(block_size);
+  float level = 1000;
+  for (auto &datum : data) {
+    level += 2.0E-3f + noise(random_engine);
+    datum = level;
+  }
+
+  SerfQtCompressor qt_compressor(block_size, max_diff, kSerfQtCoderRans);
+  SerfQtDecompressor qt_decompressor;
+  qt_compressor.AddValues(data.data(), block_size);
+  qt_compressor.Close();
+  Array<float> decompressed = qt_decompressor.Decompress(qt_compressor.compressed_bytes());
+  ASSERT_EQ(block_size, decompressed.length());
+  for (int i = 0; i < block_size; ++i) {
+    ASSERT_NEAR(data[i], decompressed[i], max_diff) << i;
+  }
+}
+
+TEST(Correctness, SerfQtOversizedBlock) {
+  // 快速的随机游走每个值十几位，60000个值的block超过64KB；宿主机上Array的长度为32位，整个block照常压缩
+  std::mt19937 random_engine(13);
+  std::normal_distribution<float> noise(0, 1.0f);
+  const uint16_t block_size = 60000;
+  const float max_diff = 1.0E-2f;
+  std::vector<float> data(block_size);
+  float level = 0;
+  for (auto &datum : data) {
+    level += noise(random_engine);
+    datum = level;
+  }
+
+  for (SerfQtCoder coder : {kSerfQtCoderEliasGamma, kSerfQtCoderRans}) {
+    SerfQtCompressor qt_compressor(block_size, max_diff, coder);
+    qt_compressor.AddValues(data.data(), block_size);
+    qt_compressor.Close();
+    EXPECT_LT(65535u, qt_compressor.compressed_bytes().length()) << coder;
+
+    SerfQtDecompressor qt_decompressor;
+    Array<float> decompressed = qt_decompressor.Decompress(qt_compressor.compressed_bytes());
+    ASSERT_EQ(block_size, decompressed.length()) << coder;
+    for (int i = 0; i < block_size; ++i) {
+      ASSERT_LE(std::abs(data[i] - decompressed[i]), max_diff) << coder << " " << i;
+    }
+  }
+}
+
+TEST(Correctness, SerfQtShortBlock) {
+  // len写实际的值个数：不满的block照常解压，block已满时AddValue()拒绝而不是丢弃
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  const uint16_t block_size = 100;
+  const float max_diff = 1.0E-2f;
+  for (SerfQtCoder coder : {kSerfQtCoderEliasGamma, kSerfQtCoderRans}) {
+    SerfQtCompressor qt_compressor(block_size, max_diff, coder);
+    for (int i = 0; i < 60; ++i) {
+      ASSERT_TRUE(qt_compressor.AddValue((float) data[i])) << coder;
+    }
+    ASSERT_TRUE(qt_compressor.Close()) << coder;
+    SerfQtDecompressor qt_decompressor;
+    Array<float> decompressed = qt_decompressor.Decompress(qt_compressor.compressed_bytes());
+    ASSERT_EQ(60u, decompressed.length()) << coder;
+    for (int i = 0; i < 60; ++i) {
+      ASSERT_NEAR((float) data[i], decompressed[i], max_diff) << coder << " " << i;
+    }
+
+    std::vector<float> block(data.begin(), data.begin() + block_size + 1);
+    EXPECT_EQ(block_size, qt_compressor.AddValues(block.data(), block_size + 1)) << coder;
+    EXPECT_FALSE(qt_compressor.AddValue(block[block_size])) << coder;
+    ASSERT_TRUE(qt_compressor.Close()) << coder;
+    decompressed = qt_decompressor.Decompress(qt_compressor.compressed_bytes());
+    ASSERT_EQ(block_size, decompressed.length()) << coder;
+    EXPECT_NEAR(block[block_size - 1], decompressed[block_size - 1], max_diff) << coder;
+  }
+}
+
+TEST(Correctness, SerfQtPacked) {
+  // 160个值跨2个mini-block（最后一个不满）；每隔40个值一次跳变再跳回，作为需要补高位的异常
+  std::mt19937 random_engine(17);
+  std::uniform_int_distribution<int> step(-3, 3);
+  const uint16_t block_size = 160;
+  const float max_diff = 1.0E-2f;
+  std::vector<float> data(block_size);
+  float level = 100;
+  for (int i = 0; i < block_size; ++i) {
+    level += 2 * max_diff * step(random_engine);
+    data[i] = (i % 40 == 25) ? level + 1000 * max_diff : level;
+  }
+
+  SerfQtCompressor gamma_compressor(block_size, max_diff, kSerfQtCoderEliasGamma);
+  SerfQtCompressor packed_compressor(block_size, max_diff, kSerfQtCoderPacked);
+  SerfQtDecompressor qt_decompressor;
+  gamma_compressor.AddValues(data.data(), block_size);
+  packed_compressor.AddValues(data.data(), block_size);
+  gamma_compressor.Close();
+  packed_compressor.Close();
+  EXPECT_LT(packed_compressor.get_compressed_size_in_bits(), gamma_compressor.get_compressed_size_in_bits());
+  Array<float> decompressed = qt_decompressor.Decompress(packed_compressor.compressed_bytes());
+  ASSERT_EQ(block_size, decompressed.length());
+  for (int i = 0; i < block_size; ++i) {
+    ASSERT_NEAR(data[i], decompressed[i], max_diff) << i;
+  }
+
+  // 全部相同的值：Elias Gamma每个值1位，更小，回退为gamma块
+  std::vector<float> constant(block_size, 42.0f);
+  SerfQtCompressor constant_compressor(block_size, max_diff, kSerfQtCoderPacked);
+  constant_compressor.AddValues(constant.data(), block_size);
+  constant_compressor.Close();
+  decompressed = qt_decompressor.Decompress(constant_compressor.compressed_bytes());
+  ASSERT_EQ(block_size, decompressed.length());
+  for (int i = 0; i < block_size; ++i) {
+    ASSERT_NEAR(constant[i], decompressed[i], max_diff) << i;
+  }
+}
+
+TEST(Correctness, SerfQtPredictor) {
+  // 匀速运动：相邻差分几乎不变，delta-of-delta的残差接近0；阻尼振荡：差分交替变号，由线性预测器覆盖
+  std::mt19937 random_engine(23);
+  std::normal_distribution<float> noise(0, 2.0E-3f);
+  const uint16_t block_size = 100;
+  const float max_diff = 1.0E-3f;
+  std::vector<float> constant_velocity(block_size);
+  std::vector<float> oscillation(block_size);
+  float velocity = 0.05f;
+  for (int i = 0; i < block_size; ++i) {
+    constant_velocity[i] = 116.0f + 0.013f * i + noise(random_engine);
+    oscillation[i] = 30.0f + velocity;
+    velocity *= -0.6f;
+    velocity += 0.05f * ((i % 7 == 0) ? 1 : 0);
+  }
+
+  for (const std::vector<float> *data : {&constant_velocity, &oscillation}) {
+    for (SerfQtCoder coder : {kSerfQtCoderEliasGamma, kSerfQtCoderRans, kSerfQtCoderPacked}) {
+      SerfQtCompressor plain_compressor(block_size, max_diff, coder);
+      SerfQtCompressor predicted_compressor(block_size, max_diff, coder, true);
+      SerfQtDecompressor qt_decompressor;
+      plain_compressor.AddValues(data->data(), block_size);
+      predicted_compressor.AddValues(data->data(), block_size);
+      plain_compressor.Close();
+      predicted_compressor.Close();
+      EXPECT_LT(predicted_compressor.get_compressed_size_in_bits(), plain_compressor.get_compressed_size_in_bits())
+          << coder;
+      Array<float> decompressed = qt_decompressor.Decompress(predicted_compressor.compressed_bytes());
+      ASSERT_EQ(block_size, decompressed.length());
+      for (int i = 0; i < block_size; ++i) {
+        ASSERT_NEAR((*data)[i], decompressed[i], max_diff) << coder << " " << i;
+      }
+    }
+  }
+
+  // 真实数据上每个block取较小者：至多多出扩展字段的8位，且始终在误差内
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    SerfQtCompressor plain_compressor(kBlockSizeOverall, 1.0E-1, kSerfQtCoderEliasGamma);
+    SerfQtCompressor predicted_compressor(kBlockSizeOverall, 1.0E-1, kSerfQtCoderEliasGamma, true);
+    SerfQtDecompressor qt_decompressor;
+    std::vector<float> block(kBlockSizeOverall);
+    for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        block[i] = (float) data[offset + i];
+      }
+      plain_compressor.AddValues(block.data(), kBlockSizeOverall);
+      predicted_compressor.AddValues(block.data(), kBlockSizeOverall);
+      plain_compressor.Close();
+      predicted_compressor.Close();
+      EXPECT_LE(predicted_compressor.get_compressed_size_in_bits(), plain_compressor.get_compressed_size_in_bits() + 8)
+          << data_set << offset;
+      Array<float> decompressed = qt_decompressor.Decompress(predicted_compressor.compressed_bytes());
+      ASSERT_EQ(kBlockSizeOverall, decompressed.length());
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        ASSERT_NEAR(block[i], decompressed[i], 1.0E-1) << data_set << offset + i;
+      }
+    }
+  }
+}
+
+TEST(Correctness, SerfQtHeaderLayout) {
+  // 默认的Elias Gamma block没有coder字段：16位len、32位max_diff之后直接是码字，max_diff的符号位为0
+  const float max_diff = 1.0E-2f;
+  const float values[] = {2.0f, 2.0f, 2.0f};
+  SerfQtCompressor gamma_compressor(3, max_diff);
+  ASSERT_EQ(3, gamma_compressor.AddValues(values, 3));
+  ASSERT_TRUE(gamma_compressor.Close());
+  const Array<uint8_t> &gamma_bytes = gamma_compressor.compressed_bytes();
+  // q均为0，每个值1位
+  ASSERT_EQ(7, gamma_bytes.length());
+  EXPECT_EQ(3, gamma_bytes[0] | gamma_bytes[1] << 8);
+  EXPECT_EQ(0, gamma_bytes[5] & 0x80);
+  EXPECT_EQ(0x07, gamma_bytes[6]);
+
+  // rANS在短block上退回gamma，布局与默认block相同
+  SerfQtCompressor rans_compressor(3, max_diff, kSerfQtCoderRans);
+  ASSERT_EQ(3, rans_compressor.AddValues(values, 3));
+  ASSERT_TRUE(rans_compressor.Close());
+  ASSERT_EQ(gamma_bytes.length(), rans_compressor.compressed_bytes().length());
+  EXPECT_EQ(0, memcmp(gamma_bytes.begin(), rans_compressor.compressed_bytes().begin(), gamma_bytes.length()));
+
+  // 选中预测器的block置位符号位并带coder字段，解压端据此读出预测器
+  const uint16_t block_size = 100;
+  std::vector<float> ramp(block_size);
+  for (int i = 0; i < block_size; ++i) {
+    ramp[i] = 116.0f + 0.13f * i;
+  }
+  SerfQtCompressor predicted_compressor(block_size, max_diff, kSerfQtCoderEliasGamma, true);
+  ASSERT_EQ(block_size, predicted_compressor.AddValues(ramp.data(), block_size));
+  ASSERT_TRUE(predicted_compressor.Close());
+  const Array<uint8_t> &predicted_bytes = predicted_compressor.compressed_bytes();
+  EXPECT_EQ(0x80, predicted_bytes[5] & 0x80);
+  SerfQtDecompressor qt_decompressor;
+  Array<float> decompressed = qt_decompressor.Decompress(predicted_bytes);
+  ASSERT_EQ(block_size, decompressed.length());
+  for (int i = 0; i < block_size; ++i) {
+    ASSERT_NEAR(ramp[i], decompressed[i], max_diff) << i;
+  }
+}
+
+TEST(Correctness, SerfQtFixed) {
+  // 1e-6度为单位的GPS坐标，由浮点解压器解码
+  const float unit = 1.0E-6f;
+  for (const auto &data_set : {"Tsbs-iot-latitude.csv", "Tsbs-iot-longitude.csv"}) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    for (const int32_t max_diff : {100000, 10000, 1000}) {
+      SerfQtFixedCompressor fixed_compressor(kBlockSizeOverall, max_diff, unit);
+      SerfQtDecompressor qt_decompressor;
+      ASSERT_LE(1 << fixed_compressor.step_shift(), max_diff * 3 / 2);
+      ASSERT_GT(2 << fixed_compressor.step_shift(), max_diff * 3 / 2);
+      std::vector<int32_t> block(kBlockSizeOverall);
+      for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          block[i] = (int32_t) std::lround(data[offset + i] / unit);
+          fixed_compressor.AddValue(block[i]);
+        }
+        fixed_compressor.Close();
+        Array<float> decompressed = qt_decompressor.Decompress(fixed_compressor.compressed_bytes());
+        ASSERT_EQ(kBlockSizeOverall, decompressed.length());
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          ASSERT_NEAR(block[i] * (double) unit, decompressed[i], max_diff * (double) unit)
+              << data_set << offset + i;
+        }
+      }
+    }
+  }
+}
+
+TEST(Correctness, SerfQtPowerOfTwo) {
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    // 2的幂步长的重建是精确的，只受float分辨率限制：1.0E-6低于部分数据集的分辨率
+    for (const float max_diff : {5.0E-1f, 1.0E-1f, 1.0E-2f, 1.0E-3f, 1.0E-4f, 1.0E-5f, 0.25f, 0x1p-7f, 0x1p-10f}) {
+      SerfQtCompressor qt_compressor(kBlockSizeOverall, max_diff, kSerfQtCoderEliasGamma, false, true);
+      SerfQtDecompressor qt_decompressor;
+      for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+        std::vector<float> block(data.begin() + offset, data.begin() + offset + kBlockSizeOverall);
+        // 前一半逐个加入，后一半走块模式
+        for (int i = 0; i < kBlockSizeOverall / 2; ++i) {
+          qt_compressor.AddValue(block[i]);
+        }
+        qt_compressor.AddValues(block.data() + kBlockSizeOverall / 2, kBlockSizeOverall - kBlockSizeOverall / 2);
+        qt_compressor.Close();
+        const Array<uint8_t> &bytes = qt_compressor.compressed_bytes();
+        float header_max_diff = Double::LongBitsToFloat(bytes[2] | bytes[3] << 8 | bytes[4] << 16 | bytes[5] << 24);
+        ASSERT_TRUE(PowerOfTwoBound::IsPowerOfTwo(header_max_diff));
+        ASSERT_LE(header_max_diff, max_diff);
+        // 留给浮点舍入的余量与普通模式相同（max_diff * 0.999）；本身是2的幂的max_diff原样使用
+        ASSERT_GE(2 * header_max_diff, max_diff * 0.999f);
+        if (PowerOfTwoBound::IsPowerOfTwo(max_diff)) {
+          ASSERT_EQ(max_diff, header_max_diff);
+        }
+        Array<float> decompressed = qt_decompressor.Decompress(bytes);
+        ASSERT_EQ(kBlockSizeOverall, decompressed.length());
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          ASSERT_NEAR(block[i], decompressed[i], max_diff) << data_set << offset + i;
+        }
+      }
+    }
+  }
+
+  for (const auto &data_set : kDataSetList32) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    for (const float max_diff : {1.0E-1f, 1.0E-2f, 1.0E-3f}) {
+      SerfQtCompressor32 qt_compressor_32(kBlockSizeOverall, max_diff, true);
+      SerfQtDecompressor32 qt_decompressor_32;
+      for (size_t offset = 0; offset + kBlockSizeOverall <= data.size(); offset += kBlockSizeOverall) {
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          qt_compressor_32.AddValue((float) data[offset + i]);
+        }
+        qt_compressor_32.Close();
+        std::vector<float> decompressed = qt_decompressor_32.Decompress(qt_compressor_32.compressed_bytes());
+        ASSERT_EQ(kBlockSizeOverall, decompressed.size());
+        for (int i = 0; i < kBlockSizeOverall; ++i) {
+          ASSERT_NEAR((float) data[offset + i], decompressed[i], max_diff) << data_set << offset + i;
+        }
+      }
+    }
+  }
+}
+
+TEST(Correctness, SerfQtRingBuffer) {
+  // 采集线程只Push，压缩线程按block从环形缓冲区取出；结果须与直接按块压缩逐字节相同
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  const size_t block_count = data.size() / kBlockSizeOverall;
+  std::unique_ptr<SpscRingBuffer<float, 64>> ring_buffer(new SpscRingBuffer<float, 64>());
+  // 测试中生产者在满时重试，被拒绝的Push同样计入dropped()
+  int rejected = 0;
+  std::thread producer([&] {
+    for (size_t i = 0; i < block_count * kBlockSizeOverall; ++i) {
+      while (!ring_buffer->Push((float) data[i])) {
+        ++rejected;
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  SerfQtCompressor ring_compressor(kBlockSizeOverall, kMaxDiffList[0]);
+  SerfQtCompressor direct_compressor(kBlockSizeOverall, kMaxDiffList[0]);
+  std::vector<float> block(kBlockSizeOverall);
+  for (size_t offset = 0; offset < block_count * kBlockSizeOverall; offset += kBlockSizeOverall) {
+    uint16_t drained = 0;
+    while (drained < kBlockSizeOverall) {
+      uint16_t count = ring_buffer->DrainBatchesTo(&ring_compressor, kBlockSizeOverall - drained);
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+      drained += count;
+    }
+    ring_compressor.Close();
+    for (int i = 0; i < kBlockSizeOverall; ++i) {
+      block[i] = (float) data[offset + i];
+    }
+    direct_compressor.AddValues(block.data(), kBlockSizeOverall);
+    direct_compressor.Close();
+    const Array<uint8_t> &ring_bytes = ring_compressor.compressed_bytes();
+    const Array<uint8_t> &direct_bytes = direct_compressor.compressed_bytes();
+    ASSERT_EQ(direct_bytes.length(), ring_bytes.length()) << offset;
+    for (serf_size_t i = 0; i < direct_bytes.length(); ++i) {
+      ASSERT_EQ(direct_bytes[i], ring_bytes[i]) << offset << " " << i;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ring_buffer->empty());
+  EXPECT_EQ(rejected, (int) ring_buffer->dropped());
+
+  // 满时Push不阻塞，丢弃并计数；回绕后的内容按两段交给AddValues，逐个取出时顺序不变；
+  // sink拒绝的值留在缓冲区中，不会丢失
+  struct Recorder {
+    std::vector<float> values;
+    size_t limit = 100;
+    int batches = 0;
+    bool AddValue(float value) {
+      if (values.size() >= limit) {
+        return false;
+      }
+      values.push_back(value);
+      return true;
+    }
+    uint16_t AddValues(const float *batch, uint16_t count) {
+      uint16_t accepted = (uint16_t) std::min<size_t>(count, limit - values.size());
+      values.insert(values.end(), batch, batch + accepted);
+      ++batches;
+      return accepted;
+    }
+  };
+  SpscRingBuffer<float, 8> small_buffer;
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i < 8, small_buffer.Push((float) i));
+  }
+  EXPECT_EQ(2u, small_buffer.dropped());
+  Recorder recorder;
+  recorder.limit = 3;
+  EXPECT_EQ(3, small_buffer.DrainTo(&recorder, 5));
+  EXPECT_EQ(5, small_buffer.size());
+  recorder.limit = 100;
+  EXPECT_EQ(2, small_buffer.DrainTo(&recorder, 2));
+  for (int i = 10; i < 15; ++i) {
+    EXPECT_TRUE(small_buffer.Push((float) i));
+  }
+  EXPECT_EQ(8, small_buffer.size());
+  // 第一段的3个值只接受2个，第二段不再交出
+  recorder.limit = 7;
+  EXPECT_EQ(2, small_buffer.DrainBatchesTo(&recorder, 100));
+  EXPECT_EQ(1, recorder.batches);
+  recorder.limit = 100;
+  EXPECT_EQ(6, small_buffer.DrainBatchesTo(&recorder, 100));
+  EXPECT_EQ(3, recorder.batches);
+  std::vector<float> expected = {0, 1, 2, 3, 4, 5, 6, 7, 10, 11, 12, 13, 14};
+  EXPECT_EQ(expected, recorder.values);
+  float value;
+  EXPECT_FALSE(small_buffer.Pop(&value));
+}
+
+TEST(Correctness, SerfTrajectory) {
+  std::ifstream latitude_input_stream(kDataSetDirPrefix + "Tsbs-iot-latitude.csv");
+  std::ifstream longitude_input_stream(kDataSetDirPrefix + "Tsbs-iot-longitude.csv");
+  if (!latitude_input_stream.is_open() || !longitude_input_stream.is_open()) {
+    std::cerr << "Failed to open the file [Tsbs-iot-latitude.csv / Tsbs-iot-longitude.csv]" << std::endl;
+  }
+
+  // float坐标在1e-4以下已接近单精度分辨率
+  for (const auto &max_diff : {1e-1f, 1e-2f, 1e-3f}) {
+    std::vector<double> latitudes;
+    std::vector<double> longitudes;
+    while ((latitudes = ReadBlock(latitude_input_stream, kBlockSizeOverall)).size() == kBlockSizeOverall &&
+        (longitudes = ReadBlock(longitude_input_stream, kBlockSizeOverall)).size() == kBlockSizeOverall) {
+      SerfTrajectoryCompressor trajectory_compressor(kBlockSizeOverall, max_diff, max_diff);
+      SerfTrajectoryDecompressor trajectory_decompressor;
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        trajectory_point_t point = {(float) latitudes[i], (float) longitudes[i]};
+        trajectory_compressor.AddPoint(point);
+      }
+      trajectory_compressor.Close();
+      Array<trajectory_point_t> decompressed = trajectory_decompressor.Decompress(
+          trajectory_compressor.compressed_bytes());
+      ASSERT_EQ(kBlockSizeOverall, decompressed.length());
+      for (int i = 0; i < kBlockSizeOverall; ++i) {
+        ASSERT_NEAR((float) latitudes[i], decompressed[i].latitude, max_diff) << i;
+        ASSERT_NEAR((float) longitudes[i], decompressed[i].longitude, max_diff) << i;
+      }
+    }
+
+    ResetFileStream(latitude_input_stream);
+    ResetFileStream(longitude_input_stream);
+  }
+}
+
 TEST(Correctness, NetSerfXOR) {
   for (const auto &data_set : kDataSetList) {
     std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
@@ -117,7 +1034,8 @@ TEST(Correctness, TestNetSerfQt) {
       std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
     }
 
-    for (const auto &max_diff : kMaxDiffList) {
+    // 同SerfQt，重建为float
+    for (const double max_diff : {1.0E-1, 1.0E-2}) {
       NetSerfQtCompressor net_serf_qt_compressor(max_diff);
       NetSerfQtDecompressor net_serf_qt_decompressor(max_diff);
 
@@ -139,6 +1057,280 @@ TEST(Correctness, TestNetSerfQt) {
   }
 }
 
+TEST(Correctness, NetSerfQtCoalescing) {
+  // 802.15.4帧127字节，扣除MAC头后约100字节可用；每10ms一个值，最多等待200ms
+  const net_coalescing_config_t config = {100, 255, 200};
+  for (const auto &data_set : kDataSetList) {
+    std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
+    if (!data_set_input_stream.is_open()) {
+      std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
+    }
+
+    for (const auto &max_diff : kMaxDiffList) {
+      // 聚合模式只改变分帧方式，解压结果须与逐值模式一致
+      NetSerfQtCompressor packet_compressor(max_diff);
+      NetSerfQtDecompressor packet_decompressor(max_diff);
+      NetSerfQtCompressor frame_compressor(max_diff);
+      NetSerfQtDecompressor frame_decompressor(max_diff);
+      ASSERT_TRUE(frame_compressor.EnableCoalescing(config));
+
+      std::vector<double> expected;
+      Array<double> frame_values(255);
+      size_t next_to_check = 0;
+      long packet_bytes = 0;
+      long frame_bytes = 0;
+      auto check_frame = [&](Array<uint8_t> &frame) {
+        if (!frame.is_valid()) return;
+        ASSERT_LE(frame.length(), config.mtu_bytes);
+        frame_bytes += frame.length();
+        uint8_t count = frame_decompressor.DecompressFrame(frame, frame_values);
+        ASSERT_GT(count, 0);
+        for (uint8_t i = 0; i < count; ++i) {
+          ASSERT_EQ(expected[next_to_check++], frame_values[i]) << data_set;
+        }
+      };
+
+      double original_data;
+      uint32_t now_ms = 0;
+      for (int i = 0; i < 5000 && data_set_input_stream >> original_data; ++i, now_ms += 10) {
+        Array<uint8_t> packet = packet_compressor.Compress(original_data);
+        packet_bytes += packet.length();
+        expected.push_back(packet_decompressor.Decompress(packet));
+        Array<uint8_t> frame = frame_compressor.Append(original_data, now_ms);
+        check_frame(frame);
+        Array<uint8_t> expired = frame_compressor.Poll(now_ms + 5);
+        check_frame(expired);
+      }
+      Array<uint8_t> last = frame_compressor.Flush();
+      check_frame(last);
+      ASSERT_EQ(expected.size(), next_to_check);
+      ASSERT_LT(frame_bytes, packet_bytes);
+
+      ResetFileStream(data_set_input_stream);
+    }
+
+    data_set_input_stream.close();
+  }
+}
+
+TEST(Correctness, NetCoalescingMtu) {
+  // 帧的第一个值总会写入，MTU须放得下帧头和一个最长的值
+  const uint16_t qt_min_mtu = (NetFrameCoalescer::kFrameHeaderBits + NetSerfQtCompressor::kMaxValueBits + 7) / 8;
+  const uint16_t xor_min_mtu = (NetFrameCoalescer::kFrameHeaderBits + NetSerfXORCompressor::kMaxValueBits + 7) / 8;
+  NetSerfQtCompressor qt_compressor(kMaxDiffList[0]);
+  ASSERT_FALSE(qt_compressor.EnableCoalescing({0, 255, 0}));
+  ASSERT_FALSE(qt_compressor.EnableCoalescing({static_cast<uint16_t>(qt_min_mtu - 1), 255, 0}));
+  ASSERT_FALSE(qt_compressor.Append(1.0, 0).is_valid());
+  ASSERT_TRUE(qt_compressor.EnableCoalescing({qt_min_mtu, 255, 0}));
+  NetSerfXORCompressor rejected_compressor(kBlockSizeOverall, kMaxDiffList[0], 0);
+  ASSERT_FALSE(rejected_compressor.EnableCoalescing({0, 255, 0}));
+  ASSERT_FALSE(rejected_compressor.EnableCoalescing({static_cast<uint16_t>(xor_min_mtu - 1), 255, 0}));
+
+  // 聚合帧不带重同步header，两种模式互斥
+  ASSERT_FALSE(qt_compressor.EnableResync({10, 0}));
+  NetSerfQtCompressor resync_qt_compressor(kMaxDiffList[0]);
+  ASSERT_TRUE(resync_qt_compressor.EnableResync({10, 0}));
+  ASSERT_FALSE(resync_qt_compressor.EnableCoalescing({qt_min_mtu, 255, 0}));
+  NetSerfXORCompressor resync_xor_compressor(kBlockSizeOverall, kMaxDiffList[0], 0);
+  ASSERT_TRUE(resync_xor_compressor.EnableResync({10, 0}));
+  ASSERT_FALSE(resync_xor_compressor.EnableCoalescing({xor_min_mtu, 255, 0}));
+  NetSerfXORCompressor coalescing_xor_compressor(kBlockSizeOverall, kMaxDiffList[0], 0);
+  ASSERT_TRUE(coalescing_xor_compressor.EnableCoalescing({xor_min_mtu, 255, 0}));
+  ASSERT_FALSE(coalescing_xor_compressor.EnableResync({10, 0}));
+
+  // 最小的MTU下每帧通常只有一个值，窗口更新时该值带两张位置表
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  int adjust_digit = kFileNameToAdjustDigit.find(kDataSetList[0])->second;
+  NetSerfXORCompressor packet_compressor(kBlockSizeOverall, kMaxDiffList[2], adjust_digit);
+  NetSerfXORDecompressor packet_decompressor(kBlockSizeOverall, adjust_digit);
+  NetSerfXORCompressor frame_compressor(kBlockSizeOverall, kMaxDiffList[2], adjust_digit);
+  NetSerfXORDecompressor frame_decompressor(kBlockSizeOverall, adjust_digit);
+  ASSERT_TRUE(frame_compressor.EnableCoalescing({xor_min_mtu, 255, 0}));
+  std::vector<double> expected;
+  size_t next_to_check = 0;
+  Array<double> frame_values(255);
+  auto check_frame = [&](Array<uint8_t> &frame) {
+    if (!frame.is_valid()) return;
+    ASSERT_LE(frame.length(), xor_min_mtu);
+    uint8_t count = frame_decompressor.DecompressFrame(frame, frame_values);
+    ASSERT_GT(count, 0);
+    for (uint8_t i = 0; i < count; ++i) {
+      ASSERT_EQ(expected[next_to_check++], frame_values[i]);
+    }
+  };
+  for (size_t i = 0; i < 2000 && i < data.size(); ++i) {
+    Array<uint8_t> packet = packet_compressor.Compress(data[i]);
+    expected.push_back(packet_decompressor.Decompress(packet));
+    Array<uint8_t> frame = frame_compressor.Append(data[i], 0);
+    check_frame(frame);
+  }
+  Array<uint8_t> last = frame_compressor.Flush();
+  check_frame(last);
+  ASSERT_EQ(expected.size(), next_to_check);
+}
+
+TEST(Correctness, NetSerfQtMultiplexer) {
+  // 每个数据集作为一个序列，序列号间隔较大以覆盖varint扩展
+  const uint32_t kSeriesIdStride = 211;
+  const uint32_t number_of_series = std::size(kDataSetList) * kSeriesIdStride;
+  for (const auto &max_diff : kMaxDiffList) {
+    std::vector<std::ifstream> data_set_input_streams;
+    std::vector<std::unique_ptr<NetSerfQtCompressor>> single_compressors;
+    std::vector<std::unique_ptr<NetSerfQtDecompressor>> single_decompressors;
+    for (const auto &data_set : kDataSetList) {
+      data_set_input_streams.emplace_back(kDataSetDirPrefix + data_set);
+      single_compressors.emplace_back(new NetSerfQtCompressor(max_diff));
+      single_decompressors.emplace_back(new NetSerfQtDecompressor(max_diff));
+    }
+    NetSerfQtMultiplexer multiplexer(number_of_series, max_diff);
+    NetSerfQtDemultiplexer demultiplexer(number_of_series, max_diff);
+
+    // 轮流从各序列取值，多路结果须与各自独立压缩逐位一致
+    for (int round = 0; round < 1000; ++round) {
+      for (size_t i = 0; i < std::size(kDataSetList); ++i) {
+        double original_data;
+        if (!(data_set_input_streams[i] >> original_data)) continue;
+        uint32_t series_id = i * kSeriesIdStride;
+        Array<uint8_t> single = single_compressors[i]->Compress(original_data);
+        double expected = single_decompressors[i]->Decompress(single);
+
+        Array<uint8_t> packet = multiplexer.Compress(series_id, original_data);
+        uint32_t decoded_series_id;
+        double decompressed;
+        ASSERT_TRUE(demultiplexer.Decompress(packet, &decoded_series_id, &decompressed));
+        ASSERT_EQ(series_id, decoded_series_id);
+        ASSERT_EQ(expected, decompressed) << kDataSetList[i];
+      }
+    }
+  }
+}
+
+TEST(Correctness, NetSerfXORMultiplexer) {
+  // 三个序列轮流发送，窗口很小：每次窗口更新都落在两个不同序列的值之间，共享的位置表须在两端同步更新
+  const int window_size = 50;
+  const uint32_t kSeriesIdStride = 211;
+  const size_t number_of_series = 3;
+  int adjust_digit = kFileNameToAdjustDigit.find(kDataSetList[0])->second;
+  std::vector<std::vector<double>> data;
+  for (size_t i = 0; i < number_of_series; ++i) {
+    data.push_back(ReadDataSet(kDataSetDirPrefix + kDataSetList[i]));
+  }
+  for (const auto &max_diff : kMaxDiffList) {
+    NetSerfXORMultiplexer multiplexer(number_of_series * kSeriesIdStride, window_size, max_diff, adjust_digit);
+    NetSerfXORDemultiplexer demultiplexer(number_of_series * kSeriesIdStride, window_size, adjust_digit);
+    for (size_t value = 0; value < 40 * window_size; ++value) {
+      size_t i = value % number_of_series;
+      double original_data = data[i][value / number_of_series];
+      uint32_t series_id = i * kSeriesIdStride;
+      Array<uint8_t> packet = multiplexer.Compress(series_id, original_data);
+      ASSERT_TRUE(packet.is_valid());
+      uint32_t decoded_series_id;
+      double decompressed;
+      ASSERT_TRUE(demultiplexer.Decompress(packet, &decoded_series_id, &decompressed));
+      ASSERT_EQ(series_id, decoded_series_id);
+      ASSERT_LE(std::abs(original_data - decompressed), max_diff) << kDataSetList[i] << " " << value;
+    }
+  }
+
+  // 超出范围的序列号被拒绝
+  NetSerfXORMultiplexer multiplexer(number_of_series, window_size, kMaxDiffList[0], adjust_digit);
+  ASSERT_FALSE(multiplexer.Compress(number_of_series, 1.0).is_valid());
+}
+
+TEST(Correctness, NetSerfQtResync) {
+  // 每32个值一个keyframe，按固定模式丢包，既有单个丢包也有跨keyframe的连续丢包
+  const net_resync_config_t config = {32, 0};
+  for (const auto &data_set : kDataSetList) {
+    std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
+    if (!data_set_input_stream.is_open()) {
+      std::cerr << "Failed to open the file [" << data_set << "]" << std::endl;
+    }
+
+    for (const auto &max_diff : kMaxDiffList) {
+      NetSerfQtCompressor compressor(max_diff);
+      NetSerfQtDecompressor lossless_decompressor(max_diff);
+      NetSerfQtDecompressor lossy_decompressor(max_diff);
+      compressor.EnableResync(config);
+      lossless_decompressor.EnableResync();
+      lossy_decompressor.EnableResync();
+
+      double original_data;
+      int values_since_drop = -1;
+      for (int i = 0; i < 5000 && data_set_input_stream >> original_data; ++i) {
+        Array<uint8_t> packet = compressor.Compress(original_data);
+        double expected;
+        ASSERT_EQ(kNetResyncOk, lossless_decompressor.Decompress(packet, &expected));
+
+        if (i % 97 == 50 || (i % 500 >= 200 && i % 500 < 240)) {
+          values_since_drop = 0;
+          continue;
+        }
+        double decompressed = 0;
+        NetResyncStatus status = lossy_decompressor.Decompress(packet, &decompressed);
+        if (values_since_drop < 0) {
+          // 未丢包或已经重同步：值须与无损接收完全一致
+          ASSERT_EQ(kNetResyncOk, status) << data_set << " " << i;
+          ASSERT_EQ(expected, decompressed) << data_set << " " << i;
+        } else if (status == kNetResyncLost) {
+          // 丢包后最多一个keyframe间隔内无法解出
+          ASSERT_LT(++values_since_drop, config.keyframe_interval_values) << data_set << " " << i;
+        } else {
+          ASSERT_EQ(kNetResyncRecovered, status) << data_set << " " << i;
+          ASSERT_EQ(expected, decompressed) << data_set << " " << i;
+          values_since_drop = -1;
+        }
+      }
+
+      ResetFileStream(data_set_input_stream);
+    }
+
+    data_set_input_stream.close();
+  }
+}
+
+TEST(Correctness, NetSerfXORResync) {
+  // keyframes must also reset the post-office tables, so use a window shorter than the keyframe interval
+  const net_resync_config_t config = {64, 0};
+  const int window_size = 16;
+  for (const auto &data_set : kDataSetList) {
+    std::vector<double> data = ReadDataSet(kDataSetDirPrefix + data_set);
+    int adjust_digit = kFileNameToAdjustDigit.find(data_set)->second;
+    for (const auto &max_diff : kMaxDiffList) {
+      NetSerfXORCompressor compressor(window_size, max_diff, adjust_digit);
+      NetSerfXORDecompressor lossless_decompressor(window_size, adjust_digit);
+      NetSerfXORDecompressor lossy_decompressor(window_size, adjust_digit);
+      compressor.EnableResync(config);
+      lossless_decompressor.EnableResync();
+      lossy_decompressor.EnableResync();
+
+      int values_since_drop = -1;
+      for (size_t i = 0; i < std::min<size_t>(data.size(), 5000); ++i) {
+        Array<uint8_t> packet = compressor.Compress(data[i]);
+        double expected;
+        ASSERT_EQ(kNetResyncOk, lossless_decompressor.Decompress(packet, &expected));
+        ASSERT_LE(std::abs(data[i] - expected), max_diff) << data_set << " " << i;
+
+        if (i % 97 == 50 || (i % 500 >= 200 && i % 500 < 240)) {
+          values_since_drop = 0;
+          continue;
+        }
+        double decompressed = 0;
+        NetResyncStatus status = lossy_decompressor.Decompress(packet, &decompressed);
+        if (values_since_drop < 0) {
+          ASSERT_EQ(kNetResyncOk, status) << data_set << " " << i;
+          ASSERT_EQ(expected, decompressed) << data_set << " " << i;
+        } else if (status == kNetResyncLost) {
+          ASSERT_LT(++values_since_drop, config.keyframe_interval_values) << data_set << " " << i;
+        } else {
+          ASSERT_EQ(kNetResyncRecovered, status) << data_set << " " << i;
+          ASSERT_EQ(expected, decompressed) << data_set << " " << i;
+          values_since_drop = -1;
+        }
+      }
+    }
+  }
+}
+
 TEST(Correctness, SerfXOR32) {
   for (const auto &data_set : kDataSetList32) {
     std::ifstream data_set_input_stream(kDataSetDirPrefix + data_set);
@@ -203,4 +1395,4 @@ TEST(Correctness, SerfQt32) {
 
     data_set_input_stream.close();
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,68 @@
+#ifndef SERF_TOOLS_BOUNDED_QUEUE_H
+#define SERF_TOOLS_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/*
+ * Blocking queue of at most kCapacity items between two pipeline stages. A full queue stalls the upstream stage,
+ * so memory stays bounded however far the reader gets ahead of the compressor. Close() ends the stream: the
+ * producer calls it after its last item, a failing consumer calls it to make the producer's next Push fail and
+ * unwind the stages before it.
+ */
+template<typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity) : kCapacity(capacity) {}
+
+  /**
+   * @brief Append an item, waiting while the queue is full
+   * @return False if the queue has been closed, the item is then discarded
+   */
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < kCapacity; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Take the oldest item, waiting while the queue is empty
+   * @return False once the queue is closed and every item before the close has been taken
+   */
+  bool Pop(T *item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t kCapacity;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> items_;
+  bool closed_ = false;
+};
+
+#endif  // SERF_TOOLS_BOUNDED_QUEUE_H
@@ -0,0 +1,62 @@
+#ifndef SERF_TOOLS_SERF_CLI_H
+#define SERF_TOOLS_SERF_CLI_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+/*
+ * Pieces shared by serf-compress and serf-decompress. Each tool runs its stages on separate threads connected
+ * by BoundedQueue; the first stage to fail records its message here and closes its queues, which unwinds the
+ * other stages, and the tool exits non-zero with that message.
+ */
+
+// Default number of items buffered between two stages
+constexpr size_t kSerfCliQueueDepth = 8;
+
+class PipelineStatus {
+ public:
+  // Keeps the first error, later ones are usually its consequences
+  void Fail(const std::string &message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) {
+      error_ = message;
+    }
+  }
+
+  bool ok() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_.empty();
+  }
+
+  std::string error() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::string error_;
+};
+
+/**
+ * @brief Open a file for a pipeline stage, "-" is stdin or stdout
+ * @param mode "rb" or "wb"
+ * @return nullptr if the file cannot be opened
+ */
+inline std::FILE *OpenStream(const std::string &path, const char *mode) {
+  if (path == "-") {
+    return mode[0] == 'r' ? stdin : stdout;
+  }
+  return std::fopen(path.c_str(), mode);
+}
+
+// Close a stream from OpenStream, false if buffered data could not be written
+inline bool CloseStream(std::FILE *file) {
+  if (file == stdin || file == stdout) {
+    return std::fflush(file) == 0;
+  }
+  return std::fclose(file) == 0;
+}
+
+#endif  // SERF_TOOLS_SERF_CLI_H
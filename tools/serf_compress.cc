@@ -0,0 +1,270 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "serf_cli.h"
+#include "serf_container.h"
+#include "compressor/serf_qt_compressor.h"
+
+/*
+ * serf-compress: text of numbers in, SERF container out. Four overlapped stages:
+ *   read      raw chunks of the input, cut after the last separator so no number straddles two chunks
+ *   parse     numbers of each chunk, grouped into blocks of block_size values
+ *   compress  each block in file order with one compressor of the chosen algorithm
+ *   write     container records, on the main thread
+ * Numbers may be separated by whitespace, ',' or ';'. Fields that are not a number, e.g. a CSV header, are
+ * skipped and counted.
+ */
+
+namespace {
+
+const size_t kChunkBytes = 1 << 20;
+const char kSeparators[] = " \t\r\n,;";
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: serf-compress -a xor|qt|xor32|qt32 -e MAX_DIFF [-b BLOCK_SIZE] [-w WINDOW_SIZE]\n"
+               "                     [-c gamma|rans|packed] [-q QUEUE_DEPTH] INPUT OUTPUT\n"
+               "  -a  algorithm; qt, xor32 and qt32 compress the values as float\n"
+               "  -e  maximum absolute error of every decompressed value; qt, xor32 and qt32 fail on\n"
+               "      a value that float cannot reproduce that closely\n"
+               "  -b  values per block, 1 to %u (default 1000)\n"
+               "  -w  post-office window of xor and xor32, block size to %u (default 1000)\n"
+               "  -c  residual coder of qt (default gamma)\n"
+               "  -q  blocks buffered between two stages (default %zu)\n"
+               "INPUT and OUTPUT may be - for stdin and stdout.\n",
+               SerfContainer::kMaxBlockSize, SerfContainer::kMaxBlockSize, kSerfCliQueueDepth);
+}
+
+bool ParseCoder(const std::string &name, uint8_t *coder) {
+  if (name == "gamma") {
+    *coder = kSerfQtCoderEliasGamma;
+  } else if (name == "rans") {
+    *coder = kSerfQtCoderRans;
+  } else if (name == "packed") {
+    *coder = kSerfQtCoderPacked;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseUnsigned(const char *text, uint32_t *value) {
+  char *end;
+  unsigned long parsed = std::strtoul(text, &end, 10);
+  if (*text == '\0' || *end != '\0' || parsed > UINT32_MAX) {
+    return false;
+  }
+  *value = static_cast<uint32_t>(parsed);
+  return true;
+}
+
+void ReadStage(std::FILE *input, BoundedQueue<std::string> *chunks, PipelineStatus *status) {
+  std::vector<char> buffer(kChunkBytes);
+  std::string carry;
+  size_t length;
+  while ((length = std::fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+    std::string chunk;
+    chunk.swap(carry);
+    chunk.append(buffer.data(), length);
+    size_t split = chunk.find_last_of(kSeparators);
+    if (split == std::string::npos) {
+      // a single field longer than a chunk, keep collecting it
+      carry.swap(chunk);
+      continue;
+    }
+    carry.assign(chunk, split + 1, std::string::npos);
+    chunk.resize(split + 1);
+    if (!chunks->Push(std::move(chunk))) {
+      return;
+    }
+  }
+  if (std::ferror(input)) {
+    status->Fail("failed to read the input");
+  } else if (!carry.empty()) {
+    chunks->Push(std::move(carry));
+  }
+  chunks->Close();
+}
+
+void ParseStage(uint32_t block_size, BoundedQueue<std::string> *chunks, BoundedQueue<std::vector<double>> *blocks,
+                uint64_t *skipped_fields) {
+  std::vector<double> block;
+  block.reserve(block_size);
+  std::string chunk;
+  bool downstream_open = true;
+  while (downstream_open && chunks->Pop(&chunk)) {
+    const char *cursor = chunk.c_str();
+    while (true) {
+      cursor += std::strspn(cursor, kSeparators);
+      if (*cursor == '\0') {
+        break;
+      }
+      size_t field_length = std::strcspn(cursor, kSeparators);
+      char *end;
+      double value = std::strtod(cursor, &end);
+      cursor += field_length;
+      if (end != cursor) {
+        ++*skipped_fields;
+        continue;
+      }
+      block.push_back(value);
+      if (block.size() == block_size) {
+        downstream_open = blocks->Push(std::move(block));
+        block = std::vector<double>();
+        block.reserve(block_size);
+        if (!downstream_open) {
+          break;
+        }
+      }
+    }
+  }
+  if (downstream_open && !block.empty()) {
+    blocks->Push(std::move(block));
+  }
+  // stops the reader early if the stages after this one gave up
+  chunks->Close();
+  blocks->Close();
+}
+
+void CompressStage(SerfBlockEncoder *encoder, BoundedQueue<std::vector<double>> *blocks,
+                   BoundedQueue<SerfContainerRecord> *records, PipelineStatus *status) {
+  std::vector<double> block;
+  while (blocks->Pop(&block)) {
+    SerfContainerRecord record;
+    record.value_count = static_cast<uint32_t>(block.size());
+    if (!encoder->Encode(block, &record.payload) || record.payload.size() > SerfContainer::kMaxPayloadLength) {
+      status->Fail("failed to compress a block within max_diff");
+      break;
+    }
+    if (!records->Push(std::move(record))) {
+      break;
+    }
+  }
+  blocks->Close();
+  records->Close();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  SerfContainerHeader header;
+  bool has_algorithm = false;
+  bool has_window_size = false;
+  uint32_t queue_depth = kSerfCliQueueDepth;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option.size() != 2 || option[0] != '-') {
+      paths.push_back(option);
+      continue;
+    }
+    if (i + 1 == argc) {
+      PrintUsage();
+      return 2;
+    }
+    const char *value = argv[++i];
+    bool ok = true;
+    switch (option[1]) {
+      case 'a':
+        ok = has_algorithm = SerfContainer::ParseAlgorithm(value, &header.algorithm);
+        break;
+      case 'e': {
+        char *end;
+        header.max_diff = std::strtod(value, &end);
+        ok = *end == '\0';
+        break;
+      }
+      case 'b':
+        ok = ParseUnsigned(value, &header.block_size);
+        break;
+      case 'w':
+        ok = has_window_size = ParseUnsigned(value, &header.window_size);
+        break;
+      case 'c':
+        ok = ParseCoder(value, &header.qt_coder);
+        break;
+      case 'q':
+        ok = ParseUnsigned(value, &queue_depth) && queue_depth > 0;
+        break;
+      default:
+        ok = false;
+    }
+    if (!ok) {
+      std::fprintf(stderr, "serf-compress: invalid value '%s' for %s\n", value, option.c_str());
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (!has_algorithm || paths.size() != 2) {
+    PrintUsage();
+    return 2;
+  }
+  if (!has_window_size && header.window_size < header.block_size) {
+    header.window_size = header.block_size;
+  }
+  std::string error = SerfContainer::Validate(header);
+  if (!error.empty()) {
+    std::fprintf(stderr, "serf-compress: %s\n", error.c_str());
+    return 2;
+  }
+
+  std::FILE *input = OpenStream(paths[0], "rb");
+  if (input == nullptr) {
+    std::fprintf(stderr, "serf-compress: cannot open %s\n", paths[0].c_str());
+    return 1;
+  }
+  std::FILE *output = OpenStream(paths[1], "wb");
+  if (output == nullptr) {
+    std::fprintf(stderr, "serf-compress: cannot create %s\n", paths[1].c_str());
+    CloseStream(input);
+    return 1;
+  }
+
+  std::unique_ptr<SerfBlockEncoder> encoder = SerfBlockEncoder::Create(header);
+  PipelineStatus status;
+  uint64_t skipped_fields = 0;
+  BoundedQueue<std::string> chunks(queue_depth);
+  BoundedQueue<std::vector<double>> blocks(queue_depth);
+  BoundedQueue<SerfContainerRecord> records(queue_depth);
+  std::thread reader(ReadStage, input, &chunks, &status);
+  std::thread parser(ParseStage, header.block_size, &chunks, &blocks, &skipped_fields);
+  std::thread compressor(CompressStage, encoder.get(), &blocks, &records, &status);
+
+  bool written = SerfContainer::WriteHeader(output, header);
+  SerfContainerRecord record;
+  while (written && records.Pop(&record)) {
+    written = SerfContainer::WriteRecord(output, record);
+  }
+  if (!written) {
+    status.Fail("failed to write the output");
+  }
+  records.Close();
+  compressor.join();
+  parser.join();
+  reader.join();
+
+  // without the end record a failed run cannot be mistaken for a complete file
+  if (status.ok() && !SerfContainer::WriteEnd(output)) {
+    status.Fail("failed to write the output");
+  }
+  CloseStream(input);
+  if (!CloseStream(output)) {
+    status.Fail("failed to write the output");
+  }
+  if (skipped_fields > 0) {
+    std::fprintf(stderr, "serf-compress: skipped %llu fields that are not numbers\n",
+                 static_cast<unsigned long long>(skipped_fields));
+  }
+  if (!status.ok()) {
+    std::fprintf(stderr, "serf-compress: %s\n", status.error().c_str());
+    return 1;
+  }
+  return 0;
+}
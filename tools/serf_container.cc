@@ -0,0 +1,403 @@
+#include "serf_container.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "compressor/serf_xor_compressor.h"
+#include "decompressor/serf_xor_decompressor.h"
+#include "compressor/serf_qt_compressor.h"
+#include "decompressor/serf_qt_decompressor.h"
+#include "compressor_32/serf_xor_compressor_32.h"
+#include "decompressor_32/serf_xor_decompressor_32.h"
+#include "compressor_32/serf_qt_compressor_32.h"
+#include "decompressor_32/serf_qt_decompressor_32.h"
+
+namespace {
+
+const char kMagic[4] = {'S', 'E', 'R', 'F'};
+const int kHeaderLength = 24;
+
+void PutUint32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+uint32_t GetUint32(const uint8_t *in) {
+  return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 | static_cast<uint32_t>(in[2]) << 16 |
+         static_cast<uint32_t>(in[3]) << 24;
+}
+
+void PutUint64(uint8_t *out, uint64_t value) {
+  PutUint32(out, static_cast<uint32_t>(value));
+  PutUint32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+uint64_t GetUint64(const uint8_t *in) {
+  return static_cast<uint64_t>(GetUint32(in)) | static_cast<uint64_t>(GetUint32(in + 4)) << 32;
+}
+
+Array<uint8_t> ToArray(const std::vector<uint8_t> &bytes) {
+  Array<uint8_t> array(static_cast<serf_size_t>(bytes.size()));
+  if (!bytes.empty()) {
+    std::memcpy(array.begin(), bytes.data(), bytes.size());
+  }
+  return array;
+}
+
+void CopyArray(const Array<uint8_t> &array, std::vector<uint8_t> *bytes) {
+  bytes->assign(array.begin(), array.begin() + array.length());
+}
+
+class XorEncoder : public SerfBlockEncoder {
+ public:
+  explicit XorEncoder(const SerfContainerHeader &header)
+      : compressor_(static_cast<int>(header.window_size), header.max_diff) {}
+
+  bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) override {
+    // a block the bit stream cannot take is an error, not a shorter block
+    bool accepted = true;
+    for (double value : values) {
+      accepted = accepted && compressor_.AddValue(value);
+    }
+    if (!compressor_.Close() || !accepted) {
+      return false;
+    }
+    CopyArray(compressor_.compressed_bytes_last_block(), payload);
+    return true;
+  }
+
+ private:
+  SerfXORCompressor compressor_;
+};
+
+class XorDecoder : public SerfBlockDecoder {
+ public:
+  bool Decode(const SerfContainerRecord &record, std::vector<double> *values) override {
+    std::vector<double> block = decompressor_.Decompress(ToArray(record.payload));
+    if (block.size() != record.value_count) {
+      return false;
+    }
+    values->insert(values->end(), block.begin(), block.end());
+    return true;
+  }
+
+ private:
+  SerfXORDecompressor decompressor_;
+};
+
+class Xor32Encoder : public SerfBlockEncoder {
+ public:
+  explicit Xor32Encoder(const SerfContainerHeader &header)
+      : compressor_(static_cast<int>(header.window_size), static_cast<float>(header.max_diff)) {}
+
+  bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) override {
+    // a block the bit stream cannot take is an error, not a shorter block
+    bool accepted = true;
+    for (double value : values) {
+      accepted = accepted && compressor_.AddValue(static_cast<float>(value));
+    }
+    if (!compressor_.Close() || !accepted) {
+      return false;
+    }
+    CopyArray(compressor_.compressed_bytes_last_block(), payload);
+    return true;
+  }
+
+ private:
+  SerfXORCompressor32 compressor_;
+};
+
+class Xor32Decoder : public SerfBlockDecoder {
+ public:
+  bool Decode(const SerfContainerRecord &record, std::vector<double> *values) override {
+    std::vector<float> block = decompressor_.Decompress(ToArray(record.payload));
+    if (block.size() != record.value_count) {
+      return false;
+    }
+    values->insert(values->end(), block.begin(), block.end());
+    return true;
+  }
+
+ private:
+  SerfXORDecompressor32 decompressor_;
+};
+
+// SERF-QT blocks are independent; the length field of a block is fixed per compressor, so a short last block
+// gets a compressor of its own
+class QtEncoder : public SerfBlockEncoder {
+ public:
+  explicit QtEncoder(const SerfContainerHeader &header)
+      : kMaxDiff(static_cast<float>(header.max_diff)), kCoder(static_cast<SerfQtCoder>(header.qt_coder)),
+        compressor_(new SerfQtCompressor(static_cast<uint16_t>(header.block_size), kMaxDiff, kCoder)),
+        block_size_(header.block_size) {}
+
+  bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) override {
+    if (values.size() != block_size_) {
+      block_size_ = static_cast<uint32_t>(values.size());
+      compressor_.reset(new SerfQtCompressor(static_cast<uint16_t>(block_size_), kMaxDiff, kCoder));
+    }
+    float_values_.assign(values.begin(), values.end());
+    uint16_t count = static_cast<uint16_t>(float_values_.size());
+    bool accepted = compressor_->AddValues(float_values_.data(), count) == count;
+    if (!compressor_->Close() || !accepted) {
+      return false;
+    }
+    CopyArray(compressor_->compressed_bytes(), payload);
+    return !payload->empty();
+  }
+
+ private:
+  const float kMaxDiff;
+  const SerfQtCoder kCoder;
+  std::unique_ptr<SerfQtCompressor> compressor_;
+  uint32_t block_size_;
+  std::vector<float> float_values_;
+};
+
+class QtDecoder : public SerfBlockDecoder {
+ public:
+  bool Decode(const SerfContainerRecord &record, std::vector<double> *values) override {
+    // a block starts with its 16-bit value count, DecompressTo fills exactly that many values
+    if (record.payload.size() < 2 ||
+        static_cast<uint32_t>(record.payload[0] | record.payload[1] << 8) != record.value_count) {
+      return false;
+    }
+    if (block_.length() != record.value_count) {
+      Array<float> block(static_cast<serf_size_t>(record.value_count));
+      block_.swap(block);
+    }
+    if (!decompressor_.DecompressTo(ToArray(record.payload), block_)) {
+      return false;
+    }
+    values->insert(values->end(), block_.begin(), block_.begin() + block_.length());
+    return true;
+  }
+
+ private:
+  SerfQtDecompressor decompressor_;
+  Array<float> block_;
+};
+
+class Qt32Encoder : public SerfBlockEncoder {
+ public:
+  explicit Qt32Encoder(const SerfContainerHeader &header)
+      : kMaxDiff(static_cast<float>(header.max_diff)),
+        compressor_(new SerfQtCompressor32(static_cast<int>(header.block_size), kMaxDiff)),
+        block_size_(header.block_size) {}
+
+  bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) override {
+    if (values.size() != block_size_) {
+      block_size_ = static_cast<uint32_t>(values.size());
+      compressor_.reset(new SerfQtCompressor32(static_cast<int>(block_size_), kMaxDiff));
+    }
+    for (double value : values) {
+      compressor_->AddValue(static_cast<float>(value));
+    }
+    compressor_->Close();
+    CopyArray(compressor_->compressed_bytes(), payload);
+    return true;
+  }
+
+ private:
+  const float kMaxDiff;
+  std::unique_ptr<SerfQtCompressor32> compressor_;
+  uint32_t block_size_;
+};
+
+class Qt32Decoder : public SerfBlockDecoder {
+ public:
+  bool Decode(const SerfContainerRecord &record, std::vector<double> *values) override {
+    std::vector<float> block = decompressor_.Decompress(ToArray(record.payload));
+    if (block.size() != record.value_count) {
+      return false;
+    }
+    values->insert(values->end(), block.begin(), block.end());
+    return true;
+  }
+
+ private:
+  SerfQtDecompressor32 decompressor_;
+};
+
+// The float variants reconstruct in float, so below the float resolution of the data they exceed max_diff
+// without any error from the codec. Every block is decoded once more, in file order like serf-decompress does,
+// and a value off by more than max_diff fails the block.
+class BoundCheckingEncoder : public SerfBlockEncoder {
+ public:
+  BoundCheckingEncoder(std::unique_ptr<SerfBlockEncoder> encoder, std::unique_ptr<SerfBlockDecoder> decoder,
+                       double max_diff)
+      : kMaxDiff(max_diff), encoder_(std::move(encoder)), decoder_(std::move(decoder)) {}
+
+  bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) override {
+    if (!encoder_->Encode(values, payload)) {
+      return false;
+    }
+    SerfContainerRecord record;
+    record.value_count = static_cast<uint32_t>(values.size());
+    record.payload = *payload;
+    decoded_.clear();
+    if (!decoder_->Decode(record, &decoded_)) {
+      return false;
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      bool both_nan = std::isnan(values[i]) && std::isnan(decoded_[i]);
+      if (!both_nan && !(std::abs(decoded_[i] - values[i]) <= kMaxDiff)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  const double kMaxDiff;
+  std::unique_ptr<SerfBlockEncoder> encoder_;
+  std::unique_ptr<SerfBlockDecoder> decoder_;
+  std::vector<double> decoded_;
+};
+
+}  // namespace
+
+constexpr uint8_t SerfContainer::kVersion;
+constexpr uint32_t SerfContainer::kMaxBlockSize;
+constexpr uint32_t SerfContainer::kMaxPayloadLength;
+
+const char *SerfContainer::AlgorithmName(SerfAlgorithm algorithm) {
+  switch (algorithm) {
+    case kSerfAlgorithmXor:
+      return "xor";
+    case kSerfAlgorithmQt:
+      return "qt";
+    case kSerfAlgorithmXor32:
+      return "xor32";
+    case kSerfAlgorithmQt32:
+      return "qt32";
+  }
+  return nullptr;
+}
+
+bool SerfContainer::ParseAlgorithm(const std::string &name, SerfAlgorithm *algorithm) {
+  for (uint8_t id = kSerfAlgorithmXor; id <= kSerfAlgorithmQt32; ++id) {
+    if (name == AlgorithmName(static_cast<SerfAlgorithm>(id))) {
+      *algorithm = static_cast<SerfAlgorithm>(id);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool SerfContainer::IsSinglePrecision(SerfAlgorithm algorithm) {
+  return algorithm != kSerfAlgorithmXor;
+}
+
+std::string SerfContainer::Validate(const SerfContainerHeader &header) {
+  if (AlgorithmName(header.algorithm) == nullptr) {
+    return "unknown algorithm";
+  }
+  if (!(header.max_diff > 0)) {
+    return "max_diff must be positive";
+  }
+  if (header.block_size == 0 || header.block_size > kMaxBlockSize) {
+    return "block size must be between 1 and " + std::to_string(kMaxBlockSize);
+  }
+  if (header.qt_coder > kSerfQtCoderPacked) {
+    return "unknown SERF-QT coder";
+  }
+  bool is_xor = header.algorithm == kSerfAlgorithmXor || header.algorithm == kSerfAlgorithmXor32;
+  if (is_xor && (header.window_size < header.block_size || header.window_size > kMaxBlockSize)) {
+    // the SERF-XOR bit stream is sized for one window
+    return "window size must be between the block size and " + std::to_string(kMaxBlockSize);
+  }
+  return std::string();
+}
+
+bool SerfContainer::WriteHeader(std::FILE *file, const SerfContainerHeader &header) {
+  uint8_t bytes[kHeaderLength];
+  std::memcpy(bytes, kMagic, sizeof(kMagic));
+  bytes[4] = kVersion;
+  bytes[5] = header.algorithm;
+  bytes[6] = header.qt_coder;
+  bytes[7] = 0;
+  PutUint32(bytes + 8, header.block_size);
+  PutUint32(bytes + 12, header.window_size);
+  PutUint64(bytes + 16, Double::DoubleToLongBits(header.max_diff));
+  return std::fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+}
+
+bool SerfContainer::ReadHeader(std::FILE *file, SerfContainerHeader *header) {
+  uint8_t bytes[kHeaderLength];
+  if (std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes) ||
+      std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0 || bytes[4] != kVersion) {
+    return false;
+  }
+  header->algorithm = static_cast<SerfAlgorithm>(bytes[5]);
+  header->qt_coder = bytes[6];
+  header->block_size = GetUint32(bytes + 8);
+  header->window_size = GetUint32(bytes + 12);
+  header->max_diff = Double::LongBitsToDouble(GetUint64(bytes + 16));
+  return Validate(*header).empty();
+}
+
+bool SerfContainer::WriteRecord(std::FILE *file, const SerfContainerRecord &record) {
+  uint8_t bytes[8];
+  PutUint32(bytes, record.value_count);
+  PutUint32(bytes + 4, static_cast<uint32_t>(record.payload.size()));
+  return std::fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes) &&
+         (record.payload.empty() ||
+          std::fwrite(record.payload.data(), 1, record.payload.size(), file) == record.payload.size());
+}
+
+bool SerfContainer::WriteEnd(std::FILE *file) {
+  return WriteRecord(file, SerfContainerRecord());
+}
+
+bool SerfContainer::ReadRecord(std::FILE *file, SerfContainerRecord *record) {
+  uint8_t bytes[8];
+  if (std::fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)) {
+    return false;
+  }
+  record->value_count = GetUint32(bytes);
+  uint32_t payload_length = GetUint32(bytes + 4);
+  if (record->value_count > kMaxBlockSize || payload_length > kMaxPayloadLength ||
+      (record->value_count == 0) != (payload_length == 0)) {
+    return false;
+  }
+  record->payload.resize(payload_length);
+  return payload_length == 0 || std::fread(record->payload.data(), 1, payload_length, file) == payload_length;
+}
+
+std::unique_ptr<SerfBlockEncoder> SerfBlockEncoder::Create(const SerfContainerHeader &header) {
+  std::unique_ptr<SerfBlockEncoder> encoder;
+  switch (header.algorithm) {
+    case kSerfAlgorithmXor:
+      return std::make_unique<XorEncoder>(header);
+    case kSerfAlgorithmQt:
+      encoder = std::make_unique<QtEncoder>(header);
+      break;
+    case kSerfAlgorithmXor32:
+      encoder = std::make_unique<Xor32Encoder>(header);
+      break;
+    case kSerfAlgorithmQt32:
+      encoder = std::make_unique<Qt32Encoder>(header);
+      break;
+  }
+  if (encoder == nullptr) {
+    return nullptr;
+  }
+  return std::make_unique<BoundCheckingEncoder>(std::move(encoder), SerfBlockDecoder::Create(header),
+                                                header.max_diff);
+}
+
+std::unique_ptr<SerfBlockDecoder> SerfBlockDecoder::Create(const SerfContainerHeader &header) {
+  switch (header.algorithm) {
+    case kSerfAlgorithmXor:
+      return std::make_unique<XorDecoder>();
+    case kSerfAlgorithmQt:
+      return std::make_unique<QtDecoder>();
+    case kSerfAlgorithmXor32:
+      return std::make_unique<Xor32Decoder>();
+    case kSerfAlgorithmQt32:
+      return std::make_unique<Qt32Decoder>();
+  }
+  return nullptr;
+}
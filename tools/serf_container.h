@@ -0,0 +1,104 @@
+#ifndef SERF_TOOLS_SERF_CONTAINER_H
+#define SERF_TOOLS_SERF_CONTAINER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Container file written by serf-compress and read by serf-decompress. All integers are little-endian.
+ *
+ *   header   "SERF" | version (1 byte) | algorithm (1) | qt coder (1) | reserved (1) |
+ *            block size (4) | window size (4) | max_diff as IEEE 754 binary64 bits (8)
+ *   record   value count (4) | payload length (4) | payload: one compressed block of that many values
+ *   end      a record with value count 0 and payload length 0
+ *
+ * Blocks are decoded in order by one decompressor, so the SERF-XOR state carried across blocks is restored. The
+ * end record tells a complete file from a truncated one.
+ */
+
+enum SerfAlgorithm : uint8_t {
+  kSerfAlgorithmXor = 0,
+  kSerfAlgorithmQt = 1,
+  kSerfAlgorithmXor32 = 2,
+  kSerfAlgorithmQt32 = 3,
+};
+
+struct SerfContainerHeader {
+  SerfAlgorithm algorithm = kSerfAlgorithmXor;
+  // SerfQtCoder, only used by kSerfAlgorithmQt
+  uint8_t qt_coder = 0;
+  uint32_t block_size = 1000;
+  // post-office window of the SERF-XOR variants, at least block_size
+  uint32_t window_size = 1000;
+  double max_diff = 0;
+};
+
+struct SerfContainerRecord {
+  uint32_t value_count = 0;
+  std::vector<uint8_t> payload;
+};
+
+class SerfContainer {
+ public:
+  static constexpr uint8_t kVersion = 1;
+  // Array<uint8_t> and Array<float> hold at most 65535 entries, a block stays well below both
+  static constexpr uint32_t kMaxBlockSize = 4096;
+  static constexpr uint32_t kMaxPayloadLength = 65535;
+
+  // Name used on the command line, nullptr for an unknown algorithm
+  static const char *AlgorithmName(SerfAlgorithm algorithm);
+
+  static bool ParseAlgorithm(const std::string &name, SerfAlgorithm *algorithm);
+
+  // True for the variants that compress values as float
+  static bool IsSinglePrecision(SerfAlgorithm algorithm);
+
+  // Error message for an unusable header, empty if it is valid
+  static std::string Validate(const SerfContainerHeader &header);
+
+  static bool WriteHeader(std::FILE *file, const SerfContainerHeader &header);
+
+  static bool ReadHeader(std::FILE *file, SerfContainerHeader *header);
+
+  static bool WriteRecord(std::FILE *file, const SerfContainerRecord &record);
+
+  // Writes the end record
+  static bool WriteEnd(std::FILE *file);
+
+  /**
+   * @brief Read the next record
+   * @return False on a truncated or malformed record; the end record is returned with value_count 0
+   */
+  static bool ReadRecord(std::FILE *file, SerfContainerRecord *record);
+};
+
+/*
+ * One compressor of the container's algorithm. Blocks must be encoded in file order by the same instance, since
+ * SERF-XOR carries its window and post-office tables from one block to the next.
+ */
+class SerfBlockEncoder {
+ public:
+  virtual ~SerfBlockEncoder() = default;
+
+  // values holds 1 to block_size values; the last block of a file may be short
+  virtual bool Encode(const std::vector<double> &values, std::vector<uint8_t> *payload) = 0;
+
+  // The float variants (IsSinglePrecision) check every block against max_diff and fail Encode() on a value
+  // that float cannot reproduce that closely
+  static std::unique_ptr<SerfBlockEncoder> Create(const SerfContainerHeader &header);
+};
+
+class SerfBlockDecoder {
+ public:
+  virtual ~SerfBlockDecoder() = default;
+
+  // Appends the record's values to values, false if the payload does not decode to value_count values
+  virtual bool Decode(const SerfContainerRecord &record, std::vector<double> *values) = 0;
+
+  static std::unique_ptr<SerfBlockDecoder> Create(const SerfContainerHeader &header);
+};
+
+#endif  // SERF_TOOLS_SERF_CONTAINER_H
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Perf_expr_config.hpp"
+#include "Perf_file_utils.hpp"
+
+#include "serf_container.h"
+#include "compressor/serf_qt_compressor.h"
+
+// Data set paths are relative to test/unit_test, where CMake runs this test as well
+
+namespace {
+
+// Encode values into a container in a temporary file, rewound for reading; nullptr if a block fails to encode
+std::FILE *WriteContainer(const SerfContainerHeader &header, const std::vector<double> &values) {
+  std::FILE *file = std::tmpfile();
+  std::unique_ptr<SerfBlockEncoder> encoder = SerfBlockEncoder::Create(header);
+  bool ok = file != nullptr && SerfContainer::WriteHeader(file, header);
+  for (size_t offset = 0; ok && offset < values.size(); offset += header.block_size) {
+    std::vector<double> block(values.begin() + offset,
+                              values.begin() + std::min(values.size(), offset + header.block_size));
+    SerfContainerRecord record;
+    record.value_count = static_cast<uint32_t>(block.size());
+    ok = encoder->Encode(block, &record.payload) && SerfContainer::WriteRecord(file, record);
+  }
+  if (!ok || !SerfContainer::WriteEnd(file)) {
+    if (file != nullptr) {
+      std::fclose(file);
+    }
+    return nullptr;
+  }
+  std::rewind(file);
+  return file;
+}
+
+// Decode a whole container, false if it is malformed or has no end record
+bool ReadContainer(std::FILE *file, std::vector<double> *values) {
+  SerfContainerHeader header;
+  if (!SerfContainer::ReadHeader(file, &header)) {
+    return false;
+  }
+  std::unique_ptr<SerfBlockDecoder> decoder = SerfBlockDecoder::Create(header);
+  SerfContainerRecord record;
+  while (SerfContainer::ReadRecord(file, &record)) {
+    if (record.value_count == 0) {
+      return true;
+    }
+    if (!decoder->Decode(record, values)) {
+      return false;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(Correctness, SerfContainer) {
+  // 2500 values: two full blocks and a short last one
+  std::vector<double> data = ReadDataSet(kDataSetDirPrefix + kDataSetList[0]);
+  data.resize(2500);
+  for (SerfAlgorithm algorithm : {kSerfAlgorithmXor, kSerfAlgorithmQt, kSerfAlgorithmXor32, kSerfAlgorithmQt32}) {
+    SerfContainerHeader header;
+    header.algorithm = algorithm;
+    header.qt_coder = kSerfQtCoderRans;
+    header.max_diff = 1.0E-2;
+    ASSERT_TRUE(SerfContainer::Validate(header).empty());
+    std::FILE *file = WriteContainer(header, data);
+    ASSERT_NE(nullptr, file) << SerfContainer::AlgorithmName(algorithm);
+    std::vector<uint8_t> bytes;
+    int c;
+    while ((c = std::fgetc(file)) != EOF) {
+      bytes.push_back(static_cast<uint8_t>(c));
+    }
+    std::rewind(file);
+
+    std::vector<double> decompressed;
+    ASSERT_TRUE(ReadContainer(file, &decompressed)) << SerfContainer::AlgorithmName(algorithm);
+    std::fclose(file);
+    ASSERT_EQ(data.size(), decompressed.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+      ASSERT_LE(std::abs(data[i] - decompressed[i]), header.max_diff) << SerfContainer::AlgorithmName(algorithm);
+    }
+
+    // cut inside the end record and inside the first payload: a truncated file never reads as complete
+    for (size_t length : {bytes.size() - 1, static_cast<size_t>(24 + 8 + 10)}) {
+      std::FILE *truncated = std::tmpfile();
+      ASSERT_NE(nullptr, truncated);
+      ASSERT_EQ(length, std::fwrite(bytes.data(), 1, length, truncated));
+      std::rewind(truncated);
+      std::vector<double> values;
+      EXPECT_FALSE(ReadContainer(truncated, &values)) << SerfContainer::AlgorithmName(algorithm) << " " << length;
+      std::fclose(truncated);
+    }
+  }
+
+  // float cannot reproduce the values that closely: the float variants fail instead of breaking the bound
+  for (SerfAlgorithm algorithm : {kSerfAlgorithmQt, kSerfAlgorithmXor32, kSerfAlgorithmQt32}) {
+    SerfContainerHeader header;
+    header.algorithm = algorithm;
+    header.max_diff = 1.0E-7;
+    EXPECT_EQ(nullptr, WriteContainer(header, data)) << SerfContainer::AlgorithmName(algorithm);
+  }
+}
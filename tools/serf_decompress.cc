@@ -0,0 +1,163 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "serf_cli.h"
+#include "serf_container.h"
+
+/*
+ * serf-decompress: SERF container in, one number per line out. Four overlapped stages:
+ *   read        container records
+ *   decompress  each block in file order with one decompressor of the container's algorithm
+ *   format      shortest text that reads back to the same double, or float for the single-precision algorithms
+ *   write       the text, on the main thread
+ */
+
+namespace {
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "Usage: serf-decompress [-q QUEUE_DEPTH] INPUT OUTPUT\n"
+               "  -q  blocks buffered between two stages (default %zu)\n"
+               "INPUT and OUTPUT may be - for stdin and stdout.\n",
+               kSerfCliQueueDepth);
+}
+
+void ReadStage(std::FILE *input, BoundedQueue<SerfContainerRecord> *records, PipelineStatus *status) {
+  while (true) {
+    SerfContainerRecord record;
+    if (!SerfContainer::ReadRecord(input, &record)) {
+      status->Fail("truncated or malformed container");
+      break;
+    }
+    if (record.value_count == 0 || !records->Push(std::move(record))) {
+      break;
+    }
+  }
+  records->Close();
+}
+
+void DecompressStage(SerfBlockDecoder *decoder, BoundedQueue<SerfContainerRecord> *records,
+                     BoundedQueue<std::vector<double>> *blocks, PipelineStatus *status) {
+  SerfContainerRecord record;
+  while (records->Pop(&record)) {
+    std::vector<double> block;
+    block.reserve(record.value_count);
+    if (!decoder->Decode(record, &block)) {
+      status->Fail("failed to decompress a block");
+      break;
+    }
+    if (!blocks->Push(std::move(block))) {
+      break;
+    }
+  }
+  records->Close();
+  blocks->Close();
+}
+
+void FormatStage(bool single_precision, BoundedQueue<std::vector<double>> *blocks,
+                 BoundedQueue<std::string> *texts) {
+  std::vector<double> block;
+  while (blocks->Pop(&block)) {
+    // the longest double, e.g. -2.2250738585072014e-308, takes 24 characters
+    std::string text(block.size() * 25, '\0');
+    char *cursor = &text[0];
+    char *end = cursor + text.size();
+    for (double value : block) {
+      std::to_chars_result result = single_precision ?
+          std::to_chars(cursor, end, static_cast<float>(value)) : std::to_chars(cursor, end, value);
+      cursor = result.ptr;
+      *cursor++ = '\n';
+    }
+    text.resize(cursor - &text[0]);
+    if (!texts->Push(std::move(text))) {
+      break;
+    }
+  }
+  blocks->Close();
+  texts->Close();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  uint32_t queue_depth = kSerfCliQueueDepth;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "-q" && i + 1 < argc) {
+      char *end;
+      unsigned long parsed = std::strtoul(argv[++i], &end, 10);
+      if (*end != '\0' || parsed == 0 || parsed > UINT32_MAX) {
+        PrintUsage();
+        return 2;
+      }
+      queue_depth = static_cast<uint32_t>(parsed);
+    } else if (option.size() == 2 && option[0] == '-') {
+      PrintUsage();
+      return 2;
+    } else {
+      paths.push_back(option);
+    }
+  }
+  if (paths.size() != 2) {
+    PrintUsage();
+    return 2;
+  }
+
+  std::FILE *input = OpenStream(paths[0], "rb");
+  if (input == nullptr) {
+    std::fprintf(stderr, "serf-decompress: cannot open %s\n", paths[0].c_str());
+    return 1;
+  }
+  SerfContainerHeader header;
+  if (!SerfContainer::ReadHeader(input, &header)) {
+    std::fprintf(stderr, "serf-decompress: %s is not a SERF container of a supported version\n",
+                 paths[0].c_str());
+    CloseStream(input);
+    return 1;
+  }
+  std::FILE *output = OpenStream(paths[1], "wb");
+  if (output == nullptr) {
+    std::fprintf(stderr, "serf-decompress: cannot create %s\n", paths[1].c_str());
+    CloseStream(input);
+    return 1;
+  }
+
+  std::unique_ptr<SerfBlockDecoder> decoder = SerfBlockDecoder::Create(header);
+  PipelineStatus status;
+  BoundedQueue<SerfContainerRecord> records(queue_depth);
+  BoundedQueue<std::vector<double>> blocks(queue_depth);
+  BoundedQueue<std::string> texts(queue_depth);
+  std::thread reader(ReadStage, input, &records, &status);
+  std::thread decompressor(DecompressStage, decoder.get(), &records, &blocks, &status);
+  std::thread formatter(FormatStage, SerfContainer::IsSinglePrecision(header.algorithm), &blocks, &texts);
+
+  bool written = true;
+  std::string text;
+  while (written && texts.Pop(&text)) {
+    written = std::fwrite(text.data(), 1, text.size(), output) == text.size();
+  }
+  if (!written) {
+    status.Fail("failed to write the output");
+  }
+  texts.Close();
+  formatter.join();
+  decompressor.join();
+  reader.join();
+
+  CloseStream(input);
+  if (!CloseStream(output)) {
+    status.Fail("failed to write the output");
+  }
+  if (!status.ok()) {
+    std::fprintf(stderr, "serf-decompress: %s\n", status.error().c_str());
+    return 1;
+  }
+  return 0;
+}